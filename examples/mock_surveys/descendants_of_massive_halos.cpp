@@ -38,6 +38,7 @@
 #undef TREE_VERBOSE // not really doing tests here so suppress output
 #include "../../io/DataIO.hpp"
 #include "../../tree/Tree.hpp"
+#include "../../tree/FinalDescendants.hpp"
 
 /**
  * To compile:
@@ -260,36 +261,32 @@ int main(int argc, char *argv[]) {
     DataContainer<ConsistentTreesData> tree_data(tree_mask);
     const size_t N_tree_halos = tree_io.read_data_from_file(tree_data);
 
-    const auto tree_id_key = tree_data.get_internal_key("id");
-    const auto tree_desc_id_key = tree_data.get_internal_key("descendant_id");
     const auto tree_mass_key = tree_data.get_internal_key("virial_mass");
     const auto tree_scale_key = tree_data.get_internal_key("scale");
     const auto tree_orig_id_key = tree_data.get_internal_key("original_halo_id");
 
-    // need an index map between id in the consistent trees file and
-    // the forest index for quick look-up
-    std::unordered_map<int64_t, size_t> id_forest_idx_map;
-    size_t forest_index = -1;
+    // the final descendant of every halo in the tree file is the root node of
+    // its tree, found for all halos at once in parallel. Only the root nodes
+    // are needed for the final halo masses; for the full mass accretion
+    // history one would need to build the entire trees
+    std::cout << "Find the final descendants of all halos." << std::endl;
+    FinalDescendants final_descendants;
+    final_descendants.build(tree_data);
+    const auto final_tree_masses = final_descendants.get_final_values(tree_data, tree_mass_key);
 
-    // stores the row index in the data file for the root node
-    std::vector<size_t> root_node_row_numbers;
+    // need an index map between the original_halo_id in the consistent trees
+    // file and the row of that halo for quick look-up
+    std::unordered_map<int64_t, size_t> id_tree_row_map;
 
     size_t matches = 0;
-    std::cout << "Find all of the root nodes." << std::endl;
-    // find all root nodes
     for (size_t row_number = 0; row_number < N_tree_halos; row_number++) {
-        if (tree_data.get_data<int64_t>(row_number, tree_desc_id_key) == -1) {
-            root_node_row_numbers.push_back(row_number);
-            forest_index++;
-        }
-
         const auto scale = tree_data.get_data<double>(row_number, tree_scale_key);
-        // if the halo is at the scale factor of interest, we can find the tree
-        // immediately and have the final halo mass
+        // if the halo is at the scale factor of interest, we can look up its
+        // final halo mass immediately
         if (close_enough(scale, scale_factor)) {
-            id_forest_idx_map.insert(
+            id_tree_row_map.insert(
                 {tree_data.get_data<int64_t>(row_number, tree_orig_id_key),
-                    forest_index}
+                    row_number}
             );
             matches++;
         }
@@ -298,36 +295,6 @@ int main(int argc, char *argv[]) {
     std::cout << "Found " << matches << " halos at a = ";
     std::cout << scale_factor << std::endl;
 
-    // all of the Tree objects are in the forest
-    std::vector<std::unique_ptr<Tree>> forest;
-
-    // loop over all root nodes and add them to the forest
-    int64_t id;
-    size_t indexer = 0;
-    size_t next_root_node_row_number = 0;
-    for (size_t &root_node_row_number : root_node_row_numbers) {
-        if (indexer != root_node_row_numbers.size()-1) {
-            next_root_node_row_number = root_node_row_numbers[++indexer];
-        }
-        else {
-            next_root_node_row_number = N_tree_halos;
-        }
-
-        id = tree_data.get_data<int64_t>(root_node_row_number, tree_id_key);
-        auto root_node = std::make_shared<Node>(root_node_row_number,
-                                                nullptr, id);
-        forest.push_back(
-            std::make_unique<Tree>(
-                root_node, root_node_row_number,
-                next_root_node_row_number
-            )
-        );
-
-        // only need the root nodes to find the descendant masses; for
-        // the full mass accretion history one would need the entire tree
-        //forest.back()->build_tree(tree_data);
-    }
-
     std::vector<double> final_halo_masses(N_halos);
     // it is more efficient to compute the final halo mass of all
     // halos at the given redshift, and then compute the distributions
@@ -335,14 +302,10 @@ int main(int argc, char *argv[]) {
     for (size_t j = 0; j < N_halos; j++) {
         const auto halo_id = data.get_data<int64_t>(j, id_key);
         // if it is not in this tree file, it will be somewhere else
-        if (id_forest_idx_map.find(halo_id) != id_forest_idx_map.end()) {
-            const auto forest_idx = id_forest_idx_map[halo_id];
-            // if we know the tree, we know the final halo mass is just the
-            // root node mass of the tree
-            const auto row_idx = forest[forest_idx]->root_node_row_in_data_;
-            const auto final_mass = tree_data.get_data<double>(row_idx, tree_mass_key);
+        auto tree_row = id_tree_row_map.find(halo_id);
+        if (tree_row != id_tree_row_map.end()) {
             // units should be Msun
-            final_halo_masses[j] = final_mass / hubble_constant;
+            final_halo_masses[j] = final_tree_masses[tree_row->second] / hubble_constant;
         }
     }
 
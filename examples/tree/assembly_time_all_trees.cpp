@@ -24,6 +24,9 @@
 #include <H5Cpp.h>
 #include <cassert>
 #include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/MainBranch.hpp"
+#include "../../tree/FormationTime.hpp"
 #include "../../io/DataIO.hpp"
 
 template <typename T>
@@ -79,7 +82,6 @@ int main(int argc, char* argv[]) {
     const std::vector<double> ratios_to_check = {
         0.05, 0.1, 0.5
     };
-    const auto N_ratios = ratios_to_check.size();
 
     DataIO<DataContainer<ConsistentTreesData>> io(data_file);
 
@@ -89,11 +91,9 @@ int main(int argc, char* argv[]) {
     };
 
     DataContainer<ConsistentTreesData> data(data_mask);
-    const auto N_halos_in_tree = io.read_data_from_file(data);
+    io.read_data_from_file(data);
 
-    const auto id_key = data.get_internal_key("id");
     const auto original_id_key = data.get_internal_key("original_halo_id");
-    const auto descendant_id_key = data.get_internal_key("descendant_id");
     const auto scale_key = data.get_internal_key("scale");
     const auto virial_mass_key = data.get_internal_key("virial_mass");
     std::map<int, size_t> position_keys = {
@@ -102,35 +102,22 @@ int main(int argc, char* argv[]) {
         {2, data.get_internal_key("z")}
     };
 
-    size_t root_node_count = 0;
-    std::vector<size_t> root_node_indices;
-    // find all of the root nodes in the file
-    for (size_t i = 0; i < N_halos_in_tree; i++) {
-        if (data.get_data<int64_t>(i, descendant_id_key) == -1) {
-            root_node_indices.push_back(i);
-            root_node_count++;
-        }
-    }
+    std::cout << "Constructing all of the trees." << std::endl;
 
-    assert(root_node_count ==root_node_indices.size());
+    // all of the trees, in the order of their root nodes in the file
+    Forest forest;
+    forest.build_forest(data);
+    const auto &trees = forest.trees_;
+    const size_t root_node_count = forest.get_number_of_trees();
 
     std::cout << "Found " << root_node_count << " root nodes." << std::endl;
-    std::cout << "Constructing all of the trees." << std::endl;
 
-    std::vector<std::shared_ptr<Tree>> trees(root_node_count);
     std::vector<double> root_virial_masses(root_node_count);
     std::vector<double> root_positions(3 * root_node_count);
     std::vector<int64_t> root_original_ids(root_node_count);
 
-    size_t tree_index = 0;
-    size_t next_root_node_index = 0;
-    for (const auto &root_node_index : root_node_indices) {
-        if (tree_index < (root_node_count-1)) {
-            next_root_node_index = root_node_indices[tree_index + 1];
-        }
-        else {
-            next_root_node_index = N_halos_in_tree;
-        }
+    for (size_t tree_index = 0; tree_index < root_node_count; tree_index++) {
+        const auto root_node_index = trees[tree_index]->root_node_row_in_data_;
 
         root_virial_masses[tree_index] 
                 = data.get_data<double>(root_node_index, virial_mass_key);
@@ -144,14 +131,6 @@ int main(int argc, char* argv[]) {
         root_original_ids[tree_index] = data.get_data<int64_t>(
             root_node_index, original_id_key
         );
-
-        const auto id = data.get_data<int64_t>(root_node_index, id_key);
-        auto root_node = std::make_shared<Node>(root_node_index, nullptr, id);
-        auto tree = std::make_shared<Tree>(root_node, root_node_index, 
-                                           next_root_node_index);
-        tree->build_tree(data);
-        trees[tree_index] = tree;
-        tree_index++;
     }
 
     // the index in the root_*** lists of the clusters
@@ -180,58 +159,16 @@ int main(int argc, char* argv[]) {
 
     std::cout << "Found " << cluster_count << " clusters." << std::endl;
 
-    size_t assembly_index = 0;
-    // flat array of all assembly scales, stride by the lengths of
-    // cluster_indices and ratios_to_check
-    std::vector<double> assembly_scales(N_ratios * cluster_count);
-    for (const auto &cluster_index : cluster_indices) {
-        std::vector<double> mmp_virial_masses;
-        trees.at(cluster_index)->traverse_most_massive_branch(data, 
-                                    trees.at(cluster_index)->root_node_, 
-                                    virial_mass_key,
-                                    mmp_virial_masses);
-
-        std::vector<double> scale_factors;
-        trees.at(cluster_index)->traverse_most_massive_branch(data, 
-                                    trees.at(cluster_index)->root_node_, 
-                                    scale_key,
-                                    scale_factors);
-
-        size_t ratio_index = 0;
-        for (const auto &ratio_to_check : ratios_to_check) {
-            const double mass_to_check = ratio_to_check
-                                            * root_virial_masses[cluster_index];
-            // stride the index
-            const auto key = N_ratios * assembly_index + ratio_index;
-            size_t progenitor_index = 0;
-            // check all previous masses against the z = 0 mass, going in the
-            // direction of increasing z
-            for (const auto &mmp_virial_mass : mmp_virial_masses) {
-                // once below the ratio, take the average of the two scales
-                if (mmp_virial_mass < mass_to_check) {
-                    if (progenitor_index > 0) {
-                        // average of previous and current
-                        assembly_scales[key] =
-                            0.5 * (scale_factors[progenitor_index - 1] 
-                                    + scale_factors[progenitor_index]);
-                    }
-                    else {
-                        assembly_scales[key] = scale_factors[0];
-                    }
-
-                    // go to the next ratio
-                    break;
-                }
-
-                progenitor_index++;
-            }
-
-            ratio_index++;
-        }
-
-        assembly_index++;
-    }    
+    // the virial masses (column 0) and scale factors (column 1) along the
+    // main branches of all of the clusters, for the output file
+    const auto main_branches = extract_main_branches(data, trees, cluster_indices,
+                                                     {virial_mass_key, scale_key});
 
+    // flat array of all assembly scales, stride by the lengths of
+    // cluster_indices and ratios_to_check, the scale is the average of the
+    // scales just above and just below the mass ratio (or 0 if there is none)
+    const FormationTime formation_time(ratios_to_check, FormationInterpolation::midpoint, 0.);
+    const auto assembly_scales = formation_time.compute(data, trees, cluster_indices);
 
     const H5std_string FILE_NAME(data_file + "_assembly.h5");
     try {
@@ -256,6 +193,25 @@ int main(int argc, char* argv[]) {
         write_dataset_to_file<double>(
             masses_dataset_name, file, cluster_virial_masses
         );
+
+        // the main branch of cluster i is [offsets[i], offsets[i + 1])
+        const std::vector<int64_t> main_branch_offsets(main_branches.offsets_.begin(),
+                                                       main_branches.offsets_.end());
+        write_dataset_to_file<int64_t>(
+            "main_branch_offsets", file, main_branch_offsets
+        );
+
+        const auto total_values = main_branches.get_number_of_values();
+        write_dataset_to_file<double>(
+            "main_branch_masses", file, 
+            std::vector<double>(main_branches.get_column(0), 
+                                main_branches.get_column(0) + total_values)
+        );
+        write_dataset_to_file<double>(
+            "main_branch_scales", file, 
+            std::vector<double>(main_branches.get_column(1), 
+                                main_branches.get_column(1) + total_values)
+        );
     } catch (H5::Exception &error) {
         error.printErrorStack(); 
     }
@@ -0,0 +1,133 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <queue>
+#include <chrono>
+#include <functional>
+#include "../../tree/Tree.hpp"
+#include "../../io/DataIO.hpp"
+
+// the old recursive most massive branch traversal, as the reference
+template <typename T, typename DataFileFormat>
+void recursive_most_massive_branch(const DataContainer<DataFileFormat> &data,
+                                   const std::shared_ptr<Node> &node,
+                                   const size_t key, std::vector<T> &value_list) {
+    value_list.push_back(data.template get_data<T>(node->get_data_row(), key));
+    if (!node->children_.empty()) {
+        recursive_most_massive_branch(data, node->children_[0], key, value_list);
+    }
+}
+
+// average duration of function in seconds over the repeats
+double time_function(const std::function<void(void)> &function, const int repeats) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repeats; i++) {
+        function();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> seconds_interval = end_time - start_time;
+
+    return seconds_interval.count() / repeats;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string data_file = (argc > 1) ? argv[1] : "../../test/data/tree_0_0_0.dat";
+    const int repeats = (argc > 2) ? std::stoi(argv[2]) : 10;
+    DataIO<DataContainer<ConsistentTreesData>> io(data_file);
+
+    std::vector<std::string> data_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> data(data_mask);
+    size_t N_halos_in_tree = io.read_data_from_file(data);
+
+    size_t id_key = data.get_internal_key("id");
+    size_t descendant_id_key = data.get_internal_key("descendant_id");
+    size_t virial_mass_key = data.get_internal_key("virial_mass");
+
+    std::vector<size_t> root_node_indices;
+    for (size_t i = 0; i < N_halos_in_tree; i++) {
+        if (data.get_data<int64_t>(i, descendant_id_key) == -1) {
+            root_node_indices.push_back(i);
+        }
+    }
+    root_node_indices.push_back(N_halos_in_tree);
+
+    // benchmark on the largest tree in the file
+    size_t root_node_index = 0, next_root_node_index = 0;
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        if (root_node_indices[i + 1] - root_node_indices[i] 
+            > next_root_node_index - root_node_index) {
+            root_node_index = root_node_indices[i];
+            next_root_node_index = root_node_indices[i + 1];
+        }
+    }
+
+    std::cout << "Benchmarking the tree at rows " << root_node_index << " to ";
+    std::cout << next_root_node_index << " over " << repeats << " repeats." << std::endl;
+
+    const int64_t id = data.get_data<int64_t>(root_node_index, id_key);
+    Tree tree(std::make_shared<Node>(root_node_index, nullptr, id),
+              root_node_index, next_root_node_index);
+    TreeScratch scratch;
+
+    auto recursive_build = time_function([&]() { 
+        tree.build_tree(data, TreeBuildMode::recursive); 
+    }, repeats);
+    auto iterative_build = time_function([&]() { 
+        tree.build_tree(data, TreeBuildMode::iterative, scratch); 
+    }, repeats);
+
+    std::vector<double> masses;
+    masses.reserve(next_root_node_index - root_node_index);
+    auto recursive_branch = time_function([&]() {
+        masses.clear();
+        recursive_most_massive_branch(data, tree.root_node_, virial_mass_key, masses);
+    }, repeats);
+    auto iterative_branch = time_function([&]() {
+        masses.clear();
+        tree.traverse_most_massive_branch(data, tree.root_node_, virial_mass_key, masses);
+    }, repeats);
+
+    auto recursive_search = time_function([&]() {
+        std::queue<std::shared_ptr<Node>> to_visit;
+        to_visit.push(tree.root_node_);
+        std::vector<std::shared_ptr<Node>> nodes;
+        tree.recursive_breadth_first_search(data, to_visit, virial_mass_key, 1.e12,
+                                            std::greater<double>(), nodes);
+    }, repeats);
+    auto iterative_search = time_function([&]() {
+        tree.breadth_first_search(data, tree.root_node_, virial_mass_key, 1.e12,
+                                  std::greater<double>(), scratch);
+    }, repeats);
+
+    std::cout << "build_tree: recursive " << recursive_build << " s, iterative ";
+    std::cout << iterative_build << " s" << std::endl;
+    std::cout << "traverse_most_massive_branch: recursive " << recursive_branch;
+    std::cout << " s, iterative " << iterative_branch << " s" << std::endl;
+    std::cout << "breadth_first_search: recursive " << recursive_search;
+    std::cout << " s, iterative " << iterative_search << " s" << std::endl;
+
+    return 0;
+}
@@ -25,6 +25,8 @@
 #include <functional>
 //#define TREE_VERBOSE
 #include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/TreeWalk.hpp"
 #include "../../io/DataIO.hpp"
 
 int main(int argc, char* argv[]) {
@@ -36,9 +38,8 @@ int main(int argc, char* argv[]) {
     };
 
     DataContainer<ConsistentTreesData> data(data_mask);
-    auto N_halos_in_tree = io.read_data_from_file(data);
+    io.read_data_from_file(data);
 
-    int64_t id;
     double scale, virial_mass;
 
     auto id_key = data.get_internal_key("id");
@@ -53,60 +54,23 @@ int main(int argc, char* argv[]) {
         {"virial_mass", virial_mass_key}
     };
 
-    // stores the row index in the data file for the root node
-    std::vector<size_t> root_node_row_numbers;
-
-    // find all root nodes
-    for (size_t row_number = 0; row_number < N_halos_in_tree; row_number++) {
-        if (data.get_data<int64_t>(row_number, descendant_id_key) == -1) {
-            root_node_row_numbers.push_back(row_number);
-        }
-    }
-
-    // all of the Tree objects are in the forest
-    std::vector<std::unique_ptr<Tree>> forest;
-
-    // loop over all root nodes and add them to the forest
-    size_t indexer = 0;
-    size_t next_root_node_row_number = 0;
-    for (auto &root_node_row_number : root_node_row_numbers) {
-        if (indexer != root_node_row_numbers.size()-1) {
-            next_root_node_row_number = root_node_row_numbers[++indexer];
-        }
-        else {
-            next_root_node_row_number = N_halos_in_tree;
-        }
-
-        id = data.get_data<int64_t>(root_node_row_number, id_key);
-        auto root_node = std::make_shared<Node>(root_node_row_number,
-                                                nullptr, id);
-        forest.push_back(
-            std::make_unique<Tree>(
-                root_node, root_node_row_number,
-                next_root_node_row_number
-            )
-        );
-
-        forest.back()->build_tree(data);
-    }
+    // all of the Tree objects are in the forest, built in parallel
+    Forest forest;
+    forest.build_forest(data);
 
     // start from root node and find all halos greater than
     // 10^9 Msun/h in the past.
-    auto nodes = forest[0]->breadth_first_search(data, forest[0]->root_node_,
-                                                 virial_mass_key, 1.e9,
-                                                 std::greater<double>());
+    auto nodes = forest.get_tree(0)->breadth_first_search(data, forest.get_tree(0)->root_node_,
+                                                          virial_mass_key, 1.e9,
+                                                          std::greater<double>());
     
-    indexer = 0;
-    // look at the very last node returned
-    auto node = nodes.back();
-    while (node != nullptr) {
+    // follow the very last node returned down to the root
+    for (const auto &node : walk_to_root(nodes.back())) {
         scale = data.get_data<double>(node->get_data_row(), scale_key);
         virial_mass = data.get_data<double>(node->get_data_row(), virial_mass_key);
 
         std::cout << "Traversal mass Mvir = " << virial_mass << " Msun/h at ";
         std::cout << "z = " << 1.0 / scale - 1.0 << std::endl;
-        
-        node = node->get_parent();
     }
 
     return 0;
@@ -27,11 +27,42 @@
 #include <unordered_map>
 #include <string>
 #include <variant>
+#include <cstdint>
 #include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <iostream>
+#include <mutex>
+#include "Parallel.hpp"
+#include "MemoryReport.hpp"
 
 struct RockstarData { };
 struct ConsistentTreesData { };
 
+/**
+ * Non-owning view of a contiguous piece of a column, used to read a column
+ * (or a range of rows of it) without copying.
+ */
+template <typename T>
+class ColumnSpan {
+private:
+    const T *data_;
+    size_t size_;
+public:
+    ColumnSpan(const T *data = nullptr, const size_t size = 0) 
+        : data_(data), size_(size) { }
+
+    size_t size(void) const { return size_; }
+    bool empty(void) const { return size_ == 0; }
+    const T *data(void) const { return data_; }
+    const T *begin(void) const { return data_; }
+    const T *end(void) const { return data_ + size_; }
+    const T &operator[](const size_t index) const { return data_[index]; }
+
+    template <typename U>
+    U get(const size_t index) const { return std::get<U>(data_[index]); }
+};
+
 /**
  * The DataContainer class will define and store the actual data from the file internally.
  * It is important to note that this library is not a generic ASCII file reader, and only
@@ -72,10 +103,54 @@ private:
 
     // is true for double number and false for int64_t
     std::vector<bool> data_is_double_mask_;
+    // the same by internal key, derived columns are always double
+    std::vector<bool> internal_is_double_;
+
+    // number of internal columns that are read from the data file, any
+    // derived columns are stored in data_ after these
+    size_t file_column_count_;
+
+    // incremented every time a column is modified, so that derived columns
+    // know when they are stale
+    mutable std::vector<size_t> column_versions_;
+    // incremented every time any row is modified, for the derived columns
+    // without source columns
+    size_t data_version_ = 0;
+
+    struct DerivedColumn {
+        std::vector<size_t> source_keys;
+        std::function<double(const DataContainer &, const size_t)> function;
+        // the source versions (or the data version without sources) and
+        // number of rows at the last materialization
+        std::vector<size_t> source_versions;
+        size_t data_version = 0;
+        size_t rows = 0;
+        bool materialized = false;
+        // held while the column is filled, so that it is only filled once
+        std::shared_ptr<std::mutex> fill_mutex;
+    };
+
+    // internal key -> derived column definition
+    mutable std::unordered_map<size_t, DerivedColumn> derived_columns_;
+    // derived columns are filled from const accessors, possibly from many
+    // threads, this protects the definitions and versions (not the filling)
+    std::shared_ptr<std::recursive_mutex> derived_column_mutex_;
+
+    bool is_derived_column_stale(const DerivedColumn &derived_column) const;
+    void update_derived_column(const size_t key) const;
+
+    // copies everything, or everything but the rows of the columns
+    DataContainer(const DataContainer &other, const bool copy_rows);
 public:
     std::vector<std::shared_ptr<std::vector<std::variant<double, int64_t>>>> data_;
 
+    using DerivedFunction = std::function<double(const DataContainer &, const size_t)>;
+
     DataContainer(const std::vector<std::string> &provided_column_mask = std::vector<std::string>());
+    DataContainer(const DataContainer &other) : DataContainer(other, true) { }
+    DataContainer(DataContainer &&other) = default;
+    DataContainer &operator=(const DataContainer &other);
+    DataContainer &operator=(DataContainer &&other) = default;
 
     bool column_mask(const size_t &column_index) const;
     bool column_mask(const std::string &column_key) const;
@@ -85,11 +160,36 @@ public:
     size_t get_key(const std::string &column_name) const;
     size_t get_total_keys(void) const;
     bool is_column_double(const size_t column_index) const;
+    bool is_internal_column_double(const size_t column) const;
+    size_t get_number_of_rows(void) const;
+    std::vector<std::string> get_column_names(void) const;
+    ColumnSpan<std::variant<double, int64_t>> get_column_span(const size_t column) const;
+    MemoryReport get_memory_report(void) const;
+
+    void add_derived_column(const std::string &name,
+                            const std::vector<std::string> &source_columns,
+                            DerivedFunction function);
+    void add_derived_column(const std::string &name,
+                            const std::string &source_column,
+                            std::function<double(double)> expression);
+    bool is_derived_column(const size_t column) const;
+    void materialize_derived_column(const std::string &name) const;
+    void materialize_derived_column(const size_t column) const;
+
+    size_t get_column_version(const size_t column) const;
+    void mark_column_modified(const size_t column);
+
+    DataContainer select_rows(const std::vector<size_t> &rows) const;
+    void permute_rows(const std::vector<size_t> &order, const size_t requested_threads = 0);
 
     template <typename T>
     T get_data(const size_t row, const size_t column) const;
     template <typename T>
     T get_data(const size_t row, const std::string &column) const;
+    double get_data_as_double(const size_t row, const size_t column) const;
+
+    template <typename T>
+    void set_data(const size_t row, const size_t column, const T value);
 };
 
 template class DataContainer<RockstarData>;
@@ -319,12 +419,66 @@ DataContainer<DataFileFormat>::DataContainer(const std::vector<std::string> &pro
         // convert external index to internal index
         keys_internal_int_to_int_.insert(std::make_pair(val, column_index));
         keys_internal_str_to_int_.insert(std::make_pair(keys_int_to_str_.at(val), column_index));
+        internal_is_double_.push_back(data_is_double_mask_.at(val));
 
         column_mask_int_to_bool_.at(val) = true;
         column_mask_str_to_bool_.at(keys_int_to_str_.at(val)) = true;
 
         column_index++;
     }
+
+    file_column_count_ = data_.size();
+    column_versions_.assign(file_column_count_, 0);
+    derived_column_mutex_ = std::make_shared<std::recursive_mutex>();
+}
+
+/**
+ * Copies are independent: every column (including the derived columns) is
+ * copied, and the copy has its own versions and locks.
+ */
+template <typename DataFileFormat>
+DataContainer<DataFileFormat>::DataContainer(const DataContainer &other, const bool copy_rows)
+    : keys_int_to_str_(other.keys_int_to_str_),
+      keys_str_to_int_(other.keys_str_to_int_),
+      column_mask_int_to_bool_(other.column_mask_int_to_bool_),
+      column_mask_str_to_bool_(other.column_mask_str_to_bool_),
+      keys_internal_int_to_int_(other.keys_internal_int_to_int_),
+      keys_internal_str_to_int_(other.keys_internal_str_to_int_),
+      data_is_double_mask_(other.data_is_double_mask_),
+      internal_is_double_(other.internal_is_double_),
+      file_column_count_(other.file_column_count_) {
+    std::lock_guard<std::recursive_mutex> lock(*other.derived_column_mutex_);
+
+    column_versions_ = other.column_versions_;
+    data_version_ = other.data_version_;
+    derived_columns_ = other.derived_columns_;
+    derived_column_mutex_ = std::make_shared<std::recursive_mutex>();
+
+    data_.reserve(other.data_.size());
+    for (const auto &column : other.data_) {
+        if (copy_rows) {
+            data_.push_back(std::make_shared<std::vector<std::variant<double, int64_t>>>(*column));
+        }
+        else {
+            data_.push_back(std::make_shared<std::vector<std::variant<double, int64_t>>>());
+        }
+    }
+
+    for (auto &[key, derived_column] : derived_columns_) {
+        derived_column.fill_mutex = std::make_shared<std::mutex>();
+        if (!copy_rows) {
+            derived_column.materialized = false;
+        }
+    }
+}
+
+template <typename DataFileFormat>
+DataContainer<DataFileFormat> &DataContainer<DataFileFormat>::operator=(const DataContainer &other) {
+    if (this != &other) {
+        *this = DataContainer(other);
+    }
+
+    return *this;
 }
 
 template <typename DataFileFormat>
@@ -344,7 +498,14 @@ size_t DataContainer<DataFileFormat>::get_internal_key(const size_t &column_inde
 
 template <typename DataFileFormat>
 size_t DataContainer<DataFileFormat>::get_internal_key(const std::string &column_name) const {
-    return keys_internal_str_to_int_.at(column_name);
+    auto key = keys_internal_str_to_int_.at(column_name);
+
+    // derived columns are filled the first time that they are asked for
+    if (key >= file_column_count_) {
+        update_derived_column(key);
+    }
+
+    return key;
 }
 
 template <typename DataFileFormat>
@@ -367,6 +528,347 @@ bool DataContainer<DataFileFormat>::is_column_double(const size_t column_index)
     return data_is_double_mask_.at(column_index);
 }
 
+template <typename DataFileFormat>
+bool DataContainer<DataFileFormat>::is_internal_column_double(const size_t column) const {
+    return internal_is_double_.at(column);
+}
+
+template <typename DataFileFormat>
+size_t DataContainer<DataFileFormat>::get_number_of_rows(void) const {
+    if (file_column_count_ == 0) {
+        return 0;
+    }
+
+    return data_[0]->size();
+}
+
+/**
+ * Returns the names of the loaded columns (including derived columns) in the
+ * order of their internal keys.
+ */
+template <typename DataFileFormat>
+std::vector<std::string> DataContainer<DataFileFormat>::get_column_names(void) const {
+    std::vector<std::string> column_names(data_.size());
+    for (const auto &[name, key] : keys_internal_str_to_int_) {
+        column_names[key] = name;
+    }
+
+    return column_names;
+}
+
+template <typename DataFileFormat>
+ColumnSpan<std::variant<double, int64_t>> 
+DataContainer<DataFileFormat>::get_column_span(const size_t column) const {
+    return ColumnSpan<std::variant<double, int64_t>>(data_[column]->data(), 
+                                                      data_[column]->size());
+}
+
+/**
+ * Reports the bytes used by every loaded (and derived) column, by the key
+ * lookup tables, and by the remaining bookkeeping structures. The static key
+ * tables shared by all containers of a file format are not included.
+ */
+template <typename DataFileFormat>
+MemoryReport DataContainer<DataFileFormat>::get_memory_report(void) const {
+    MemoryReport report;
+
+    auto column_names = get_column_names();
+
+    for (size_t key = 0; key < data_.size(); key++) {
+        // the shared_ptr control block is allocated next to the vector
+        size_t bytes = vector_bytes(*data_[key]) + 2 * sizeof(void *);
+        report.entries.push_back(std::make_pair(column_names[key], bytes));
+        report.data_bytes += bytes;
+    }
+
+    report.index_bytes = map_bytes(keys_int_to_str_) + map_bytes(keys_str_to_int_)
+                         + map_bytes(column_mask_int_to_bool_) 
+                         + map_bytes(column_mask_str_to_bool_)
+                         + map_bytes(keys_internal_int_to_int_)
+                         + map_bytes(keys_internal_str_to_int_);
+
+    // the map objects themselves are already counted in the index bytes
+    report.metadata_bytes = sizeof(*this) - 3 * sizeof(keys_int_to_str_) 
+                            - 3 * sizeof(keys_internal_int_to_int_)
+                            + data_.capacity() * sizeof(data_[0])
+                            + data_is_double_mask_.capacity() / 8
+                            + internal_is_double_.capacity() / 8
+                            + column_versions_.capacity() * sizeof(size_t);
+    for (const auto &[key, derived_column] : derived_columns_) {
+        report.metadata_bytes += sizeof(key) + sizeof(derived_column) + 2 * sizeof(void *)
+                                 + vector_bytes(derived_column.source_keys)
+                                 + vector_bytes(derived_column.source_versions);
+    }
+
+    return report;
+}
+
+/**
+ * Registers a new double column that is computed from the loaded columns in
+ * source_columns. The function is called as function(container, row) for every
+ * row, and the result is only computed the first time the column is accessed
+ * through get_internal_key(), get_data() with a string key, or
+ * materialize_derived_column(). The values are cached until one of the source
+ * columns is modified or changes length.
+ *
+ * Accessing the column through get_data() with an internal key does not check
+ * for changes, so the key should be looked up again after modifying sources.
+ * The function is evaluated from several threads, so it should read the data
+ * with internal keys that are looked up before registering the column.
+ */
+template <typename DataFileFormat>
+void DataContainer<DataFileFormat>::add_derived_column(const std::string &name,
+                                                       const std::vector<std::string> &source_columns,
+                                                       DerivedFunction function) {
+    if (keys_str_to_int_.find(name) != keys_str_to_int_.end()
+        || keys_internal_str_to_int_.find(name) != keys_internal_str_to_int_.end()) {
+        throw std::runtime_error("The derived column name " + name + " is already in use.\n");
+    }
+
+    DerivedColumn derived_column;
+    for (const auto &source_column : source_columns) {
+        auto source = keys_internal_str_to_int_.find(source_column);
+        if (source == keys_internal_str_to_int_.end()) {
+            throw std::runtime_error("The source column " + source_column 
+                                     + " for derived column " + name + " is not loaded.\n");
+        }
+        derived_column.source_keys.push_back(source->second);
+    }
+    derived_column.function = function;
+    derived_column.fill_mutex = std::make_shared<std::mutex>();
+
+    std::lock_guard<std::recursive_mutex> lock(*derived_column_mutex_);
+
+    const size_t key = data_.size();
+    data_.push_back(std::make_shared<std::vector<std::variant<double, int64_t>>>());
+    column_versions_.push_back(0);
+    internal_is_double_.push_back(true);
+    keys_internal_str_to_int_.insert(std::make_pair(name, key));
+    derived_columns_.insert(std::make_pair(key, derived_column));
+}
+
+/**
+ * Convenience version for the common case of an element-wise expression on a
+ * single column, e.g. the redshift from the scale factor.
+ */
+template <typename DataFileFormat>
+void DataContainer<DataFileFormat>::add_derived_column(const std::string &name,
+                                                       const std::string &source_column,
+                                                       std::function<double(double)> expression) {
+    auto source_key = keys_internal_str_to_int_.find(source_column);
+    if (source_key == keys_internal_str_to_int_.end()) {
+        throw std::runtime_error("The source column " + source_column 
+                                 + " for derived column " + name + " is not loaded.\n");
+    }
+
+    const size_t key = source_key->second;
+    add_derived_column(name, {source_column},
+                       [key, expression](const DataContainer &container, const size_t row) {
+                           return expression(container.get_data_as_double(row, key));
+                       });
+}
+
+template <typename DataFileFormat>
+bool DataContainer<DataFileFormat>::is_derived_column(const size_t column) const {
+    return derived_columns_.find(column) != derived_columns_.end();
+}
+
+template <typename DataFileFormat>
+void DataContainer<DataFileFormat>::materialize_derived_column(const std::string &name) const {
+    update_derived_column(keys_internal_str_to_int_.at(name));
+}
+
+/**
+ * Fills a derived column by its internal key, for code that reads the column
+ * storage directly (e.g. through get_column_span).
+ */
+template <typename DataFileFormat>
+void DataContainer<DataFileFormat>::materialize_derived_column(const size_t column) const {
+    update_derived_column(column);
+}
+
+template <typename DataFileFormat>
+bool DataContainer<DataFileFormat>::is_derived_column_stale(const DerivedColumn &derived_column) const {
+    if (!derived_column.materialized) {
+        return true;
+    }
+
+    if (derived_column.source_keys.empty()) {
+        return derived_column.data_version != data_version_ 
+               || derived_column.rows != get_number_of_rows();
+    }
+
+    for (size_t i = 0; i < derived_column.source_keys.size(); i++) {
+        const auto source_key = derived_column.source_keys[i];
+        if (column_versions_[source_key] != derived_column.source_versions[i]
+            || data_[source_key]->size() != derived_column.rows) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * The source columns are brought up-to-date first, on the calling thread, and
+ * the column is then filled in parallel without holding the lock, so that the
+ * function can look up other derived columns from the worker threads. The
+ * fill mutex of the column makes other threads that need the same column wait
+ * for it instead of filling it again.
+ */
+template <typename DataFileFormat>
+void DataContainer<DataFileFormat>::update_derived_column(const size_t key) const {
+    DerivedColumn *derived_column = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lock(*derived_column_mutex_);
+        auto derived_iterator = derived_columns_.find(key);
+        if (derived_iterator == derived_columns_.end()) {
+            return;
+        }
+        derived_column = &derived_iterator->second;
+    }
+
+    // derived columns can depend on other derived columns
+    for (const auto &source_key : derived_column->source_keys) {
+        update_derived_column(source_key);
+    }
+
+    std::lock_guard<std::mutex> fill_lock(*derived_column->fill_mutex);
+
+    size_t rows = 0;
+    {
+        std::lock_guard<std::recursive_mutex> lock(*derived_column_mutex_);
+        if (!is_derived_column_stale(*derived_column)) {
+            return;
+        }
+
+        if (!derived_column->source_keys.empty()) {
+            rows = data_[derived_column->source_keys[0]]->size();
+            for (const auto &source_key : derived_column->source_keys) {
+                if (data_[source_key]->size() != rows) {
+                    throw std::runtime_error("The source columns of a derived column have different lengths.\n");
+                }
+            }
+        }
+        else {
+            rows = get_number_of_rows();
+        }
+    }
+
+    std::vector<std::variant<double, int64_t>> column(rows, 0.);
+    const auto &function = derived_column->function;
+    parallel_for_chunks(0, rows, 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t row = chunk_begin; row < chunk_end; row++) {
+                                column[row] = function(*this, row);
+                            }
+                        });
+
+    std::lock_guard<std::recursive_mutex> lock(*derived_column_mutex_);
+    data_[key]->swap(column);
+
+    derived_column->source_versions.clear();
+    for (const auto &source_key : derived_column->source_keys) {
+        derived_column->source_versions.push_back(column_versions_[source_key]);
+    }
+    derived_column->data_version = data_version_;
+    derived_column->rows = rows;
+    derived_column->materialized = true;
+
+    // anything derived from this column has to be updated as well
+    column_versions_[key]++;
+}
+
+template <typename DataFileFormat>
+size_t DataContainer<DataFileFormat>::get_column_version(const size_t column) const {
+    return column_versions_.at(column);
+}
+
+/**
+ * Has to be called after modifying a column directly through data_, so that
+ * the derived columns are recomputed on the next access.
+ */
+template <typename DataFileFormat>
+void DataContainer<DataFileFormat>::mark_column_modified(const size_t column) {
+    column_versions_.at(column)++;
+    data_version_++;
+}
+
+/**
+ * Returns a new container with the given rows of every loaded column, in the
+ * given order. The derived columns keep their definitions and are recomputed
+ * for the new rows when they are accessed.
+ */
+template <typename DataFileFormat>
+DataContainer<DataFileFormat> 
+DataContainer<DataFileFormat>::select_rows(const std::vector<size_t> &rows) const {
+    std::lock_guard<std::recursive_mutex> lock(*derived_column_mutex_);
+
+    DataContainer selected(*this, false);
+    for (size_t key = 0; key < data_.size(); key++) {
+        if (!is_derived_column(key)) {
+            const auto &source = *data_[key];
+            auto &column = *selected.data_[key];
+            column.reserve(rows.size());
+            for (const auto row : rows) {
+                column.push_back(source[row]);
+            }
+        }
+    }
+    selected.data_version_++;
+
+    return selected;
+}
+
+/**
+ * Reorders the rows in place, so that row i afterwards holds what was in row
+ * order[i]. The order has to be a permutation of all of the rows. Every loaded
+ * column is gathered into a new vector, one column per thread, and copies of
+ * the container that share the old columns are not affected. The derived
+ * columns are recomputed on their next access.
+ */
+template <typename DataFileFormat>
+void DataContainer<DataFileFormat>::permute_rows(const std::vector<size_t> &order,
+                                                 const size_t requested_threads) {
+    std::lock_guard<std::recursive_mutex> lock(*derived_column_mutex_);
+
+    const size_t rows = get_number_of_rows();
+    if (order.size() != rows) {
+        throw std::runtime_error("The row order has to contain every row of the container.\n");
+    }
+
+    std::vector<uint8_t> seen(rows, 0);
+    for (const auto row : order) {
+        if (row >= rows || seen[row]) {
+            throw std::runtime_error("The row order is not a permutation of the rows.\n");
+        }
+        seen[row] = 1;
+    }
+
+    parallel_for_chunks(0, data_.size(), 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t key = chunk_begin; key < chunk_end; key++) {
+                                if (is_derived_column(key)) {
+                                    continue;
+                                }
+
+                                const auto &source = *data_[key];
+                                auto column = std::make_shared<std::vector<std::variant<double, int64_t>>>();
+                                column->reserve(rows);
+                                for (const auto row : order) {
+                                    column->push_back(source[row]);
+                                }
+                                data_[key] = column;
+                            }
+                        }, requested_threads, 1);
+
+    for (size_t key = 0; key < data_.size(); key++) {
+        if (!is_derived_column(key)) {
+            mark_column_modified(key);
+        }
+    }
+}
+
 template <typename DataFileFormat>
 template <typename T>
 T DataContainer<DataFileFormat>::get_data(const size_t row, const size_t column) const {
@@ -380,6 +882,24 @@ T DataContainer<DataFileFormat>::get_data(const size_t row,
     return std::get<T>((*data_[get_internal_key(column)])[row]);
 }
 
+template <typename DataFileFormat>
+double DataContainer<DataFileFormat>::get_data_as_double(const size_t row, const size_t column) const {
+    return std::visit([](const auto value) { return (double)value; }, (*data_[column])[row]);
+}
+
+template <typename DataFileFormat>
+template <typename T>
+void DataContainer<DataFileFormat>::set_data(const size_t row, const size_t column, const T value) {
+    // the cell must keep the type of the column, otherwise later reads fail
+    if (std::is_same_v<T, double> != is_internal_column_double(column)) {
+        throw std::runtime_error("The value does not have the type of column " 
+                                 + std::to_string(column) + ".\n");
+    }
+
+    (*data_[column])[row] = value;
+    mark_column_modified(column);
+}
+
 #endif
 
 
@@ -0,0 +1,321 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DATAHDF5_HPP
+#define DATAHDF5_HPP
+
+#include <vector>
+#include <string>
+#include <variant>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <H5Cpp.h>
+#include "DataContainer.hpp"
+#include "DataIO.hpp"
+
+/**
+ * The header information of a catalog that is stored alongside the columns.
+ * Negative values (or an empty cosmology) mean that the quantity is unknown.
+ */
+struct HeaderMetadata {
+    // Omega_matter, Omega_lambda, h
+    std::vector<double> cosmology;
+    double scale_factor = -1.;
+    double box_size = -1.;
+};
+
+template <typename T>
+struct HDF5ColumnType;
+
+template <>
+struct HDF5ColumnType<double> {
+    static H5::PredType get() { return H5::PredType::NATIVE_DOUBLE; }
+};
+
+template <>
+struct HDF5ColumnType<int64_t> {
+    static H5::PredType get() { return H5::PredType::NATIVE_INT64; }
+};
+
+/**
+ * Columnar HDF5 storage for a DataContainer. Every loaded column (including
+ * derived columns) is written as a chunked, optionally compressed, dataset
+ * with the column name, and the header metadata is written as attributes of
+ * the root group. Reading uses hyperslabs, so only the requested rows of the
+ * columns in the mask of the container are read from disk.
+ *
+ * This header needs the HDF5 C++ library (-lhdf5_cpp -lhdf5), so it is not
+ * included by DataIO.hpp.
+ */
+template <typename Container>
+class HDF5IO {
+private:
+    std::string file_name_;
+
+    template <typename T>
+    static void write_column(H5::H5File &file, const std::string &name,
+                             const std::vector<std::variant<double, int64_t>> &column,
+                             const size_t chunk_rows, const int compression_level);
+
+    template <typename T>
+    static void read_column(const H5::DataSet &dataset,
+                            std::vector<std::variant<double, int64_t>> &column,
+                            const size_t row_start, const size_t row_count);
+
+public:
+    HDF5IO(std::string file_name = "") {
+        file_name_ = file_name;
+    }
+
+    void set_file_name(const std::string &file_name);
+    std::string get_file_name(void) const;
+
+    template <typename IO>
+    static HeaderMetadata read_header_metadata(const IO &data_io);
+
+    void write_data_to_file(const Container &container,
+                            const HeaderMetadata &metadata = HeaderMetadata(),
+                            const int compression_level = 4,
+                            const size_t chunk_rows = 65536) const;
+
+    size_t get_number_of_rows(void) const;
+    HeaderMetadata read_metadata_from_file(void) const;
+
+    size_t read_data_from_file(Container &container,
+                               const size_t row_start = 0,
+                               size_t row_count = std::numeric_limits<size_t>::max()) const;
+};
+
+template <typename Container>
+void HDF5IO<Container>::set_file_name(const std::string &file_name) {
+    file_name_ = file_name;
+}
+
+template <typename Container>
+std::string HDF5IO<Container>::get_file_name(void) const {
+    return file_name_;
+}
+
+/**
+ * Collects whatever header information is available from a DataIO object
+ * whose header was already read with read_header().
+ */
+template <typename Container>
+template <typename IO>
+HeaderMetadata HDF5IO<Container>::read_header_metadata(const IO &data_io) {
+    HeaderMetadata metadata;
+
+    // not every file format has all of the quantities
+    try {
+        metadata.cosmology = data_io.read_cosmology_from_header();
+    }
+    catch (const std::exception &) { }
+
+    try {
+        metadata.box_size = data_io.read_box_size_from_header();
+    }
+    catch (const std::exception &) { }
+
+    metadata.scale_factor = data_io.read_scale_factor_from_header();
+
+    return metadata;
+}
+
+template <typename Container>
+template <typename T>
+void HDF5IO<Container>::write_column(H5::H5File &file, const std::string &name,
+                                     const std::vector<std::variant<double, int64_t>> &column,
+                                     const size_t chunk_rows, const int compression_level) {
+    const hsize_t rows = column.size();
+    hsize_t dims[1] = {rows};
+    H5::DataSpace file_space(1, dims);
+
+    H5::DSetCreatPropList properties;
+    if (rows > 0) {
+        hsize_t chunk_dims[1] = {std::min((hsize_t)chunk_rows, rows)};
+        properties.setChunk(1, chunk_dims);
+        if (compression_level > 0) {
+            properties.setShuffle();
+            properties.setDeflate(compression_level);
+        }
+    }
+
+    H5::DataSet dataset = file.createDataSet(name, HDF5ColumnType<T>::get(),
+                                             file_space, properties);
+
+    // convert and write one chunk at a time so that the buffer stays small
+    std::vector<T> buffer(std::min((hsize_t)chunk_rows, rows));
+    for (hsize_t offset = 0; offset < rows; offset += chunk_rows) {
+        hsize_t count[1] = {std::min((hsize_t)chunk_rows, rows - offset)};
+        hsize_t start[1] = {offset};
+
+        for (hsize_t i = 0; i < count[0]; i++) {
+            buffer[i] = std::get<T>(column[offset + i]);
+        }
+
+        file_space.selectHyperslab(H5S_SELECT_SET, count, start);
+        H5::DataSpace memory_space(1, count);
+        dataset.write(buffer.data(), HDF5ColumnType<T>::get(), memory_space, file_space);
+    }
+}
+
+template <typename Container>
+void HDF5IO<Container>::write_data_to_file(const Container &container,
+                                           const HeaderMetadata &metadata,
+                                           const int compression_level,
+                                           const size_t chunk_rows) const {
+    if (chunk_rows == 0) {
+        throw std::runtime_error("The HDF5 chunk size must be larger than zero.\n");
+    }
+
+    H5::H5File file(file_name_, H5F_ACC_TRUNC);
+
+    const auto column_names = container.get_column_names();
+    for (const auto &column_name : column_names) {
+        // also brings the derived columns up-to-date
+        const auto key = container.get_internal_key(column_name);
+        const auto &column = *container.data_[key];
+
+        if (container.is_derived_column(key) 
+            || container.is_column_double(container.get_key(column_name))) {
+            write_column<double>(file, column_name, column, chunk_rows, compression_level);
+        }
+        else {
+            write_column<int64_t>(file, column_name, column, chunk_rows, compression_level);
+        }
+    }
+
+    H5::Group root = file.openGroup("/");
+    H5::DataSpace scalar_space(H5S_SCALAR);
+
+    const hsize_t rows = container.get_number_of_rows();
+    root.createAttribute("rows", H5::PredType::NATIVE_HSIZE, scalar_space)
+        .write(H5::PredType::NATIVE_HSIZE, &rows);
+    root.createAttribute("scale_factor", H5::PredType::NATIVE_DOUBLE, scalar_space)
+        .write(H5::PredType::NATIVE_DOUBLE, &metadata.scale_factor);
+    root.createAttribute("box_size", H5::PredType::NATIVE_DOUBLE, scalar_space)
+        .write(H5::PredType::NATIVE_DOUBLE, &metadata.box_size);
+
+    if (!metadata.cosmology.empty()) {
+        hsize_t dims[1] = {metadata.cosmology.size()};
+        H5::DataSpace cosmology_space(1, dims);
+        root.createAttribute("cosmology", H5::PredType::NATIVE_DOUBLE, cosmology_space)
+            .write(H5::PredType::NATIVE_DOUBLE, metadata.cosmology.data());
+    }
+}
+
+template <typename Container>
+size_t HDF5IO<Container>::get_number_of_rows(void) const {
+    H5::H5File file(file_name_, H5F_ACC_RDONLY);
+
+    hsize_t rows = 0;
+    file.openGroup("/").openAttribute("rows").read(H5::PredType::NATIVE_HSIZE, &rows);
+
+    return rows;
+}
+
+template <typename Container>
+HeaderMetadata HDF5IO<Container>::read_metadata_from_file(void) const {
+    H5::H5File file(file_name_, H5F_ACC_RDONLY);
+    H5::Group root = file.openGroup("/");
+
+    HeaderMetadata metadata;
+    root.openAttribute("scale_factor").read(H5::PredType::NATIVE_DOUBLE, &metadata.scale_factor);
+    root.openAttribute("box_size").read(H5::PredType::NATIVE_DOUBLE, &metadata.box_size);
+
+    if (root.attrExists("cosmology")) {
+        H5::Attribute cosmology = root.openAttribute("cosmology");
+        metadata.cosmology.resize(cosmology.getSpace().getSimpleExtentNpoints());
+        cosmology.read(H5::PredType::NATIVE_DOUBLE, metadata.cosmology.data());
+    }
+
+    return metadata;
+}
+
+template <typename Container>
+template <typename T>
+void HDF5IO<Container>::read_column(const H5::DataSet &dataset,
+                                    std::vector<std::variant<double, int64_t>> &column,
+                                    const size_t row_start, const size_t row_count) {
+    H5::DataSpace file_space = dataset.getSpace();
+    hsize_t start[1] = {row_start};
+    hsize_t count[1] = {row_count};
+    file_space.selectHyperslab(H5S_SELECT_SET, count, start);
+    H5::DataSpace memory_space(1, count);
+
+    std::vector<T> buffer(row_count);
+    dataset.read(buffer.data(), HDF5ColumnType<T>::get(), memory_space, file_space);
+
+    column.reserve(column.size() + row_count);
+    for (const auto &value : buffer) {
+        column.push_back(value);
+    }
+}
+
+/**
+ * Appends the rows [row_start, row_start + row_count) of every column in the
+ * mask of the container. Derived columns of the container are not read, they
+ * are recomputed from the loaded columns when accessed. Returns the number of
+ * rows that were read.
+ */
+template <typename Container>
+size_t HDF5IO<Container>::read_data_from_file(Container &container,
+                                              const size_t row_start,
+                                              size_t row_count) const {
+    H5::H5File file(file_name_, H5F_ACC_RDONLY);
+
+    hsize_t rows = 0;
+    file.openGroup("/").openAttribute("rows").read(H5::PredType::NATIVE_HSIZE, &rows);
+
+    if (row_start > rows) {
+        throw std::runtime_error("The first row to read is past the end of " + file_name_ + "\n");
+    }
+    row_count = std::min(row_count, (size_t)rows - row_start);
+
+    // check every column first, so that the columns never end up with different lengths
+    const auto column_names = container.get_column_names();
+    for (size_t key = 0; key < column_names.size(); key++) {
+        if (!container.is_derived_column(key) && !file.nameExists(column_names[key])) {
+            throw std::runtime_error("The column " + column_names[key]
+                                     + " is not in " + file_name_ + "\n");
+        }
+    }
+
+    for (size_t key = 0; key < column_names.size(); key++) {
+        if (container.is_derived_column(key)) {
+            continue;
+        }
+
+        H5::DataSet dataset = file.openDataSet(column_names[key]);
+        auto &column = *container.data_[key];
+        // HDF5 converts the stored type to the type of the container column
+        if (container.is_column_double(container.get_key(column_names[key]))) {
+            read_column<double>(dataset, column, row_start, row_count);
+        }
+        else {
+            read_column<int64_t>(dataset, column, row_start, row_count);
+        }
+
+        container.mark_column_modified(key);
+    }
+
+    return row_count;
+}
+
+#endif
@@ -24,7 +24,9 @@
 #include <fstream>
 #include <sstream>
 #include <chrono>
+#include <filesystem>
 #include "DataContainer.hpp"
+#include "MemoryReport.hpp"
 
 template <typename Container>
 class DataIO {
@@ -58,6 +60,12 @@ public:
     bool process_line_from_file(const std::string &line, Container &container) const;
     size_t read_data_from_file(const std::string &file_name, Container &container) const;
     size_t read_data_from_file(Container &container) const;
+
+    MemoryEstimate estimate_memory_usage(const std::string &file_name,
+                                         const Container &container,
+                                         const size_t sample_lines = 1000) const;
+    MemoryEstimate estimate_memory_usage(const Container &container,
+                                         const size_t sample_lines = 1000) const;
 };
 
 template class DataIO<DataContainer<RockstarData>>;
@@ -300,5 +308,94 @@ size_t DataIO<Container>::read_data_from_file(Container &container) const {
     return read_data_from_file(file_name_, container);
 }
 
-#endif
+/**
+ * Estimates the memory that read_data_from_file() will need for the columns
+ * in the mask of the container, without reading the whole file. The average
+ * line length is sampled at several positions through the file and the number
+ * of rows follows from the file size.
+ */
+template <typename Container>
+MemoryEstimate DataIO<Container>::estimate_memory_usage(const std::string &file_name,
+                                                        const Container &container,
+                                                        const size_t sample_lines) const {
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open the provided file!\n" + file_name);
+    }
+
+    MemoryEstimate estimate;
+    estimate.file_bytes = std::filesystem::file_size(file_name);
+
+    // skip the header so that it does not bias the line length
+    std::string line;
+    size_t header_bytes = 0;
+    while (file.peek() == '#' && getline(file, line)) {
+        header_bytes += line.size() + 1;
+    }
 
+    const size_t data_bytes = estimate.file_bytes - std::min(header_bytes, estimate.file_bytes);
+    const size_t n_positions = 8;
+    const size_t lines_per_position = std::max((size_t)1, sample_lines / n_positions);
+
+    size_t sampled_bytes = 0;
+    for (size_t position = 0; position < n_positions; position++) {
+        file.clear();
+        file.seekg(header_bytes + position * data_bytes / n_positions);
+
+        // we most likely landed in the middle of a line
+        if (position > 0) {
+            getline(file, line);
+        }
+
+        for (size_t i = 0; i < lines_per_position; i++) {
+            if (!getline(file, line)) {
+                break;
+            }
+
+            // comment lines in the middle of the file (e.g. #tree) take up
+            // space but are not rows
+            sampled_bytes += line.size() + 1;
+            if (line.find("#") == std::string::npos) {
+                estimate.sampled_lines++;
+            }
+        }
+    }
+
+    file.close();
+
+    if (estimate.sampled_lines > 0) {
+        estimate.average_line_bytes = (double)sampled_bytes / (double)estimate.sampled_lines;
+        estimate.estimated_rows = (size_t)((double)data_bytes / estimate.average_line_bytes);
+    }
+
+    for (size_t column_index = 0; column_index < container.get_total_keys(); column_index++) {
+        if (container.column_mask(column_index)) {
+            estimate.columns++;
+        }
+    }
+
+    // the columns are filled with push_back, so their capacity doubles
+    size_t capacity = 1;
+    while (capacity < estimate.estimated_rows) {
+        capacity *= 2;
+    }
+
+    const size_t value_bytes = sizeof(std::variant<double, int64_t>);
+    const size_t column_overhead = sizeof(std::vector<std::variant<double, int64_t>>)
+                                   + 4 * sizeof(void *);
+    estimate.estimated_bytes = estimate.columns 
+                               * (estimate.estimated_rows * value_bytes + column_overhead);
+    // the last column to grow briefly holds both the old and the new buffer
+    estimate.estimated_peak_bytes = estimate.columns * (capacity * value_bytes + column_overhead)
+                                    + capacity / 2 * value_bytes;
+
+    return estimate;
+}
+
+template <typename Container>
+MemoryEstimate DataIO<Container>::estimate_memory_usage(const Container &container,
+                                                        const size_t sample_lines) const {
+    return estimate_memory_usage(file_name_, container, sample_lines);
+}
+
+#endif
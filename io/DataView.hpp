@@ -0,0 +1,180 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DATAVIEW_HPP
+#define DATAVIEW_HPP
+
+#include <vector>
+#include <string>
+#include <variant>
+#include <stdexcept>
+#include "DataContainer.hpp"
+
+/**
+ * A column seen through a list of row indices, i.e. the column span of a
+ * DataSubsetView. Element i is the value in row rows[i] of the container.
+ */
+template <typename T>
+class IndexedColumnSpan {
+private:
+    const T *data_;
+    const size_t *rows_;
+    size_t size_;
+public:
+    class iterator {
+    private:
+        const T *data_;
+        const size_t *row_;
+    public:
+        iterator(const T *data, const size_t *row) : data_(data), row_(row) { }
+        const T &operator*(void) const { return data_[*row_]; }
+        iterator &operator++(void) { row_++; return *this; }
+        bool operator!=(const iterator &other) const { return row_ != other.row_; }
+        bool operator==(const iterator &other) const { return row_ == other.row_; }
+    };
+
+    IndexedColumnSpan(const T *data, const size_t *rows, const size_t size)
+        : data_(data), rows_(rows), size_(size) { }
+
+    size_t size(void) const { return size_; }
+    bool empty(void) const { return size_ == 0; }
+    iterator begin(void) const { return iterator(data_, rows_); }
+    iterator end(void) const { return iterator(data_, rows_ + size_); }
+    const T &operator[](const size_t index) const { return data_[rows_[index]]; }
+
+    template <typename U>
+    U get(const size_t index) const { return std::get<U>(data_[rows_[index]]); }
+};
+
+/**
+ * Zero-copy view of the contiguous rows [begin, end) of a DataContainer, e.g.
+ * the rows of a single tree. Row i of the view is row begin + i of the
+ * container. The container must outlive the view.
+ */
+template <typename DataFileFormat>
+class DataRangeView {
+private:
+    const DataContainer<DataFileFormat> *container_;
+    size_t begin_;
+    size_t end_;
+public:
+    DataRangeView(const DataContainer<DataFileFormat> &container,
+                  const size_t begin, const size_t end) {
+        if (begin > end || end > container.get_number_of_rows()) {
+            throw std::runtime_error("The row range of the view is outside of the container.\n");
+        }
+
+        container_ = &container;
+        begin_ = begin;
+        end_ = end;
+    }
+
+    size_t size(void) const { return end_ - begin_; }
+    bool empty(void) const { return end_ == begin_; }
+    size_t get_row(const size_t index) const { return begin_ + index; }
+    size_t get_first_row(void) const { return begin_; }
+    size_t get_end_row(void) const { return end_; }
+    const DataContainer<DataFileFormat> &get_container(void) const { return *container_; }
+
+    size_t get_internal_key(const std::string &column_name) const {
+        return container_->get_internal_key(column_name);
+    }
+
+    template <typename T>
+    T get_data(const size_t index, const size_t column) const {
+        return container_->template get_data<T>(begin_ + index, column);
+    }
+
+    template <typename T>
+    T get_data(const size_t index, const std::string &column) const {
+        return container_->template get_data<T>(begin_ + index, column);
+    }
+
+    ColumnSpan<std::variant<double, int64_t>> get_column_span(const size_t column) const {
+        return ColumnSpan<std::variant<double, int64_t>>(
+            container_->data_[column]->data() + begin_, end_ - begin_
+        );
+    }
+
+    DataRangeView subrange(const size_t begin, const size_t end) const {
+        if (begin > end || end > size()) {
+            throw std::runtime_error("The subrange is outside of the view.\n");
+        }
+
+        return DataRangeView(*container_, begin_ + begin, begin_ + end);
+    }
+};
+
+/**
+ * Zero-copy view of an arbitrary list of rows of a DataContainer, e.g. the
+ * root rows of all of the clusters. The view does not own the row list, so
+ * both the container and the list must outlive the view.
+ */
+template <typename DataFileFormat>
+class DataSubsetView {
+private:
+    const DataContainer<DataFileFormat> *container_;
+    const size_t *rows_;
+    size_t size_;
+public:
+    DataSubsetView(const DataContainer<DataFileFormat> &container,
+                   const size_t *rows, const size_t size) {
+        container_ = &container;
+        rows_ = rows;
+        size_ = size;
+    }
+
+    DataSubsetView(const DataContainer<DataFileFormat> &container,
+                   const std::vector<size_t> &rows)
+        : DataSubsetView(container, rows.data(), rows.size()) { }
+
+    size_t size(void) const { return size_; }
+    bool empty(void) const { return size_ == 0; }
+    size_t get_row(const size_t index) const { return rows_[index]; }
+    const DataContainer<DataFileFormat> &get_container(void) const { return *container_; }
+
+    size_t get_internal_key(const std::string &column_name) const {
+        return container_->get_internal_key(column_name);
+    }
+
+    template <typename T>
+    T get_data(const size_t index, const size_t column) const {
+        return container_->template get_data<T>(rows_[index], column);
+    }
+
+    template <typename T>
+    T get_data(const size_t index, const std::string &column) const {
+        return container_->template get_data<T>(rows_[index], column);
+    }
+
+    IndexedColumnSpan<std::variant<double, int64_t>> get_column_span(const size_t column) const {
+        return IndexedColumnSpan<std::variant<double, int64_t>>(
+            container_->data_[column]->data(), rows_, size_
+        );
+    }
+
+    DataSubsetView subrange(const size_t begin, const size_t end) const {
+        if (begin > end || end > size()) {
+            throw std::runtime_error("The subrange is outside of the view.\n");
+        }
+
+        return DataSubsetView(*container_, rows_ + begin, end - begin);
+    }
+};
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORYREPORT_HPP
+#define MEMORYREPORT_HPP
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Byte counts for the different parts of a DataContainer or Tree. The sizes
+ * of the standard containers are estimates based on their capacity and the
+ * usual node layouts of the standard library, so they are accurate to within
+ * the allocator overhead.
+ */
+struct MemoryReport {
+    // name -> bytes for every column (or node storage category)
+    std::vector<std::pair<std::string, size_t>> entries;
+    size_t data_bytes = 0;
+    size_t index_bytes = 0;
+    size_t metadata_bytes = 0;
+
+    size_t get_total_bytes(void) const {
+        return data_bytes + index_bytes + metadata_bytes;
+    }
+
+    void print(void) const;
+};
+
+/**
+ * Estimate of the memory needed to read a file with a given column mask,
+ * computed before actually reading it.
+ */
+struct MemoryEstimate {
+    size_t file_bytes = 0;
+    size_t sampled_lines = 0;
+    double average_line_bytes = 0.;
+    size_t estimated_rows = 0;
+    size_t columns = 0;
+    // bytes once everything is read
+    size_t estimated_bytes = 0;
+    // includes the unused capacity of the column vectors and the copy made
+    // while they grow, this is the number to schedule jobs with
+    size_t estimated_peak_bytes = 0;
+
+    void print(void) const;
+};
+
+inline std::string format_bytes(const size_t bytes) {
+    const std::vector<std::string> units = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = (double)bytes;
+    size_t unit = 0;
+    while (value >= 1024. && unit < units.size() - 1) {
+        value /= 1024.;
+        unit++;
+    }
+
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(2) << value << " " << units[unit];
+    return stream.str();
+}
+
+inline void MemoryReport::print(void) const {
+    std::cout << "-----------------------------\n";
+    for (const auto &[name, bytes] : entries) {
+        std::cout << name << " \t" << format_bytes(bytes) << "\n";
+    }
+    std::cout << "-----------------------------\n";
+    std::cout << "Data \t\t" << format_bytes(data_bytes) << "\n";
+    std::cout << "Indices \t" << format_bytes(index_bytes) << "\n";
+    std::cout << "Metadata \t" << format_bytes(metadata_bytes) << "\n";
+    std::cout << "Total \t\t" << format_bytes(get_total_bytes()) << "\n";
+    std::cout << "-----------------------------" << std::endl;
+}
+
+inline void MemoryEstimate::print(void) const {
+    std::cout << "File size \t\t" << format_bytes(file_bytes) << "\n";
+    std::cout << "Sampled lines \t\t" << sampled_lines << "\n";
+    std::cout << "Estimated rows \t\t" << estimated_rows << "\n";
+    std::cout << "Columns \t\t" << columns << "\n";
+    std::cout << "Estimated memory \t" << format_bytes(estimated_bytes) << "\n";
+    std::cout << "Estimated peak memory \t" << format_bytes(estimated_peak_bytes) << std::endl;
+}
+
+// heap memory owned by the elements themselves, only strings have any here
+inline size_t heap_bytes(const std::string &value) {
+    // short strings are stored inline
+    return (value.capacity() > 15) ? value.capacity() + 1 : 0;
+}
+
+template <typename T>
+inline size_t heap_bytes(const T &) {
+    return 0;
+}
+
+template <typename T>
+inline size_t vector_bytes(const std::vector<T> &vector) {
+    return sizeof(vector) + vector.capacity() * sizeof(T);
+}
+
+inline size_t vector_bytes(const std::vector<bool> &vector) {
+    return sizeof(vector) + vector.capacity() / 8;
+}
+
+template <typename K, typename V>
+inline size_t map_bytes(const std::unordered_map<K, V> &map) {
+    // each node holds the value, the next pointer and the cached hash
+    size_t bytes = sizeof(map) + map.bucket_count() * sizeof(void *)
+                   + map.size() * (sizeof(std::pair<const K, V>) + 2 * sizeof(void *));
+    for (const auto &[key, value] : map) {
+        bytes += heap_bytes(key) + heap_bytes(value);
+    }
+
+    return bytes;
+}
+
+template <typename K, typename V>
+inline size_t map_bytes(const std::map<K, V> &map) {
+    // red-black tree nodes have three pointers and a color
+    size_t bytes = sizeof(map)
+                   + map.size() * (sizeof(std::pair<const K, V>) + 4 * sizeof(void *));
+    for (const auto &[key, value] : map) {
+        bytes += heap_bytes(key) + heap_bytes(value);
+    }
+
+    return bytes;
+}
+
+#endif
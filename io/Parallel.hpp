@@ -0,0 +1,163 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Returns the number of threads to use for the parallel loops in the library.
+ * A non-zero request is used as is, otherwise the HDM_NUM_THREADS environment
+ * variable is checked before falling back to the hardware concurrency.
+ */
+inline size_t get_number_of_threads(const size_t requested_threads = 0) {
+    if (requested_threads > 0) {
+        return requested_threads;
+    }
+
+    if (const char *env_threads = std::getenv("HDM_NUM_THREADS")) {
+        auto n_threads = std::strtol(env_threads, NULL, 10);
+        if (n_threads > 0) {
+            return (size_t)n_threads;
+        }
+    }
+
+    return std::max((size_t)1, (size_t)std::thread::hardware_concurrency());
+}
+
+/**
+ * True on a thread that is running a chunk of parallel_for_chunks. Nested
+ * parallel loops (e.g. a derived column filled while building a tree of a
+ * forest) run serially on such a thread, instead of starting more threads.
+ */
+inline bool &in_parallel_region(void) {
+    static thread_local bool in_region = false;
+    return in_region;
+}
+
+// marks the current thread as inside a parallel region while it exists
+class ParallelRegionGuard {
+private:
+    bool previous_;
+public:
+    ParallelRegionGuard() : previous_(in_parallel_region()) { in_parallel_region() = true; }
+    ~ParallelRegionGuard() { in_parallel_region() = previous_; }
+    ParallelRegionGuard(const ParallelRegionGuard &) = delete;
+    ParallelRegionGuard &operator=(const ParallelRegionGuard &) = delete;
+};
+
+/**
+ * Splits [begin, end) into chunks and calls function(chunk_begin, chunk_end)
+ * on each of them. The chunks are handed out dynamically through an atomic
+ * counter so that uneven work is balanced between the threads. The first
+ * exception thrown by any chunk is rethrown on the calling thread. Called
+ * from inside another parallel loop, the whole range runs on the calling
+ * thread as a single chunk.
+ */
+template <typename Function>
+void parallel_for_chunks(const size_t begin, const size_t end,
+                         Function function,
+                         const size_t requested_threads = 0,
+                         size_t chunk_size = 0) {
+    if (end <= begin) {
+        return;
+    }
+
+    const size_t total = end - begin;
+    const size_t n_threads = std::min(get_number_of_threads(requested_threads),
+                                      total);
+
+    // a few chunks per thread keeps the load balanced without much overhead
+    if (chunk_size == 0) {
+        chunk_size = std::max((size_t)1, total / (8 * n_threads));
+    }
+
+    if (n_threads <= 1 || total <= chunk_size || in_parallel_region()) {
+        function(begin, end);
+        return;
+    }
+
+    std::atomic<size_t> next_chunk(begin);
+    std::exception_ptr first_exception = nullptr;
+    std::mutex exception_mutex;
+
+    auto worker = [&]() {
+        ParallelRegionGuard guard;
+        while (true) {
+            const size_t chunk_begin = next_chunk.fetch_add(chunk_size);
+            if (chunk_begin >= end) {
+                break;
+            }
+            const size_t chunk_end = std::min(chunk_begin + chunk_size, end);
+
+            try {
+                function(chunk_begin, chunk_end);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (first_exception == nullptr) {
+                    first_exception = std::current_exception();
+                }
+                // stop handing out work
+                next_chunk.store(end);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for (size_t i = 0; i < n_threads - 1; i++) {
+        threads.emplace_back(worker);
+    }
+
+    // the calling thread does work as well
+    worker();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (first_exception != nullptr) {
+        std::rethrow_exception(first_exception);
+    }
+}
+
+/**
+ * Element-wise version of parallel_for_chunks, calls function(i) for every
+ * i in [begin, end).
+ */
+template <typename Function>
+void parallel_for(const size_t begin, const size_t end,
+                  Function function,
+                  const size_t requested_threads = 0) {
+    parallel_for_chunks(begin, end,
+                        [&function](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                function(i);
+                            }
+                        }, requested_threads);
+}
+
+#endif
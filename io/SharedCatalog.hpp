@@ -0,0 +1,406 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHAREDCATALOG_HPP
+#define SHAREDCATALOG_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "DataContainer.hpp"
+
+/**
+ * A read-only copy of the loaded columns of a DataContainer that lives in a
+ * named POSIX shared memory segment (e.g. "/snapshot_160") or in a file that
+ * is memory mapped. One process publishes the catalog once, and any number of
+ * processes on the same node attach to it without parsing or copying, so
+ * they all share a single copy of the data.
+ *
+ * The columns are stored as plain double or int64_t arrays, so they take half
+ * the memory of the std::variant columns in the DataContainer.
+ */
+template <typename DataFileFormat>
+class SharedCatalog {
+private:
+    struct CatalogHeader {
+        char magic[8];
+        uint64_t version;
+        uint64_t rows;
+        uint64_t columns;
+        uint64_t total_bytes;
+    };
+
+    struct ColumnHeader {
+        char name[64];
+        uint64_t is_double;
+        uint64_t offset;
+    };
+
+    static constexpr char magic_[8] = "HDMSHMC";
+    static constexpr uint64_t format_version_ = 1;
+    static constexpr size_t alignment_ = 64;
+
+    std::string name_;
+    void *mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+    const CatalogHeader *header_ = nullptr;
+    const ColumnHeader *column_headers_ = nullptr;
+
+    // column name -> internal key
+    std::unordered_map<std::string, size_t> keys_;
+
+    static int open_segment(const std::string &name, const bool file_backed,
+                            const int flags, const mode_t mode = 0);
+    void release(void);
+
+public:
+    SharedCatalog(const std::string &name, const bool file_backed = false);
+    ~SharedCatalog();
+
+    SharedCatalog(const SharedCatalog &) = delete;
+    SharedCatalog &operator=(const SharedCatalog &) = delete;
+    SharedCatalog(SharedCatalog &&other) noexcept;
+    SharedCatalog &operator=(SharedCatalog &&other) noexcept;
+
+    static void publish(const DataContainer<DataFileFormat> &container,
+                        const std::string &name, const bool file_backed = false);
+    static void remove(const std::string &name, const bool file_backed = false);
+
+    std::string get_name(void) const;
+    size_t get_number_of_rows(void) const;
+    size_t get_number_of_columns(void) const;
+    std::vector<std::string> get_column_names(void) const;
+    size_t get_internal_key(const std::string &column_name) const;
+    bool is_column_double(const size_t column) const;
+
+    template <typename T>
+    const T *get_column(const size_t column) const;
+
+    template <typename T>
+    T get_data(const size_t row, const size_t column) const;
+    template <typename T>
+    T get_data(const size_t row, const std::string &column) const;
+};
+
+template <typename DataFileFormat>
+int SharedCatalog<DataFileFormat>::open_segment(const std::string &name,
+                                                const bool file_backed,
+                                                const int flags, const mode_t mode) {
+    int file_descriptor;
+    if (file_backed) {
+        file_descriptor = open(name.c_str(), flags, mode);
+    }
+    else {
+        file_descriptor = shm_open(name.c_str(), flags, mode);
+    }
+
+    if (file_descriptor < 0) {
+        throw std::runtime_error("Could not open the shared catalog " + name
+                                 + ": " + std::strerror(errno) + "\n");
+    }
+
+    return file_descriptor;
+}
+
+/**
+ * Copies the loaded columns of the container into the named segment, replacing
+ * any existing segment with the same name. Attaching processes only accept the
+ * segment once it is completely written.
+ */
+template <typename DataFileFormat>
+void SharedCatalog<DataFileFormat>::publish(const DataContainer<DataFileFormat> &container,
+                                            const std::string &name,
+                                            const bool file_backed) {
+    const auto column_names = container.get_column_names();
+    const size_t n_columns = column_names.size();
+
+    // make sure that the derived columns are up-to-date
+    for (const auto &column_name : column_names) {
+        container.get_internal_key(column_name);
+    }
+    const size_t n_rows = container.get_number_of_rows();
+
+    // the header and column table are followed by the aligned column arrays
+    size_t total_bytes = sizeof(CatalogHeader) + n_columns * sizeof(ColumnHeader);
+    std::vector<uint64_t> offsets(n_columns);
+    for (size_t key = 0; key < n_columns; key++) {
+        if (column_names[key].size() >= sizeof(ColumnHeader::name)) {
+            throw std::runtime_error("The column name " + column_names[key]
+                                     + " is too long for a shared catalog.\n");
+        }
+        if (container.data_[key]->size() != n_rows) {
+            throw std::runtime_error("The column " + column_names[key]
+                                     + " does not have the same length as the others.\n");
+        }
+
+        total_bytes = (total_bytes + alignment_ - 1) / alignment_ * alignment_;
+        offsets[key] = total_bytes;
+        total_bytes += n_rows * sizeof(double);
+    }
+
+    if (file_backed) {
+        unlink(name.c_str());
+    }
+    else {
+        shm_unlink(name.c_str());
+    }
+
+    int file_descriptor = open_segment(name, file_backed, O_CREAT | O_RDWR | O_EXCL, 0644);
+    // an empty or partial segment is never left behind
+    if (ftruncate(file_descriptor, (off_t)total_bytes) != 0) {
+        const std::string error = std::strerror(errno);
+        close(file_descriptor);
+        remove(name, file_backed);
+        throw std::runtime_error("Could not resize the shared catalog " + name
+                                 + ": " + error + "\n");
+    }
+
+    void *mapping = mmap(NULL, total_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         file_descriptor, 0);
+    const std::string map_error = (mapping == MAP_FAILED) ? std::strerror(errno) : "";
+    close(file_descriptor);
+    if (mapping == MAP_FAILED) {
+        remove(name, file_backed);
+        throw std::runtime_error("Could not map the shared catalog " + name
+                                 + ": " + map_error + "\n");
+    }
+
+    auto bytes = static_cast<char *>(mapping);
+    auto header = reinterpret_cast<CatalogHeader *>(bytes);
+    auto column_headers = reinterpret_cast<ColumnHeader *>(bytes + sizeof(CatalogHeader));
+
+    header->version = format_version_;
+    header->rows = n_rows;
+    header->columns = n_columns;
+    header->total_bytes = total_bytes;
+
+    // a wrongly typed cell leaves neither the mapping nor a partial segment behind
+    try {
+        for (size_t key = 0; key < n_columns; key++) {
+            auto &column_header = column_headers[key];
+            std::memset(column_header.name, 0, sizeof(column_header.name));
+            std::strncpy(column_header.name, column_names[key].c_str(),
+                         sizeof(column_header.name) - 1);
+            column_header.offset = offsets[key];
+
+            // derived columns are always double, file columns have their declared type
+            const auto &column = *container.data_[key];
+            column_header.is_double 
+                = container.is_derived_column(key)
+                  || container.is_column_double(container.get_key(column_names[key]));
+
+            if (column_header.is_double) {
+                auto values = reinterpret_cast<double *>(bytes + offsets[key]);
+                for (size_t row = 0; row < n_rows; row++) {
+                    values[row] = std::get<double>(column[row]);
+                }
+            }
+            else {
+                auto values = reinterpret_cast<int64_t *>(bytes + offsets[key]);
+                for (size_t row = 0; row < n_rows; row++) {
+                    values[row] = std::get<int64_t>(column[row]);
+                }
+            }
+        }
+    }
+    catch (...) {
+        munmap(mapping, total_bytes);
+        remove(name, file_backed);
+        throw;
+    }
+
+    // the magic string marks the segment as complete
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, magic_, sizeof(magic_));
+
+    msync(mapping, total_bytes, MS_SYNC);
+    munmap(mapping, total_bytes);
+}
+
+template <typename DataFileFormat>
+void SharedCatalog<DataFileFormat>::remove(const std::string &name, const bool file_backed) {
+    if (file_backed) {
+        unlink(name.c_str());
+    }
+    else {
+        shm_unlink(name.c_str());
+    }
+}
+
+/**
+ * Attaches read-only to a published catalog. Only the header and the column
+ * table are read, so this takes the same time regardless of the number of rows.
+ */
+template <typename DataFileFormat>
+SharedCatalog<DataFileFormat>::SharedCatalog(const std::string &name, const bool file_backed) {
+    name_ = name;
+
+    int file_descriptor = open_segment(name, file_backed, O_RDONLY);
+
+    struct stat status;
+    if (fstat(file_descriptor, &status) != 0
+        || (size_t)status.st_size < sizeof(CatalogHeader)) {
+        close(file_descriptor);
+        throw std::runtime_error("The shared catalog " + name + " is incomplete.\n");
+    }
+
+    mapping_bytes_ = (size_t)status.st_size;
+    mapping_ = mmap(NULL, mapping_bytes_, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("Could not map the shared catalog " + name
+                                 + ": " + std::strerror(errno) + "\n");
+    }
+
+    auto bytes = static_cast<const char *>(mapping_);
+    header_ = reinterpret_cast<const CatalogHeader *>(bytes);
+    column_headers_ = reinterpret_cast<const ColumnHeader *>(bytes + sizeof(CatalogHeader));
+
+    if (std::memcmp(header_->magic, magic_, sizeof(magic_)) != 0
+        || header_->version != format_version_
+        || header_->total_bytes != mapping_bytes_) {
+        release();
+        throw std::runtime_error("The shared catalog " + name
+                                 + " is incomplete or has the wrong format.\n");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    for (size_t key = 0; key < header_->columns; key++) {
+        keys_.insert(std::make_pair(std::string(column_headers_[key].name), key));
+    }
+}
+
+template <typename DataFileFormat>
+void SharedCatalog<DataFileFormat>::release(void) {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_bytes_);
+    }
+
+    mapping_ = nullptr;
+    mapping_bytes_ = 0;
+    header_ = nullptr;
+    column_headers_ = nullptr;
+    keys_.clear();
+}
+
+template <typename DataFileFormat>
+SharedCatalog<DataFileFormat>::~SharedCatalog() {
+    release();
+}
+
+template <typename DataFileFormat>
+SharedCatalog<DataFileFormat>::SharedCatalog(SharedCatalog &&other) noexcept {
+    *this = std::move(other);
+}
+
+template <typename DataFileFormat>
+SharedCatalog<DataFileFormat> &
+SharedCatalog<DataFileFormat>::operator=(SharedCatalog &&other) noexcept {
+    if (this != &other) {
+        release();
+        name_ = std::move(other.name_);
+        mapping_ = other.mapping_;
+        mapping_bytes_ = other.mapping_bytes_;
+        header_ = other.header_;
+        column_headers_ = other.column_headers_;
+        keys_ = std::move(other.keys_);
+
+        other.mapping_ = nullptr;
+        other.mapping_bytes_ = 0;
+        other.header_ = nullptr;
+        other.column_headers_ = nullptr;
+    }
+
+    return *this;
+}
+
+template <typename DataFileFormat>
+std::string SharedCatalog<DataFileFormat>::get_name(void) const {
+    return name_;
+}
+
+template <typename DataFileFormat>
+size_t SharedCatalog<DataFileFormat>::get_number_of_rows(void) const {
+    return header_->rows;
+}
+
+template <typename DataFileFormat>
+size_t SharedCatalog<DataFileFormat>::get_number_of_columns(void) const {
+    return header_->columns;
+}
+
+template <typename DataFileFormat>
+std::vector<std::string> SharedCatalog<DataFileFormat>::get_column_names(void) const {
+    std::vector<std::string> column_names;
+    for (size_t key = 0; key < header_->columns; key++) {
+        column_names.push_back(column_headers_[key].name);
+    }
+
+    return column_names;
+}
+
+template <typename DataFileFormat>
+size_t SharedCatalog<DataFileFormat>::get_internal_key(const std::string &column_name) const {
+    return keys_.at(column_name);
+}
+
+template <typename DataFileFormat>
+bool SharedCatalog<DataFileFormat>::is_column_double(const size_t column) const {
+    return column_headers_[column].is_double;
+}
+
+template <typename DataFileFormat>
+template <typename T>
+const T *SharedCatalog<DataFileFormat>::get_column(const size_t column) const {
+    static_assert(std::is_same_v<T, double> || std::is_same_v<T, int64_t>,
+                  "Shared catalog columns are either double or int64_t.");
+
+    if (column_headers_[column].is_double != std::is_same_v<T, double>) {
+        throw std::runtime_error("The shared catalog column "
+                                 + std::string(column_headers_[column].name)
+                                 + " has a different type.\n");
+    }
+
+    return reinterpret_cast<const T *>(
+        static_cast<const char *>(mapping_) + column_headers_[column].offset
+    );
+}
+
+template <typename DataFileFormat>
+template <typename T>
+T SharedCatalog<DataFileFormat>::get_data(const size_t row, const size_t column) const {
+    return get_column<T>(column)[row];
+}
+
+template <typename DataFileFormat>
+template <typename T>
+T SharedCatalog<DataFileFormat>::get_data(const size_t row, const std::string &column) const {
+    return get_column<T>(get_internal_key(column))[row];
+}
+
+#endif
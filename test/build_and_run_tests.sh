@@ -29,8 +29,14 @@ for dir in ./test_*/ ; do
             # Extract the filename without the extension
             exe_file="${cpp_file%.cpp}"
 
+            # tests of the HDF5 functionality need the HDF5 compiler wrapper
+            compiler="g++"
+            if grep -q "DataHDF5.hpp" "$cpp_file"; then
+                compiler="h5c++"
+            fi
+
             # Compile the cpp file
-            g++ -Wall -Wextra -std=c++17 -O3 -o ../bin/$exe_file $cpp_file
+            $compiler -Wall -Wextra -std=c++17 -O3 -o ../bin/$exe_file $cpp_file
             if [[ $? -eq 0 ]]; then
                 echo "Succeeded compiling $cpp_file"
                 ../bin/$exe_file
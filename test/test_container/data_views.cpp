@@ -0,0 +1,120 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+#include "../../io/DataIO.hpp"
+#include "../../io/DataView.hpp"
+#include "../test.hpp"
+
+int main() {
+    DataIO<DataContainer<RockstarData>> data_io("../data/out_162.list");
+
+    std::vector<std::string> column_mask = {"id", "virial_mass"};
+    DataContainer<RockstarData> rockstar_data(column_mask);
+    size_t N_halos = data_io.read_data_from_file(rockstar_data);
+
+    size_t mvir_key = rockstar_data.get_internal_key("virial_mass");
+    size_t id_key = rockstar_data.get_internal_key("id");
+
+    auto full_span = rockstar_data.get_column_span(mvir_key);
+    assert(full_span.size() == N_halos);
+    test_passed("full_span.size()");
+
+    // contiguous rows
+    DataRangeView<RockstarData> range_view(rockstar_data, 100, 200);
+    assert(range_view.size() == 100);
+    test_passed("range_view.size()");
+
+    auto range_span = range_view.get_column_span(mvir_key);
+    // the view must not copy the column
+    assert(range_span.data() == full_span.data() + 100);
+    test_passed("range_span.data()");
+
+    size_t index = 0;
+    for (const auto &value : range_span) {
+        assert(std::get<double>(value) == rockstar_data.get_data<double>(100 + index, mvir_key));
+        assert(range_view.get_data<int64_t>(index, id_key) 
+               == rockstar_data.get_data<int64_t>(100 + index, id_key));
+        index++;
+    }
+    assert(index == 100);
+    test_passed("range_span iteration");
+
+    auto subrange_view = range_view.subrange(10, 20);
+    assert(subrange_view.get_row(0) == 110);
+    test_passed("subrange_view.get_row(0)");
+    assert(subrange_view.get_data<double>(5, "virial_mass") 
+           == rockstar_data.get_data<double>(115, mvir_key));
+    test_passed("subrange_view.get_data<double>(5, \"virial_mass\")");
+
+    // a subrange has to be inside of the view, not only inside of the container
+    bool caught_error = false;
+    try {
+        range_view.subrange(90, 110);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    test_passed("range_view.subrange(90, 110)");
+
+    // a selection of rows
+    std::vector<size_t> massive_rows;
+    for (size_t row = 0; row < N_halos; row++) {
+        if (rockstar_data.get_data<double>(row, mvir_key) > 1.e11) {
+            massive_rows.push_back(row);
+        }
+    }
+
+    DataSubsetView<RockstarData> subset_view(rockstar_data, massive_rows);
+    assert(subset_view.size() == massive_rows.size());
+    test_passed("subset_view.size()");
+
+    auto subset_span = subset_view.get_column_span(mvir_key);
+    index = 0;
+    for (const auto &value : subset_span) {
+        assert(std::get<double>(value) > 1.e11);
+        assert(subset_span.get<double>(index) 
+               == rockstar_data.get_data<double>(massive_rows[index], mvir_key));
+        assert(subset_view.get_data<int64_t>(index, id_key) 
+               == rockstar_data.get_data<int64_t>(massive_rows[index], id_key));
+        index++;
+    }
+    assert(index == massive_rows.size());
+    test_passed("subset_span iteration");
+
+    assert(subset_view.subrange(1, 3).get_row(0) == massive_rows[1]);
+    for (const auto &[begin, end] : {std::make_pair(subset_view.size(), subset_view.size() + 1),
+                                     std::make_pair((size_t)3, (size_t)1)}) {
+        caught_error = false;
+        try {
+            subset_view.subrange(begin, end);
+        }
+        catch (const std::runtime_error &) {
+            caught_error = true;
+        }
+        assert(caught_error);
+    }
+    test_passed("subset_view.subrange()");
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+#include "../../io/DataIO.hpp"
+#include "../test.hpp"
+
+int main() {
+    DataIO<DataContainer<RockstarData>> data_io("../data/out_163.list");
+
+    std::vector<std::string> column_mask = {"id", "virial_mass"};
+
+    DataContainer<RockstarData> rockstar_data(column_mask);
+    size_t N_halos = data_io.read_data_from_file(rockstar_data);
+
+    const double hubble_constant = 0.6781;
+    size_t mvir_key = rockstar_data.get_internal_key("virial_mass");
+    size_t id_key = rockstar_data.get_internal_key("id");
+
+    rockstar_data.add_derived_column("virial_mass_msun", "virial_mass",
+                                     [hubble_constant](double mass) {
+                                         return mass / hubble_constant;
+                                     });
+    rockstar_data.add_derived_column("log_virial_mass_msun", "virial_mass_msun",
+                                     [](double mass) { return std::log10(mass); });
+    rockstar_data.add_derived_column("mass_plus_id", {"virial_mass", "id"},
+                                     [mvir_key, id_key](const DataContainer<RockstarData> &data,
+                                                        const size_t row) {
+                                         return data.get_data<double>(row, mvir_key)
+                                                + (double)data.get_data<int64_t>(row, id_key);
+                                     });
+
+    size_t msun_key = rockstar_data.get_internal_key("virial_mass_msun");
+    size_t log_key = rockstar_data.get_internal_key("log_virial_mass_msun");
+    size_t sum_key = rockstar_data.get_internal_key("mass_plus_id");
+
+    assert(rockstar_data.is_derived_column(msun_key));
+    test_passed("rockstar_data.is_derived_column(msun_key)");
+    assert(!rockstar_data.is_derived_column(mvir_key));
+    test_passed("rockstar_data.is_derived_column(mvir_key)");
+    assert(rockstar_data.data_[log_key]->size() == N_halos);
+    test_passed("rockstar_data.data_[log_key]->size()");
+
+    for (size_t i = 0; i < 10; i++) {
+        double mass = rockstar_data.get_data<double>(i, mvir_key);
+        assert(close_enough(rockstar_data.get_data<double>(i, msun_key),
+                            mass / hubble_constant));
+        test_passed("rockstar_data.get_data<double>(i, msun_key)", i);
+        assert(close_enough(rockstar_data.get_data<double>(i, log_key),
+                            std::log10(mass / hubble_constant)));
+        test_passed("rockstar_data.get_data<double>(i, log_key)", i);
+        assert(close_enough(rockstar_data.get_data<double>(i, sum_key),
+                            mass + (double)i));
+        test_passed("rockstar_data.get_data<double>(i, sum_key)", i);
+    }
+
+    // modifying a source column must invalidate everything derived from it
+    rockstar_data.set_data<double>(0, mvir_key, 1.e12);
+    assert(close_enough(rockstar_data.get_data<double>(0, "log_virial_mass_msun"),
+                        std::log10(1.e12 / hubble_constant)));
+    test_passed("rockstar_data.get_data<double>(0, \"log_virial_mass_msun\")");
+
+    // a derived column that looks up another derived column from the threads
+    // that fill it, with several threads even on a single core
+    setenv("HDM_NUM_THREADS", "4", 1);
+    rockstar_data.add_derived_column("log_virial_mass_msun_twice", {"log_virial_mass_msun"},
+                                     [](const DataContainer<RockstarData> &data, const size_t row) {
+                                         return 2. * data.get_data<double>(row, "log_virial_mass_msun");
+                                     });
+    size_t twice_key = rockstar_data.get_internal_key("log_virial_mass_msun_twice");
+    for (size_t i = 0; i < N_halos; i += N_halos / 10) {
+        assert(rockstar_data.get_data<double>(i, twice_key) 
+               == 2. * rockstar_data.get_data<double>(i, log_key));
+    }
+    test_passed("rockstar_data.get_data<double>(i, twice_key)");
+
+    // a derived column without source columns is recomputed after any change
+    rockstar_data.add_derived_column("unlisted_virial_mass", {},
+                                     [mvir_key](const DataContainer<RockstarData> &data,
+                                                const size_t row) {
+                                         return data.get_data<double>(row, mvir_key);
+                                     });
+    assert(rockstar_data.get_data<double>(1, "unlisted_virial_mass") 
+           == rockstar_data.get_data<double>(1, mvir_key));
+    rockstar_data.set_data<double>(1, mvir_key, 2.e12);
+    assert(rockstar_data.get_data<double>(1, "unlisted_virial_mass") == 2.e12);
+    test_passed("rockstar_data.get_data<double>(1, \"unlisted_virial_mass\")");
+
+    // copies do not share any columns
+    auto rockstar_copy = rockstar_data;
+    rockstar_copy.set_data<double>(0, mvir_key, 1.e13);
+    assert(close_enough(rockstar_copy.get_data<double>(0, "log_virial_mass_msun"),
+                        std::log10(1.e13 / hubble_constant)));
+    assert(rockstar_data.get_data<double>(0, mvir_key) == 1.e12);
+    assert(close_enough(rockstar_data.get_data<double>(0, "log_virial_mass_msun"),
+                        std::log10(1.e12 / hubble_constant)));
+    test_passed("rockstar_copy.set_data<double>(0, mvir_key, 1.e13)");
+
+    // a value of the wrong type is rejected and the cell keeps its type
+    bool caught_error = false;
+    try {
+        rockstar_copy.set_data<int64_t>(0, mvir_key, 1);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    assert(rockstar_copy.get_data<double>(0, mvir_key) == 1.e13);
+    assert(rockstar_copy.is_internal_column_double(mvir_key));
+    assert(rockstar_copy.is_internal_column_double(log_key));
+    assert(!rockstar_copy.is_internal_column_double(rockstar_copy.get_internal_key("id")));
+    test_passed("rockstar_copy.set_data<int64_t>(0, mvir_key, 1)");
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+#include <unistd.h>
+#include "../../io/DataIO.hpp"
+#include "../../io/DataHDF5.hpp"
+#include "../test.hpp"
+
+int main() {
+    DataIO<DataContainer<RockstarData>> data_io("../data/out_160.list");
+    data_io.read_header();
+
+    std::vector<std::string> column_mask = {"id", "virial_mass", "x", "type"};
+    DataContainer<RockstarData> rockstar_data(column_mask);
+    size_t N_halos = data_io.read_data_from_file(rockstar_data);
+
+    rockstar_data.add_derived_column("half_mass", "virial_mass",
+                                     [](double mass) { return 0.5 * mass; });
+
+    const std::string file_name = "../bin/hdf5_columns_" + std::to_string(getpid()) + ".h5";
+    HDF5IO<DataContainer<RockstarData>> hdf5_io(file_name);
+
+    auto metadata = HDF5IO<DataContainer<RockstarData>>::read_header_metadata(data_io);
+    // small chunks so that the data is split into many of them
+    hdf5_io.write_data_to_file(rockstar_data, metadata, 6, 1000);
+
+    assert(hdf5_io.get_number_of_rows() == N_halos);
+    test_passed("hdf5_io.get_number_of_rows()");
+
+    auto read_metadata = hdf5_io.read_metadata_from_file();
+    assert(close_enough(read_metadata.box_size, 25.));
+    test_passed("read_metadata.box_size");
+    assert(close_enough(read_metadata.scale_factor, metadata.scale_factor));
+    test_passed("read_metadata.scale_factor");
+    assert(read_metadata.cosmology.size() == 3);
+    assert(close_enough(read_metadata.cosmology[2], 0.6781));
+    test_passed("read_metadata.cosmology");
+
+    // read everything back
+    DataContainer<RockstarData> full_data(column_mask);
+    assert(hdf5_io.read_data_from_file(full_data) == N_halos);
+    test_passed("hdf5_io.read_data_from_file(full_data)");
+
+    size_t mvir_key = rockstar_data.get_internal_key("virial_mass");
+    size_t type_key = rockstar_data.get_internal_key("type");
+    for (size_t row = 0; row < N_halos; row++) {
+        assert(full_data.get_data<double>(row, "virial_mass") 
+               == rockstar_data.get_data<double>(row, mvir_key));
+        assert(full_data.get_data<int64_t>(row, "type") 
+               == rockstar_data.get_data<int64_t>(row, type_key));
+    }
+    test_passed("full_data columns");
+
+    // only some of the rows and columns
+    DataContainer<RockstarData> partial_data(std::vector<std::string>{"virial_mass"});
+    const size_t row_start = 1500;
+    assert(hdf5_io.read_data_from_file(partial_data, row_start, 200) == 200);
+    test_passed("hdf5_io.read_data_from_file(partial_data, row_start, 200)");
+    assert(partial_data.get_number_of_rows() == 200);
+    test_passed("partial_data.get_number_of_rows()");
+
+    for (size_t row = 0; row < 200; row++) {
+        assert(partial_data.get_data<double>(row, "virial_mass") 
+               == rockstar_data.get_data<double>(row_start + row, mvir_key));
+    }
+    test_passed("partial_data columns");
+
+    // a column that is not in the file is found before any column is read
+    DataContainer<RockstarData> missing_data(std::vector<std::string>{"virial_mass", "y"});
+    bool caught_error = false;
+    try {
+        hdf5_io.read_data_from_file(missing_data);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    for (size_t key = 0; key < missing_data.get_column_names().size(); key++) {
+        assert(missing_data.get_column_span(key).size() == 0);
+    }
+    test_passed("hdf5_io.read_data_from_file() with a missing column");
+
+    unlink(file_name.c_str());
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <variant>
+#include "../../io/DataIO.hpp"
+#include "../../tree/Tree.hpp"
+#include "../test.hpp"
+
+int main() {
+    DataIO<DataContainer<RockstarData>> data_io("../data/out_160.list");
+
+    std::vector<std::string> column_mask = {"id", "virial_mass", "x", "y", "z"};
+    DataContainer<RockstarData> rockstar_data(column_mask);
+
+    // estimate before reading anything
+    auto estimate = data_io.estimate_memory_usage(rockstar_data, 400);
+    estimate.print();
+
+    size_t N_halos = data_io.read_data_from_file(rockstar_data);
+
+    assert(estimate.columns == column_mask.size());
+    test_passed("estimate.columns");
+    assert(close_enough((double)estimate.estimated_rows, (double)N_halos));
+    test_passed("estimate.estimated_rows");
+    assert(estimate.estimated_peak_bytes >= estimate.estimated_bytes);
+    test_passed("estimate.estimated_peak_bytes");
+
+    auto report = rockstar_data.get_memory_report();
+    report.print();
+
+    assert(report.entries.size() == column_mask.size());
+    test_passed("report.entries.size()");
+
+    size_t column_index = 0;
+    for (const auto &[name, bytes] : report.entries) {
+        assert(bytes >= N_halos * sizeof(std::variant<double, int64_t>));
+        test_passed("report.entries", column_index);
+        column_index++;
+    }
+
+    assert(report.get_total_bytes() > report.data_bytes);
+    test_passed("report.get_total_bytes()");
+    // the columns keep their spare capacity after reading
+    assert(report.data_bytes <= estimate.estimated_peak_bytes);
+    test_passed("estimate.estimated_peak_bytes");
+
+    // a small hand-made tree
+    auto root_node = std::make_shared<Node>(0, nullptr, 0);
+    root_node->add_child(std::make_shared<Node>(1, nullptr, 1));
+    root_node->add_child(std::make_shared<Node>(2, nullptr, 2));
+    root_node->children_[0]->add_child(std::make_shared<Node>(3, nullptr, 3));
+    Tree tree(root_node, 0, 4);
+
+    assert(tree.get_number_of_nodes() == 4);
+    test_passed("tree.get_number_of_nodes()");
+
+    auto tree_report = tree.get_memory_report();
+    assert(tree_report.entries[0].second >= 4 * sizeof(Node));
+    test_passed("tree_report.entries[0].second");
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include "../../io/Parallel.hpp"
+#include "../test.hpp"
+
+int main() {
+    // every index is visited exactly once
+    std::vector<std::atomic<int>> visits(10000);
+    parallel_for(0, visits.size(), [&](const size_t i) { visits[i]++; }, 4);
+    for (const auto &count : visits) {
+        assert(count == 1);
+    }
+    test_passed("parallel_for()");
+
+    // inner loops run on the thread of the outer chunk, in a single chunk
+    std::atomic<size_t> inner_calls(0);
+    std::atomic<size_t> inner_elsewhere(0);
+    parallel_for_chunks(0, 64, 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            assert(in_parallel_region());
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                const auto outer_thread = std::this_thread::get_id();
+                                parallel_for_chunks(0, 1000, 
+                                                    [&](const size_t inner_begin, const size_t inner_end) {
+                                                        inner_calls++;
+                                                        if (std::this_thread::get_id() != outer_thread
+                                                            || inner_begin != 0 || inner_end != 1000) {
+                                                            inner_elsewhere++;
+                                                        }
+                                                    }, 4, 10);
+                            }
+                        }, 4, 1);
+    assert(inner_calls == 64);
+    assert(inner_elsewhere == 0);
+    assert(!in_parallel_region());
+    test_passed("nested parallel_for_chunks()");
+
+    // the flag is restored when a chunk throws
+    bool threw = false;
+    try {
+        parallel_for_chunks(0, 100, 
+                            [](const size_t, const size_t) { throw std::runtime_error("chunk"); }, 
+                            4, 1);
+    }
+    catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw && !in_parallel_region());
+    test_passed("parallel_for_chunks() exceptions");
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../../io/DataIO.hpp"
+#include "../../io/SharedCatalog.hpp"
+#include "../test.hpp"
+
+template <typename Catalog>
+bool catalog_matches(const Catalog &catalog,
+                     const DataContainer<RockstarData> &rockstar_data) {
+    size_t mvir_key = rockstar_data.get_internal_key("virial_mass");
+    size_t id_key = rockstar_data.get_internal_key("id");
+    size_t shared_mvir_key = catalog.get_internal_key("virial_mass");
+    size_t shared_id_key = catalog.get_internal_key("id");
+
+    if (catalog.get_number_of_rows() != rockstar_data.get_number_of_rows()) {
+        return false;
+    }
+
+    const double *masses = catalog.template get_column<double>(shared_mvir_key);
+    for (size_t i = 0; i < catalog.get_number_of_rows(); i++) {
+        if (masses[i] != rockstar_data.get_data<double>(i, mvir_key)) {
+            return false;
+        }
+        if (catalog.template get_data<int64_t>(i, shared_id_key) 
+            != rockstar_data.get_data<int64_t>(i, id_key)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    DataIO<DataContainer<RockstarData>> data_io("../data/out_161.list");
+
+    std::vector<std::string> column_mask = {"id", "virial_mass"};
+    DataContainer<RockstarData> rockstar_data(column_mask);
+    data_io.read_data_from_file(rockstar_data);
+
+    rockstar_data.add_derived_column("double_mass", "virial_mass",
+                                     [](double mass) { return 2. * mass; });
+
+    const std::string segment_name = "/hdm_test_" + std::to_string(getpid());
+    SharedCatalog<RockstarData>::publish(rockstar_data, segment_name);
+
+    {
+        SharedCatalog<RockstarData> catalog(segment_name);
+        assert(catalog.get_number_of_columns() == 3);
+        test_passed("catalog.get_number_of_columns()");
+        assert(catalog_matches(catalog, rockstar_data));
+        test_passed("catalog_matches(catalog, rockstar_data)");
+        assert(close_enough(catalog.get_data<double>(3, "double_mass"),
+                            2. * rockstar_data.get_data<double>(3, "virial_mass")));
+        test_passed("catalog.get_data<double>(3, \"double_mass\")");
+        assert(!catalog.is_column_double(catalog.get_internal_key("id")));
+        test_passed("catalog.is_column_double()");
+
+        bool thrown = false;
+        try {
+            catalog.get_data<double>(3, catalog.get_internal_key("id"));
+        }
+        catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+        test_passed("catalog.get_data() with the wrong type");
+    }
+
+    // without any rows, the columns still get their declared types
+    {
+        DataContainer<RockstarData> empty_data(column_mask);
+        empty_data.add_derived_column("double_mass", "virial_mass",
+                                      [](double mass) { return 2. * mass; });
+        const std::string empty_name = segment_name + "_empty";
+        SharedCatalog<RockstarData>::publish(empty_data, empty_name);
+        SharedCatalog<RockstarData> catalog(empty_name);
+        assert(catalog.get_number_of_rows() == 0);
+        assert(!catalog.is_column_double(catalog.get_internal_key("id")));
+        assert(catalog.is_column_double(catalog.get_internal_key("virial_mass")));
+        assert(catalog.is_column_double(catalog.get_internal_key("double_mass")));
+        SharedCatalog<RockstarData>::remove(empty_name);
+    }
+    test_passed("SharedCatalog::publish() without rows");
+
+    // attach from another process
+    pid_t child = fork();
+    if (child == 0) {
+        SharedCatalog<RockstarData> catalog(segment_name);
+        _exit(catalog_matches(catalog, rockstar_data) ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    test_passed("catalog_matches() in child process");
+
+    SharedCatalog<RockstarData>::remove(segment_name);
+
+    // the same, backed by a file
+    const std::string file_name = "../bin/shared_catalog_" + std::to_string(getpid()) + ".bin";
+    SharedCatalog<RockstarData>::publish(rockstar_data, file_name, true);
+    {
+        SharedCatalog<RockstarData> catalog(file_name, true);
+        assert(catalog_matches(catalog, rockstar_data));
+        test_passed("catalog_matches() for a file-backed catalog");
+    }
+    SharedCatalog<RockstarData>::remove(file_name, true);
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/AncestryIndex.hpp"
+#include "../../io/DataIO.hpp"
+
+// the rows of a node and all of its descendants, by walking the parents
+std::vector<size_t> get_descendant_rows(std::shared_ptr<Node> node) {
+    std::vector<size_t> rows;
+    while (node != nullptr) {
+        rows.push_back(node->get_data_row());
+        node = node->get_parent();
+    }
+
+    return rows;
+}
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    // every node of the forest by row
+    std::vector<std::shared_ptr<Node>> nodes(N_halos_in_tree);
+    for (const auto &tree : forest.trees_) {
+        std::vector<std::shared_ptr<Node>> to_visit = {tree->root_node_};
+        while (!to_visit.empty()) {
+            auto node = to_visit.back();
+            to_visit.pop_back();
+            nodes[node->get_data_row()] = node;
+            for (const auto &child : node->children_) {
+                to_visit.push_back(child);
+            }
+        }
+    }
+
+    AncestryIndex forest_index;
+    forest_index.build(forest, true, 2);
+    assert(forest_index.has_lca_table());
+
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        assert(forest_index.contains(row));
+        const auto descendant_rows = get_descendant_rows(nodes[row]);
+        assert(forest_index.get_depth(row) == descendant_rows.size() - 1);
+        assert(forest_index.get_root_row(row) == descendant_rows.back());
+        assert(forest_index.get_subtree_size(row) >= 1);
+    }
+    assert(!forest_index.contains(N_halos_in_tree));
+    test_passed("AncestryIndex::build(forest)");
+
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<size_t> random_row(0, N_halos_in_tree - 1);
+    for (size_t i = 0; i < 20000; i++) {
+        const size_t row_a = random_row(generator);
+        // mostly pairs from the same tree, which are the interesting ones
+        const size_t root_row = forest_index.get_root_row(row_a);
+        std::uniform_int_distribution<size_t> tree_row(
+            root_row, root_row + forest_index.get_subtree_size(root_row) - 1
+        );
+        const size_t row_b = (i % 4 == 0) ? random_row(generator) : tree_row(generator);
+
+        const auto descendants_a = get_descendant_rows(nodes[row_a]);
+        const auto descendants_b = get_descendant_rows(nodes[row_b]);
+        const bool a_in_b = std::find(descendants_a.begin(), descendants_a.end(), row_b) 
+                            != descendants_a.end();
+        assert(forest_index.is_progenitor(row_a, row_b) == a_in_b);
+
+        // the first common row, walking down from a
+        size_t expected = AncestryIndex::npos;
+        for (const auto row : descendants_a) {
+            if (std::find(descendants_b.begin(), descendants_b.end(), row) != descendants_b.end()) {
+                expected = row;
+                break;
+            }
+        }
+        assert(forest_index.lowest_common_ancestor(row_a, row_b) == expected);
+    }
+    test_passed("forest_index.is_progenitor()");
+    test_passed("forest_index.lowest_common_ancestor()");
+
+    // a single tree, without the LCA table
+    const auto &tree = forest.get_tree(0);
+    AncestryIndex tree_index;
+    tree_index.build(*tree);
+    assert(!tree_index.has_lca_table());
+    for (size_t row = tree->root_node_row_in_data_; row < tree->next_root_node_row_in_data_; row++) {
+        assert(tree_index.get_entry(row) == forest_index.get_entry(row));
+        assert(tree_index.get_exit(row) == forest_index.get_exit(row));
+        assert(tree_index.get_root_row(row) == tree->root_node_row_in_data_);
+    }
+    assert(tree_index.get_subtree_size(tree->root_node_row_in_data_) == tree->get_number_of_nodes());
+
+    bool caught_error = false;
+    try {
+        tree_index.lowest_common_ancestor(tree->root_node_row_in_data_, tree->root_node_row_in_data_);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    assert(tree_index.get_memory_bytes() < forest_index.get_memory_bytes());
+    test_passed("AncestryIndex::build(tree)");
+
+    // the rows below the depth limit of a lazy tree have no node, so every
+    // query on them throws
+    size_t largest_tree = 0;
+    for (size_t t = 1; t < forest.get_number_of_trees(); t++) {
+        if (forest.get_tree(t)->get_number_of_nodes() 
+            > forest.get_tree(largest_tree)->get_number_of_nodes()) {
+            largest_tree = t;
+        }
+    }
+    const auto &full_tree = forest.get_tree(largest_tree);
+    LazyTreeLimits limits;
+    limits.max_depth = 1;
+    Tree shallow_tree(nullptr, full_tree->root_node_row_in_data_, 
+                      full_tree->next_root_node_row_in_data_);
+    shallow_tree.build_tree_lazy(consistent_trees_data, limits);
+    shallow_tree.expand_tree(consistent_trees_data);
+
+    AncestryIndex shallow_index;
+    shallow_index.build(shallow_tree, true);
+    const size_t root_row = shallow_tree.root_node_row_in_data_;
+    const size_t unindexed_row = full_tree->root_node_->children_[0]->children_[0]->get_data_row();
+    assert(shallow_index.contains(root_row));
+    assert(!shallow_index.contains(unindexed_row));
+
+    const std::vector<std::function<void(void)>> queries = {
+        [&]() { shallow_index.get_entry(unindexed_row); },
+        [&]() { shallow_index.get_depth(unindexed_row); },
+        [&]() { shallow_index.is_progenitor(unindexed_row, root_row); },
+        [&]() { shallow_index.get_root_row(unindexed_row); },
+        [&]() { shallow_index.get_root_row(full_tree->next_root_node_row_in_data_); },
+        [&]() { shallow_index.lowest_common_ancestor(unindexed_row, root_row); },
+        [&]() { shallow_index.lowest_common_ancestor(root_row, unindexed_row); }
+    };
+    for (const auto &query : queries) {
+        caught_error = false;
+        try {
+            query();
+        }
+        catch (const std::runtime_error &) {
+            caught_error = true;
+        }
+        assert(caught_error);
+    }
+    test_passed("AncestryIndex with an unindexed row");
+
+    return 0;
+}
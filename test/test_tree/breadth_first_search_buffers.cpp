@@ -0,0 +1,118 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <functional>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/FlatTree.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    std::vector<size_t> root_node_indices;
+    for (size_t i = 0; i < N_halos_in_tree; i++) {
+        if (consistent_trees_data.get_data<int64_t>(i, descendant_id_key) == -1) {
+            root_node_indices.push_back(i);
+        }
+    }
+    root_node_indices.push_back(N_halos_in_tree);
+
+    std::vector<Tree> trees;
+    std::vector<FlatTree> flat_trees;
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        const auto root_node_index = root_node_indices[i];
+        const auto next_root_node_index = root_node_indices[i + 1];
+        int64_t id = consistent_trees_data.get_data<int64_t>(root_node_index, id_key);
+
+        trees.emplace_back(std::make_shared<Node>(root_node_index, nullptr, id),
+                           root_node_index, next_root_node_index);
+        trees.back().build_tree(consistent_trees_data, TreeBuildMode::adjacency);
+
+        flat_trees.emplace_back(root_node_index, next_root_node_index);
+        flat_trees.back().build_tree(consistent_trees_data);
+    }
+
+    TreeScratch scratch;
+    std::vector<size_t> rows;
+    std::vector<FlatTree::NodeIndex> flat_nodes, flat_queue;
+
+    // the first pass grows the buffers, the second pass must not allocate
+    for (int pass = 0; pass < 2; pass++) {
+        const auto rows_capacity = rows.capacity();
+        const auto queue_capacity = scratch.node_queue.capacity();
+        const auto flat_nodes_capacity = flat_nodes.capacity();
+        const auto flat_queue_capacity = flat_queue.capacity();
+
+        for (size_t i = 0; i < trees.size(); i++) {
+            auto nodes = trees[i].breadth_first_search(consistent_trees_data, 
+                                                       trees[i].root_node_,
+                                                       virial_mass_key, 1.e11, 
+                                                       std::greater<double>());
+            auto total_rows = trees[i].breadth_first_search(consistent_trees_data,
+                                                            trees[i].root_node_,
+                                                            virial_mass_key, 1.e11,
+                                                            std::greater<double>(),
+                                                            rows, scratch);
+            assert(total_rows == nodes.size());
+            assert(rows.size() == nodes.size());
+            for (size_t j = 0; j < nodes.size(); j++) {
+                assert(rows[j] == nodes[j]->get_data_row());
+            }
+
+            auto total_flat_nodes = flat_trees[i].breadth_first_search(consistent_trees_data,
+                                                                       flat_trees[i].get_root_node(),
+                                                                       virial_mass_key, 1.e11,
+                                                                       std::greater<double>(),
+                                                                       flat_nodes, flat_queue);
+            assert(total_flat_nodes == nodes.size());
+            for (size_t j = 0; j < flat_nodes.size(); j++) {
+                assert(flat_trees[i].get_data_row(flat_nodes[j]) == rows[j]);
+            }
+        }
+
+        if (pass == 1) {
+            assert(rows.capacity() == rows_capacity);
+            assert(scratch.node_queue.capacity() == queue_capacity);
+            assert(flat_nodes.capacity() == flat_nodes_capacity);
+            assert(flat_queue.capacity() == flat_queue_capacity);
+        }
+    }
+    test_passed("tree.breadth_first_search(rows, scratch)");
+    test_passed("flat_tree.breadth_first_search(nodes, to_visit)");
+
+    return 0;
+}
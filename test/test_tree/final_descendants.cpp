@@ -0,0 +1,116 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/FinalDescendants.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    // the root of every row, and the longest descendant line, from the trees
+    std::vector<size_t> expected_final_rows(N_halos_in_tree);
+    size_t max_depth = 0;
+    for (const auto &tree : forest.trees_) {
+        std::vector<std::pair<std::shared_ptr<Node>, size_t>> to_visit = {
+            std::make_pair(tree->root_node_, 0)
+        };
+        while (!to_visit.empty()) {
+            auto [node, depth] = to_visit.back();
+            to_visit.pop_back();
+
+            expected_final_rows[node->get_data_row()] = tree->root_node_row_in_data_;
+            max_depth = std::max(max_depth, depth);
+            for (const auto &child : node->children_) {
+                to_visit.push_back(std::make_pair(child, depth + 1));
+            }
+        }
+    }
+
+    for (const size_t threads : {1, 4}) {
+        FinalDescendants final_descendants;
+        final_descendants.build(consistent_trees_data, threads);
+        assert(final_descendants.get_number_of_rows() == N_halos_in_tree);
+        assert(final_descendants.get_final_rows() == expected_final_rows);
+
+        // log2 of the longest line, plus the round that finds no change
+        size_t expected_rounds = 1;
+        while (((size_t)1 << (expected_rounds - 1)) < max_depth) {
+            expected_rounds++;
+        }
+        assert(final_descendants.get_number_of_rounds() == expected_rounds);
+
+        auto final_masses = final_descendants.get_final_values(consistent_trees_data, 
+                                                               virial_mass_key, threads);
+        for (size_t row = 0; row < N_halos_in_tree; row++) {
+            assert(final_masses[row] == consistent_trees_data.get_data<double>(
+                expected_final_rows[row], virial_mass_key
+            ));
+        }
+    }
+    test_passed("final_descendants.build()");
+    test_passed("final_descendants.get_final_values()");
+
+    // a root followed by three halos whose descendants form a cycle
+    DataContainer<ConsistentTreesData> cycle_data({"id", "descendant_id", "scale", "virial_mass"});
+    auto cycle_id_key = cycle_data.get_internal_key("id");
+    auto cycle_descendant_id_key = cycle_data.get_internal_key("descendant_id");
+    auto cycle_scale_key = cycle_data.get_internal_key("scale");
+    auto cycle_virial_mass_key = cycle_data.get_internal_key("virial_mass");
+    const std::vector<std::pair<int64_t, int64_t>> cycle_ids = {{0, -1}, {1, 2}, {2, 3}, {3, 1}};
+    for (const auto &[id, descendant_id] : cycle_ids) {
+        cycle_data.data_[cycle_id_key]->push_back(id);
+        cycle_data.data_[cycle_descendant_id_key]->push_back(descendant_id);
+        cycle_data.data_[cycle_scale_key]->push_back(1.);
+        cycle_data.data_[cycle_virial_mass_key]->push_back(1.e12);
+    }
+
+    bool thrown = false;
+    try {
+        FinalDescendants cycle_final_descendants;
+        cycle_final_descendants.build(cycle_data, 1);
+    }
+    catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    test_passed("final_descendants.build() with a cycle");
+
+    return 0;
+}
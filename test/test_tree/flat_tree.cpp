@@ -0,0 +1,119 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <functional>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/FlatTree.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    std::vector<size_t> root_node_indices;
+    for (size_t i = 0; i < N_halos_in_tree; i++) {
+        if (consistent_trees_data.get_data<int64_t>(i, descendant_id_key) == -1) {
+            root_node_indices.push_back(i);
+        }
+    }
+    root_node_indices.push_back(N_halos_in_tree);
+
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        const auto root_node_index = root_node_indices[i];
+        const auto next_root_node_index = root_node_indices[i + 1];
+        int64_t id = consistent_trees_data.get_data<int64_t>(root_node_index, id_key);
+
+        Tree tree(std::make_shared<Node>(root_node_index, nullptr, id),
+                  root_node_index, next_root_node_index);
+        tree.build_tree(consistent_trees_data, TreeBuildMode::adjacency);
+
+        FlatTree flat_tree(root_node_index, next_root_node_index);
+        flat_tree.build_tree(consistent_trees_data);
+
+        assert(flat_tree.get_number_of_nodes() == tree.get_number_of_nodes());
+
+        // the flat nodes are in depth-first order
+        std::vector<std::shared_ptr<Node>> to_visit = {tree.root_node_};
+        FlatTree::NodeIndex flat_node = 0;
+        while (!to_visit.empty()) {
+            auto node = to_visit.back();
+            to_visit.pop_back();
+
+            assert(flat_tree.get_data_row(flat_node) == node->get_data_row());
+            assert(flat_tree.get_number_of_children(flat_node) == node->children_.size());
+            if (node->get_parent() != nullptr) {
+                assert(flat_tree.get_data_row(flat_tree.get_parent(flat_node))
+                       == node->get_parent()->get_data_row());
+            }
+            else {
+                assert(flat_tree.get_parent(flat_node) == FlatTree::null_node);
+            }
+
+            for (auto child = node->children_.rbegin(); child != node->children_.rend(); child++) {
+                to_visit.push_back(*child);
+            }
+            flat_node++;
+        }
+
+        std::vector<double> mass_list, flat_mass_list;
+        tree.traverse_most_massive_branch(consistent_trees_data, tree.root_node_,
+                                          virial_mass_key, mass_list);
+        flat_tree.traverse_most_massive_branch(consistent_trees_data, flat_tree.get_root_node(),
+                                               virial_mass_key, flat_mass_list);
+        assert(mass_list == flat_mass_list);
+
+        auto nodes = tree.breadth_first_search(consistent_trees_data, tree.root_node_,
+                                               virial_mass_key, 1.e12, 
+                                               std::greater<double>());
+        auto flat_nodes = flat_tree.breadth_first_search(consistent_trees_data, 
+                                                         flat_tree.get_root_node(),
+                                                         virial_mass_key, 1.e12, 
+                                                         std::greater<double>());
+        assert(nodes.size() == flat_nodes.size());
+        for (size_t j = 0; j < nodes.size(); j++) {
+            assert(nodes[j]->get_data_row() == flat_tree.get_data_row(flat_nodes[j]));
+        }
+
+        assert(flat_tree.get_memory_report().data_bytes 
+               <= 16 * flat_tree.get_number_of_nodes() + 4 * sizeof(std::vector<int32_t>));
+    }
+    test_passed("flat_tree.get_data_row()");
+    test_passed("flat_tree.get_parent()");
+    test_passed("flat_tree.traverse_most_massive_branch()");
+    test_passed("flat_tree.breadth_first_search()");
+    test_passed("flat_tree.get_memory_report()");
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+#include <unordered_map>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/FlatTree.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "is_most_massive_progenitor", "depth_first_id", 
+      "next_coprogenitor_depthfirst_id", "last_progenitor_depthfirst_id", 
+      "last_mainleaf_depthfirst_id"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+    auto most_massive_key = consistent_trees_data.get_internal_key("is_most_massive_progenitor");
+
+    std::vector<size_t> root_node_indices;
+    for (size_t i = 0; i < N_halos_in_tree; i++) {
+        if (consistent_trees_data.get_data<int64_t>(i, descendant_id_key) == -1) {
+            root_node_indices.push_back(i);
+        }
+    }
+    root_node_indices.push_back(N_halos_in_tree);
+
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        const auto root_node_index = root_node_indices[i];
+        const auto next_root_node_index = root_node_indices[i + 1];
+
+        FlatTree flat_tree(root_node_index, next_root_node_index);
+        flat_tree.build_tree(consistent_trees_data);
+        flat_tree.compute_depth_first_ranges();
+
+        FlatTree depth_first_tree(root_node_index, next_root_node_index);
+        depth_first_tree.build_tree_from_depth_first(consistent_trees_data);
+
+        const auto total_nodes = (FlatTree::NodeIndex)flat_tree.get_number_of_nodes();
+        assert(depth_first_tree.get_number_of_nodes() == flat_tree.get_number_of_nodes());
+        assert(depth_first_tree.get_data_row(depth_first_tree.get_root_node()) == root_node_index);
+
+        // the children may be in a different order, so compare by data row
+        std::unordered_map<size_t, FlatTree::NodeIndex> row_to_node;
+        for (FlatTree::NodeIndex node = 0; node < total_nodes; node++) {
+            row_to_node[flat_tree.get_data_row(node)] = node;
+        }
+
+        for (FlatTree::NodeIndex node = 0; node < total_nodes; node++) {
+            const auto flat_node = row_to_node.at(depth_first_tree.get_data_row(node));
+            const auto parent = depth_first_tree.get_parent(node);
+            if (parent == FlatTree::null_node) {
+                assert(flat_tree.get_parent(flat_node) == FlatTree::null_node);
+            }
+            else {
+                assert(depth_first_tree.get_data_row(parent)
+                       == flat_tree.get_data_row(flat_tree.get_parent(flat_node)));
+                assert(depth_first_tree.is_progenitor(node, parent));
+                assert(!depth_first_tree.is_progenitor(parent, node));
+            }
+            assert(depth_first_tree.get_number_of_children(node) 
+                   == flat_tree.get_number_of_children(flat_node));
+
+            const auto range = depth_first_tree.get_subtree_range(node);
+            const auto flat_range = flat_tree.get_subtree_range(flat_node);
+            assert(range.second - range.first == flat_range.second - flat_range.first);
+
+            // the main branch follows the most massive progenitors
+            const auto main_branch = depth_first_tree.get_main_branch_range(node);
+            assert(main_branch.second <= range.second);
+            for (auto j = main_branch.first + 1; j < main_branch.second; j++) {
+                assert(depth_first_tree.get_parent(j) == j - 1);
+                assert(consistent_trees_data.get_data<int64_t>(depth_first_tree.get_data_row(j),
+                                                               most_massive_key) == 1);
+            }
+            assert(depth_first_tree.get_first_child(main_branch.second - 1) 
+                   == FlatTree::null_node);
+        }
+    }
+    test_passed("flat_tree.build_tree_from_depth_first()");
+    test_passed("flat_tree.compute_depth_first_ranges()");
+    test_passed("flat_tree.get_subtree_range()");
+    test_passed("flat_tree.get_main_branch_range()");
+    test_passed("flat_tree.is_progenitor()");
+
+    // whether building the first tree is rejected
+    auto first_tree_rejected = [&]() {
+        try {
+            FlatTree first_tree(root_node_indices[0], root_node_indices[1]);
+            first_tree.build_tree_from_depth_first(consistent_trees_data);
+        }
+        catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    assert(!first_tree_rejected());
+
+    // a next co-progenitor that points back at the halo itself is rejected
+    auto depth_first_key = consistent_trees_data.get_internal_key("depth_first_id");
+    auto next_coprogenitor_key 
+        = consistent_trees_data.get_internal_key("next_coprogenitor_depthfirst_id");
+    auto last_mainleaf_key 
+        = consistent_trees_data.get_internal_key("last_mainleaf_depthfirst_id");
+    size_t coprogenitor_row = root_node_indices[0];
+    while (consistent_trees_data.get_data<int64_t>(coprogenitor_row, next_coprogenitor_key) == -1) {
+        coprogenitor_row++;
+    }
+    assert(coprogenitor_row < root_node_indices[1]);
+    const auto next_coprogenitor_id 
+        = consistent_trees_data.get_data<int64_t>(coprogenitor_row, next_coprogenitor_key);
+
+    consistent_trees_data.set_data<int64_t>(
+        coprogenitor_row, next_coprogenitor_key,
+        consistent_trees_data.get_data<int64_t>(coprogenitor_row, depth_first_key)
+    );
+    assert(first_tree_rejected());
+    test_passed("flat_tree.build_tree_from_depth_first() with a cyclic co-progenitor");
+
+    // a missing co-progenitor link leaves a halo without a descendant
+    consistent_trees_data.set_data<int64_t>(coprogenitor_row, next_coprogenitor_key, -1);
+    assert(first_tree_rejected());
+    consistent_trees_data.set_data<int64_t>(coprogenitor_row, next_coprogenitor_key,
+                                            next_coprogenitor_id);
+    assert(!first_tree_rejected());
+    test_passed("flat_tree.build_tree_from_depth_first() with an orphan halo");
+
+    // a main branch that ends before the halo itself
+    const size_t mainleaf_row = root_node_indices[0] + 1;
+    const auto last_mainleaf_id 
+        = consistent_trees_data.get_data<int64_t>(mainleaf_row, last_mainleaf_key);
+    consistent_trees_data.set_data<int64_t>(
+        mainleaf_row, last_mainleaf_key,
+        consistent_trees_data.get_data<int64_t>(root_node_indices[0], depth_first_key)
+    );
+    assert(first_tree_rejected());
+    consistent_trees_data.set_data<int64_t>(mainleaf_row, last_mainleaf_key, last_mainleaf_id);
+    assert(!first_tree_rejected());
+    test_passed("flat_tree.build_tree_from_depth_first() with an inverted main branch");
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../io/DataIO.hpp"
+#include "test_tree.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+
+    std::vector<size_t> root_node_indices;
+    for (size_t i = 0; i < N_halos_in_tree; i++) {
+        if (consistent_trees_data.get_data<int64_t>(i, descendant_id_key) == -1) {
+            root_node_indices.push_back(i);
+        }
+    }
+    assert(Forest::find_root_rows(consistent_trees_data) == root_node_indices);
+    test_passed("Forest::find_root_rows()");
+    root_node_indices.push_back(N_halos_in_tree);
+
+    Forest serial_forest;
+    serial_forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 1);
+    assert(serial_forest.get_number_of_trees() == root_node_indices.size() - 1);
+    assert(serial_forest.get_number_of_nodes() == N_halos_in_tree);
+
+    for (const auto mode : {TreeBuildMode::adjacency, TreeBuildMode::iterative}) {
+        Forest forest;
+        forest.build_forest(consistent_trees_data, mode, 4);
+        assert(forest.get_number_of_trees() == serial_forest.get_number_of_trees());
+
+        // in root row order, and the same trees as the serial build
+        for (size_t i = 0; i < forest.get_number_of_trees(); i++) {
+            const auto &tree = forest.get_tree(i);
+            assert(tree->root_node_row_in_data_ == root_node_indices[i]);
+            assert(tree->next_root_node_row_in_data_ == root_node_indices[i + 1]);
+            assert(flatten_tree(tree->root_node_) 
+                   == flatten_tree(serial_forest.get_tree(i)->root_node_));
+        }
+    }
+    test_passed("forest.build_forest()");
+
+    assert(serial_forest.get_memory_report().data_bytes > 0);
+    test_passed("forest.get_memory_report()");
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <limits>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/FlatTree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/ForestFile.hpp"
+#include "../../io/DataIO.hpp"
+#include "test_tree.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    const std::string file_name = "../bin/forest_file_" + std::to_string(getpid()) + ".bin";
+    ForestFile::write(forest, file_name, 2);
+
+    ForestFile forest_file(file_name);
+    assert(forest_file.get_number_of_trees() == forest.get_number_of_trees());
+    assert(forest_file.get_number_of_nodes() == N_halos_in_tree);
+    test_passed("ForestFile::write()");
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    for (size_t i = 0; i < forest.get_number_of_trees(); i++) {
+        const auto &tree = forest.get_tree(i);
+        assert(forest_file.get_root_row(i) == tree->root_node_row_in_data_);
+        assert(forest_file.get_next_root_row(i) == tree->next_root_node_row_in_data_);
+        assert(forest_file.get_number_of_nodes(i) == tree->get_number_of_nodes());
+
+        auto loaded_tree = forest_file.get_tree(i);
+        assert(flatten_tree(loaded_tree->root_node_) == flatten_tree(tree->root_node_));
+
+        FlatTree flat_tree(tree->root_node_row_in_data_, tree->next_root_node_row_in_data_);
+        flat_tree.build_tree(consistent_trees_data);
+        auto loaded_flat_tree = forest_file.get_flat_tree(i);
+        assert(loaded_flat_tree.get_number_of_nodes() == flat_tree.get_number_of_nodes());
+        for (FlatTree::NodeIndex node = 0; 
+             node < (FlatTree::NodeIndex)flat_tree.get_number_of_nodes(); node++) {
+            assert(loaded_flat_tree.get_parent(node) == flat_tree.get_parent(node));
+            assert(loaded_flat_tree.get_first_child(node) == flat_tree.get_first_child(node));
+            assert(loaded_flat_tree.get_next_sibling(node) == flat_tree.get_next_sibling(node));
+            assert(loaded_flat_tree.get_data_row(node) == flat_tree.get_data_row(node));
+        }
+    }
+    test_passed("forest_file.get_tree()");
+    test_passed("forest_file.get_flat_tree()");
+
+    // random access by the id of the root
+    for (size_t i = 0; i < forest.get_number_of_trees(); i++) {
+        const auto root_id = consistent_trees_data.get_data<int64_t>(
+            forest.get_tree(i)->root_node_row_in_data_, id_key
+        );
+        assert(forest_file.get_root_id(i) == root_id);
+        assert(forest_file.has_tree(root_id));
+        assert(forest_file.get_tree_index(root_id) == i);
+    }
+    assert(!forest_file.has_tree(-2));
+    bool caught_error = false;
+    try {
+        forest_file.get_tree_index(-2);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    test_passed("forest_file.get_tree_index()");
+
+    Forest loaded_forest;
+    forest_file.load_forest(loaded_forest, 2, true);
+    assert(loaded_forest.get_number_of_trees() == forest.get_number_of_trees());
+    assert(loaded_forest.get_number_of_nodes() == forest.get_number_of_nodes());
+    for (size_t i = 0; i < forest.get_number_of_trees(); i++) {
+        assert(flatten_tree(loaded_forest.get_tree(i)->root_node_) 
+               == flatten_tree(forest.get_tree(i)->root_node_));
+    }
+    test_passed("forest_file.load_forest()");
+
+    // anything that is not a complete forest file is rejected
+    ForestFile moved_file(std::move(forest_file));
+    assert(moved_file.get_number_of_trees() == forest.get_number_of_trees());
+    caught_error = false;
+    try {
+        moved_file.get_root_id(moved_file.get_number_of_trees());
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    assert(truncate(file_name.c_str(), 100) == 0);
+    caught_error = false;
+    try {
+        ForestFile truncated_file(file_name);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+
+    // a header whose node count does not match the size of the file
+    ForestFile::write(forest, file_name);
+    const uint64_t corrupted_nodes = std::numeric_limits<uint64_t>::max() / 2;
+    int file_descriptor = open(file_name.c_str(), O_WRONLY);
+    assert(file_descriptor >= 0);
+    assert(pwrite(file_descriptor, &corrupted_nodes, sizeof(corrupted_nodes), 
+                  8 + 2 * sizeof(uint64_t)) == sizeof(corrupted_nodes));
+    close(file_descriptor);
+    caught_error = false;
+    try {
+        ForestFile corrupted_file(file_name);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+
+    // a parent that points past its child in the first tree
+    ForestFile::write(forest, file_name);
+    assert(forest.get_tree(0)->get_number_of_nodes() > 2);
+    uint64_t parent_offset = 0;
+    const FlatTree::NodeIndex corrupted_parent = 2;
+    file_descriptor = open(file_name.c_str(), O_RDWR);
+    assert(file_descriptor >= 0);
+    assert(pread(file_descriptor, &parent_offset, sizeof(parent_offset),
+                 8 + 6 * sizeof(uint64_t)) == sizeof(parent_offset));
+    assert(pwrite(file_descriptor, &corrupted_parent, sizeof(corrupted_parent),
+                  parent_offset + sizeof(FlatTree::NodeIndex)) == sizeof(corrupted_parent));
+    close(file_descriptor);
+    ForestFile corrupted_parent_file(file_name);
+    caught_error = false;
+    try {
+        corrupted_parent_file.get_tree(0);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    caught_error = false;
+    try {
+        corrupted_parent_file.get_flat_tree(0);
+    }
+    catch (const std::runtime_error &) {
+        caught_error = true;
+    }
+    assert(caught_error);
+    test_passed("ForestFile format check");
+
+    unlink(file_name.c_str());
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <numeric>
+#include <cmath>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Forest.hpp"
+#include "../../tree/FormationTime.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    // a hand-made branch from the root to the earliest progenitor
+    const std::vector<double> masses = {100., 80., 40., 4.};
+    const std::vector<double> scales = {1., 0.8, 0.6, 0.4};
+    const std::vector<double> ratios = {0.9, 0.5, 0.01};
+
+    std::vector<double> formation_scales(ratios.size());
+    FormationTime(ratios, FormationInterpolation::first_below)
+        .compute_branch(masses.data(), scales.data(), masses.size(), formation_scales.data());
+    assert(formation_scales == std::vector<double>({0.8, 0.6, -1.}));
+
+    FormationTime(ratios, FormationInterpolation::midpoint)
+        .compute_branch(masses.data(), scales.data(), masses.size(), formation_scales.data());
+    assert(close_enough(formation_scales[0], 0.9));
+    assert(close_enough(formation_scales[1], 0.7));
+    assert(formation_scales[2] == -1.);
+
+    FormationTime(ratios, FormationInterpolation::linear, 0.)
+        .compute_branch(masses.data(), scales.data(), masses.size(), formation_scales.data());
+    assert(close_enough(formation_scales[0], 0.9));
+    assert(close_enough(formation_scales[1], 0.65));
+    assert(formation_scales[2] == 0.);
+
+    FormationTime(ratios, FormationInterpolation::log_linear)
+        .compute_branch(masses.data(), scales.data(), masses.size(), formation_scales.data());
+    const double weight = std::log(80. / 50.) / std::log(80. / 40.);
+    assert(close_enough(formation_scales[1], 0.8 - 0.2 * weight));
+    test_passed("formation_time.compute_branch()");
+
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto scale_key = consistent_trees_data.get_internal_key("scale");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data);
+    std::vector<size_t> tree_indices(forest.get_number_of_trees());
+    std::iota(tree_indices.begin(), tree_indices.end(), 0);
+
+    const std::vector<double> assembly_ratios = {0.05, 0.1, 0.5};
+    for (const auto interpolation : {FormationInterpolation::first_below, 
+                                     FormationInterpolation::midpoint,
+                                     FormationInterpolation::linear,
+                                     FormationInterpolation::log_linear}) {
+        const FormationTime formation_time(assembly_ratios, interpolation);
+        const auto forest_scales = formation_time.compute(consistent_trees_data, forest.trees_,
+                                                          tree_indices, 4);
+        const auto streamed_scales = formation_time.compute(consistent_trees_data, 4);
+        assert(forest_scales == streamed_scales);
+        assert(forest_scales.size() == assembly_ratios.size() * tree_indices.size());
+
+        if (interpolation != FormationInterpolation::midpoint) {
+            continue;
+        }
+
+        // the same as the loop in examples/tree/assembly_time_all_trees.cpp
+        for (size_t t = 0; t < tree_indices.size(); t++) {
+            const auto &tree = forest.get_tree(t);
+            std::vector<double> mmp_virial_masses, scale_factors;
+            tree->traverse_most_massive_branch(consistent_trees_data, tree->root_node_,
+                                               virial_mass_key, mmp_virial_masses);
+            tree->traverse_most_massive_branch(consistent_trees_data, tree->root_node_,
+                                               scale_key, scale_factors);
+
+            for (size_t r = 0; r < assembly_ratios.size(); r++) {
+                double assembly_scale = -1.;
+                for (size_t i = 0; i < mmp_virial_masses.size(); i++) {
+                    if (mmp_virial_masses[i] < assembly_ratios[r] * mmp_virial_masses[0]) {
+                        assembly_scale = (i > 0) ? 0.5 * (scale_factors[i - 1] + scale_factors[i])
+                                                 : scale_factors[0];
+                        break;
+                    }
+                }
+                assert(forest_scales[t * assembly_ratios.size() + r] == assembly_scale);
+            }
+        }
+    }
+    test_passed("formation_time.compute()");
+
+    return 0;
+}
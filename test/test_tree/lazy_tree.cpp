@@ -0,0 +1,214 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/TreeWalk.hpp"
+#include "../../io/DataIO.hpp"
+#include "test_tree.hpp"
+
+// longest path from the node to a leaf, in edges
+size_t get_depth(const std::shared_ptr<Node> &node) {
+    size_t depth = 0;
+    for (const auto &child : node->children_) {
+        depth = std::max(depth, get_depth(child) + 1);
+    }
+
+    return depth;
+}
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto root_node_indices = Forest::find_root_rows(consistent_trees_data);
+    root_node_indices.push_back(N_halos_in_tree);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    size_t lazy_nodes = 0;
+    size_t all_nodes = 0;
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        Tree full_tree(nullptr, root_node_indices[i], root_node_indices[i + 1]);
+        full_tree.build_tree(consistent_trees_data, TreeBuildMode::adjacency);
+
+        // only the root exists until the tree is traversed
+        Tree lazy_tree(nullptr, root_node_indices[i], root_node_indices[i + 1]);
+        lazy_tree.build_tree_lazy(consistent_trees_data);
+        assert(lazy_tree.get_number_of_expanded_nodes() == 1);
+
+        // walking the main branch only expands the main branch
+        std::vector<int64_t> full_branch, lazy_branch;
+        full_tree.traverse_most_massive_branch(consistent_trees_data, full_tree.root_node_,
+                                               id_key, full_branch);
+        lazy_tree.traverse_most_massive_branch(consistent_trees_data, lazy_tree.root_node_,
+                                               id_key, lazy_branch);
+        assert(full_branch == lazy_branch);
+        assert(lazy_tree.get_number_of_expanded_nodes() <= full_tree.get_number_of_nodes());
+        lazy_nodes += lazy_tree.get_number_of_expanded_nodes();
+        all_nodes += full_tree.get_number_of_nodes();
+
+        // a search over the whole tree expands every node
+        std::vector<size_t> rows;
+        TreeScratch scratch;
+        lazy_tree.breadth_first_search(consistent_trees_data, lazy_tree.root_node_, mass_key,
+                                       0., std::greater<double>(), rows, scratch);
+        assert(flatten_tree(lazy_tree.root_node_) == flatten_tree(full_tree.root_node_));
+        assert(lazy_tree.is_complete());
+        assert(lazy_tree.get_number_of_nodes() == full_tree.get_number_of_nodes());
+    }
+    assert(lazy_nodes < all_nodes);
+    test_passed("tree.build_tree_lazy()");
+
+    // the limits are only taken by build_tree_lazy
+    {
+        Tree lazy_tree(nullptr, root_node_indices[0], root_node_indices[1]);
+        bool thrown = false;
+        try {
+            lazy_tree.build_tree(consistent_trees_data, TreeBuildMode::lazy);
+        }
+        catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    test_passed("tree.build_tree(TreeBuildMode::lazy) throws");
+
+    // the whole-tree functions refuse a tree that is not expanded completely,
+    // and expand_tree makes it the same as the full tree
+    {
+        size_t largest_tree = 0;
+        for (size_t i = 1; i < root_node_indices.size() - 1; i++) {
+            if (root_node_indices[i + 1] - root_node_indices[i]
+                > root_node_indices[largest_tree + 1] - root_node_indices[largest_tree]) {
+                largest_tree = i;
+            }
+        }
+
+        Tree full_tree(nullptr, root_node_indices[largest_tree], root_node_indices[largest_tree + 1]);
+        full_tree.build_tree(consistent_trees_data, TreeBuildMode::adjacency);
+
+        Tree lazy_tree(nullptr, root_node_indices[largest_tree], root_node_indices[largest_tree + 1]);
+        lazy_tree.build_tree_lazy(consistent_trees_data);
+        lazy_tree.expand_node(consistent_trees_data, lazy_tree.root_node_.get());
+        assert(!lazy_tree.is_complete());
+
+        bool thrown = false;
+        try {
+            lazy_tree.get_number_of_nodes();
+        }
+        catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        thrown = false;
+        TreeScratch scratch;
+        try {
+            size_t walked_nodes = 0;
+            for (const auto &node : walk_pre_order(lazy_tree, scratch)) {
+                (void)node;
+                walked_nodes++;
+            }
+        }
+        catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        lazy_tree.expand_tree(consistent_trees_data);
+        assert(lazy_tree.is_complete());
+        assert(lazy_tree.get_number_of_nodes() == full_tree.get_number_of_nodes());
+        assert(flatten_tree(lazy_tree.root_node_) == flatten_tree(full_tree.root_node_));
+    }
+    test_passed("tree.expand_tree()");
+
+    // every tree of a lazy forest uses the same descendant index
+    {
+        Forest full_forest;
+        full_forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 1);
+
+        Forest lazy_forest;
+        lazy_forest.build_forest_lazy(consistent_trees_data, LazyTreeLimits(), 4);
+        assert(lazy_forest.get_number_of_trees() == full_forest.get_number_of_trees());
+        for (size_t t = 0; t < lazy_forest.get_number_of_trees(); t++) {
+            const auto &lazy_tree = lazy_forest.get_tree(t);
+            assert(lazy_tree->get_number_of_expanded_nodes() == 1);
+            lazy_tree->expand_tree(consistent_trees_data);
+            assert(flatten_tree(lazy_tree->root_node_) 
+                   == flatten_tree(full_forest.get_tree(t)->root_node_));
+        }
+        assert(lazy_forest.get_number_of_nodes() == full_forest.get_number_of_nodes());
+    }
+    test_passed("forest.build_forest_lazy()");
+
+    // the depth limit
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        Tree full_tree(nullptr, root_node_indices[i], root_node_indices[i + 1]);
+        full_tree.build_tree(consistent_trees_data, TreeBuildMode::adjacency);
+
+        LazyTreeLimits limits;
+        limits.max_depth = 3;
+        Tree lazy_tree(nullptr, root_node_indices[i], root_node_indices[i + 1]);
+        lazy_tree.build_tree_lazy(consistent_trees_data, limits);
+
+        std::vector<size_t> rows;
+        TreeScratch scratch;
+        lazy_tree.breadth_first_search(consistent_trees_data, lazy_tree.root_node_, mass_key,
+                                       0., std::greater<double>(), rows, scratch);
+        assert(get_depth(lazy_tree.root_node_) == std::min((size_t)3, get_depth(full_tree.root_node_)));
+        // the nodes at the depth limit are not expanded any further
+        assert(lazy_tree.is_complete());
+    }
+    test_passed("LazyTreeLimits::max_depth");
+
+    // the mass limit, every expanded node except the root is above the limit
+    const double minimum_mass = consistent_trees_data.get_data_as_double(0, mass_key) * 0.01;
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        LazyTreeLimits limits;
+        limits.min_mass = minimum_mass;
+        Tree lazy_tree(nullptr, root_node_indices[i], root_node_indices[i + 1]);
+        lazy_tree.build_tree_lazy(consistent_trees_data, limits);
+
+        std::vector<size_t> rows;
+        TreeScratch scratch;
+        lazy_tree.breadth_first_search(consistent_trees_data, lazy_tree.root_node_, mass_key,
+                                       0., std::greater<double>(), rows, scratch);
+        for (size_t j = 1; j < rows.size(); j++) {
+            assert(consistent_trees_data.get_data_as_double(rows[j], mass_key) >= minimum_mass);
+        }
+    }
+    test_passed("LazyTreeLimits::min_mass");
+
+    return 0;
+}
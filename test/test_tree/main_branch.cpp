@@ -0,0 +1,100 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/MainBranch.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto scale_key = consistent_trees_data.get_internal_key("scale");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+    const std::vector<size_t> keys = {virial_mass_key, scale_key, id_key};
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data);
+
+    std::vector<size_t> tree_indices;
+    std::vector<double> values;
+    for (size_t i = 0; i < forest.get_number_of_trees(); i++) {
+        const auto &tree = forest.get_tree(i);
+
+        std::vector<double> mass_list, scale_list;
+        std::vector<int64_t> id_list;
+        tree->traverse_most_massive_branch(consistent_trees_data, tree->root_node_,
+                                           virial_mass_key, mass_list);
+        tree->traverse_most_massive_branch(consistent_trees_data, tree->root_node_,
+                                           scale_key, scale_list);
+        tree->traverse_most_massive_branch(consistent_trees_data, tree->root_node_,
+                                           id_key, id_list);
+
+        const auto length = tree->extract_main_branch(consistent_trees_data, tree->root_node_,
+                                                      keys, values);
+        assert(length == mass_list.size());
+        assert(length == tree->get_main_branch_length(tree->root_node_));
+        assert(values.size() == keys.size() * length);
+        for (size_t j = 0; j < length; j++) {
+            assert(values[j] == mass_list[j]);
+            assert(values[length + j] == scale_list[j]);
+            assert(values[2 * length + j] == (double)id_list[j]);
+        }
+
+        // every other tree, in reverse order
+        if (i % 2 == 0) {
+            tree_indices.insert(tree_indices.begin(), i);
+        }
+    }
+    test_passed("tree.extract_main_branch()");
+
+    const auto batch = extract_main_branches(consistent_trees_data, forest.trees_,
+                                             tree_indices, keys, 4);
+    assert(batch.get_number_of_branches() == tree_indices.size());
+    assert(batch.values_.size() == keys.size() * batch.get_number_of_values());
+    for (size_t b = 0; b < tree_indices.size(); b++) {
+        const auto &tree = forest.get_tree(tree_indices[b]);
+        tree->extract_main_branch(consistent_trees_data, tree->root_node_, keys, values);
+
+        const auto length = batch.get_branch_length(b);
+        assert(length * keys.size() == values.size());
+        for (size_t c = 0; c < keys.size(); c++) {
+            for (size_t j = 0; j < length; j++) {
+                assert(batch.get_branch(c, b)[j] == values[c * length + j]);
+            }
+        }
+    }
+    test_passed("extract_main_branches()");
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Forest.hpp"
+#include "../../tree/Mergers.hpp"
+#include "../../io/DataIO.hpp"
+
+bool same_events(const std::vector<MergerEvent> &events_A, 
+                 const std::vector<MergerEvent> &events_B) {
+    if (events_A.size() != events_B.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < events_A.size(); i++) {
+        if (events_A[i].descendant_row != events_B[i].descendant_row
+            || events_A[i].main_progenitor_row != events_B[i].main_progenitor_row
+            || events_A[i].secondary_progenitor_row != events_B[i].secondary_progenitor_row
+            || events_A[i].mass_ratio != events_B[i].mass_ratio
+            || events_A[i].scale != events_B[i].scale) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+    auto scale_key = consistent_trees_data.get_internal_key("scale");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data);
+
+    const MergerFinder merger_finder;
+    const auto events = merger_finder.find_mergers(consistent_trees_data, 4);
+    assert(same_events(events, merger_finder.find_mergers(consistent_trees_data, 1)));
+    assert(same_events(events, merger_finder.find_mergers(consistent_trees_data, 
+                                                          forest.trees_, 4)));
+
+    // every node with n > 1 progenitors has n - 1 mergers
+    size_t expected_events = 0;
+    for (const auto &tree : forest.trees_) {
+        std::vector<std::shared_ptr<Node>> to_visit = {tree->root_node_};
+        while (!to_visit.empty()) {
+            auto node = to_visit.back();
+            to_visit.pop_back();
+            if (node->children_.size() > 1) {
+                expected_events += node->children_.size() - 1;
+            }
+            to_visit.insert(to_visit.end(), node->children_.begin(), node->children_.end());
+        }
+    }
+    assert(events.size() == expected_events);
+    assert(expected_events > 0);
+
+    size_t major_mergers = 0;
+    for (const auto &event : events) {
+        const auto descendant_id = consistent_trees_data.get_data<int64_t>(event.descendant_row, 
+                                                                           id_key);
+        assert(consistent_trees_data.get_data<int64_t>(event.main_progenitor_row, 
+                                                       descendant_id_key) == descendant_id);
+        assert(consistent_trees_data.get_data<int64_t>(event.secondary_progenitor_row, 
+                                                       descendant_id_key) == descendant_id);
+
+        const auto main_mass = consistent_trees_data.get_data<double>(event.main_progenitor_row,
+                                                                      virial_mass_key);
+        const auto secondary_mass = consistent_trees_data.get_data<double>(
+            event.secondary_progenitor_row, virial_mass_key
+        );
+        assert(secondary_mass <= main_mass);
+        assert(close_enough(event.mass_ratio, secondary_mass / main_mass));
+        assert(event.scale == consistent_trees_data.get_data<double>(event.descendant_row, 
+                                                                     scale_key));
+        if (event.mass_ratio >= 0.25) {
+            major_mergers++;
+        }
+    }
+    assert(MergerFinder(0.25).find_mergers(consistent_trees_data).size() == major_mergers);
+    test_passed("merger_finder.find_mergers()");
+
+    MergerRateHistogram histogram({0., 1.e11, 1.e12, 1.e16}, {0., 0.25, 1.01}, {0., 1., 2., 20.});
+    histogram.add_mergers(consistent_trees_data, events);
+    histogram.add_halos(consistent_trees_data);
+
+    // the rate adds up 1 / dz of the step of every merger
+    std::vector<double> expected_weights(3 * 2 * 3, 0.);
+    for (const auto &event : events) {
+        const auto mass = consistent_trees_data.get_data<double>(event.descendant_row, virial_mass_key);
+        const double redshift = 1. / event.scale - 1.;
+        const size_t m = (mass < 1.e11) ? 0 : (mass < 1.e12 ? 1 : 2);
+        const size_t q = (event.mass_ratio < 0.25) ? 0 : 1;
+        const size_t z = (redshift < 1.) ? 0 : (redshift < 2. ? 1 : 2);
+        const double step = 1. / consistent_trees_data.get_data<double>(event.main_progenitor_row, 
+                                                                        scale_key) - 1. / event.scale;
+        if (step > 0.) {
+            expected_weights[(m * 2 + q) * 3 + z] += 1. / step;
+        }
+    }
+
+    size_t total_mergers = 0, total_halos = 0;
+    for (size_t m = 0; m < 3; m++) {
+        for (size_t z = 0; z < 3; z++) {
+            total_halos += histogram.get_halo_count(m, z);
+            for (size_t q = 0; q < 2; q++) {
+                total_mergers += histogram.get_merger_count(m, q, z);
+
+                if (histogram.get_merger_count(m, q, z) == 0) {
+                    assert(histogram.get_merger_rate(m, q, z) == 0.);
+                }
+                else {
+                    const double width = (q == 0 ? 0.25 : 0.76);
+                    assert(close_enough(histogram.get_merger_rate(m, q, z),
+                                        expected_weights[(m * 2 + q) * 3 + z]
+                                        / (histogram.get_halo_count(m, z) * width)));
+                }
+            }
+        }
+    }
+    assert(total_mergers == events.size());
+    assert(total_halos == consistent_trees_data.get_number_of_rows());
+    test_passed("merger_rate_histogram.get_merger_rate()");
+
+    // a main branch with one snapshot every dz = 0.1, and one minor merger of
+    // mass ratio 1:2 at every step, all in a single redshift bin
+    DataContainer<ConsistentTreesData> branch_data({"id", "descendant_id", "scale", "virial_mass",
+                                                    "is_most_massive_progenitor"});
+    auto branch_id_key = branch_data.get_internal_key("id");
+    auto branch_descendant_id_key = branch_data.get_internal_key("descendant_id");
+    auto branch_scale_key = branch_data.get_internal_key("scale");
+    auto branch_virial_mass_key = branch_data.get_internal_key("virial_mass");
+    auto branch_flag_key = branch_data.get_internal_key("is_most_massive_progenitor");
+    auto add_halo = [&](const int64_t id, const int64_t descendant_id, const double redshift,
+                        const double mass, const int64_t flag) {
+        branch_data.data_[branch_id_key]->push_back(id);
+        branch_data.data_[branch_descendant_id_key]->push_back(descendant_id);
+        branch_data.data_[branch_scale_key]->push_back(1. / (1. + redshift));
+        branch_data.data_[branch_virial_mass_key]->push_back(mass);
+        branch_data.data_[branch_flag_key]->push_back(flag);
+    };
+
+    const size_t total_steps = 10;
+    add_halo(0, -1, 0., 1.e12, 1);
+    for (size_t i = 1; i <= total_steps; i++) {
+        add_halo(2 * i, 2 * (i - 1), 0.1 * i, 1.e12, 1);
+        add_halo(2 * i + 1, 2 * (i - 1), 0.1 * i, 5.e11, 0);
+    }
+
+    const auto branch_events = MergerFinder().find_mergers(branch_data);
+    assert(branch_events.size() == total_steps);
+
+    MergerRateHistogram branch_histogram({0., 1.e16}, {0., 1.01}, {0., 2.});
+    branch_histogram.add_mergers(branch_data, branch_events);
+    branch_histogram.add_halos(branch_data);
+    assert(branch_histogram.get_halo_count(0, 0) == 2 * total_steps + 1);
+    // 10 mergers per 0.1 in redshift, over 21 halos
+    assert(close_enough(branch_histogram.get_merger_rate(0, 0, 0),
+                        (double)total_steps / 0.1 / ((2. * total_steps + 1.) * 1.01)));
+    test_passed("merger_rate_histogram.get_merger_rate() with several snapshots per bin");
+
+    // the flagged progenitor is the main one, even if it is not the most massive
+    branch_data.set_data<int64_t>(1, branch_flag_key, 0);
+    branch_data.set_data<int64_t>(2, branch_flag_key, 1);
+    const auto flagged_events = MergerFinder().find_mergers(branch_data);
+    assert(flagged_events.size() == total_steps);
+    assert(flagged_events[0].main_progenitor_row == 2);
+    assert(flagged_events[0].secondary_progenitor_row == 1);
+    assert(close_enough(flagged_events[0].mass_ratio, 2.));
+    for (size_t i = 1; i < total_steps; i++) {
+        assert(flagged_events[i].main_progenitor_row == 2 * i + 1);
+    }
+    test_passed("merger_finder.find_mergers() with is_most_massive_progenitor");
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/MostMassiveProgenitors.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass", "is_most_massive_progenitor"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+    auto flag_key = consistent_trees_data.get_internal_key("is_most_massive_progenitor");
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    // every node of the forest by row
+    std::vector<std::shared_ptr<Node>> nodes(N_halos_in_tree);
+    for (const auto &tree : forest.trees_) {
+        std::vector<std::shared_ptr<Node>> to_visit = {tree->root_node_};
+        while (!to_visit.empty()) {
+            auto node = to_visit.back();
+            to_visit.pop_back();
+            nodes[node->get_data_row()] = node;
+            for (const auto &child : node->children_) {
+                to_visit.push_back(child);
+            }
+        }
+    }
+
+    // the first of the most massive children, by brute force
+    auto heaviest_child = [&](const size_t row) {
+        size_t best_row = MostMassiveProgenitorIndex::npos;
+        double best_mass = 0.;
+        for (const auto &child : nodes[row]->children_) {
+            const double mass = consistent_trees_data.get_data<double>(child->get_data_row(), 
+                                                                       virial_mass_key);
+            if (best_row == MostMassiveProgenitorIndex::npos || mass > best_mass) {
+                best_row = child->get_data_row();
+                best_mass = mass;
+            }
+        }
+
+        return best_row;
+    };
+
+    // make the second progenitor of some halos the most massive one, so that
+    // the data is not ordered by mass
+    size_t reordered = 0;
+    for (size_t row = 0; row < N_halos_in_tree && reordered < 50; row++) {
+        const auto &children = nodes[row]->children_;
+        if (children.size() > 1) {
+            const auto first_row = children[0]->get_data_row();
+            const auto second_row = children[1]->get_data_row();
+            consistent_trees_data.set_data<double>(
+                second_row, virial_mass_key,
+                2. * consistent_trees_data.get_data<double>(first_row, virial_mass_key) + 1.
+            );
+            consistent_trees_data.set_data<int64_t>(first_row, flag_key, 0);
+            consistent_trees_data.set_data<int64_t>(second_row, flag_key, 1);
+            reordered++;
+        }
+    }
+    assert(reordered > 0);
+
+    MostMassiveProgenitorIndex mass_index(MostMassiveProgenitorSource::mass);
+    mass_index.build(consistent_trees_data, 4);
+    assert(mass_index.get_number_of_rows() == N_halos_in_tree);
+    size_t not_first = 0;
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        const auto most_massive_row = mass_index.get_most_massive_progenitor(row);
+        assert(most_massive_row == heaviest_child(row));
+        if (most_massive_row != MostMassiveProgenitorIndex::npos 
+            && most_massive_row != nodes[row]->children_[0]->get_data_row()) {
+            not_first++;
+        }
+    }
+    assert(not_first >= reordered);
+    test_passed("MostMassiveProgenitorIndex(mass)");
+
+    // the flag picks the flagged progenitor, and falls back to the mass
+    MostMassiveProgenitorIndex flag_index(MostMassiveProgenitorSource::flag);
+    flag_index.build(consistent_trees_data, 1);
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        size_t flagged_row = MostMassiveProgenitorIndex::npos;
+        for (const auto &child : nodes[row]->children_) {
+            if (consistent_trees_data.get_data<int64_t>(child->get_data_row(), flag_key) != 0) {
+                flagged_row = child->get_data_row();
+                break;
+            }
+        }
+
+        const auto expected_row = (flagged_row != MostMassiveProgenitorIndex::npos)
+                                  ? flagged_row : heaviest_child(row);
+        assert(flag_index.get_most_massive_progenitor(row) == expected_row);
+    }
+    test_passed("MostMassiveProgenitorIndex(flag)");
+
+    // main branch walks through the index agree with the trees once the
+    // children are ordered by the index
+    mass_index.order_children(forest, 2);
+    std::vector<double> tree_masses, index_masses;
+    std::vector<size_t> branch_rows;
+    for (const auto &tree : forest.trees_) {
+        for (const auto &child : tree->root_node_->children_) {
+            assert(child->get_parent() == tree->root_node_);
+        }
+
+        tree_masses.clear();
+        index_masses.clear();
+        tree->traverse_most_massive_branch(consistent_trees_data, tree->root_node_,
+                                           virial_mass_key, tree_masses);
+        mass_index.traverse_most_massive_branch(consistent_trees_data, 
+                                                tree->root_node_row_in_data_,
+                                                virial_mass_key, index_masses);
+        assert(tree_masses == index_masses);
+
+        mass_index.get_main_branch_rows(tree->root_node_row_in_data_, branch_rows);
+        assert(branch_rows.size() == mass_index.get_main_branch_length(tree->root_node_row_in_data_));
+        assert(branch_rows.size() == tree->get_main_branch_length(tree->root_node_));
+    }
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        if (!nodes[row]->children_.empty()) {
+            assert(nodes[row]->children_[0]->get_data_row() 
+                   == mass_index.get_most_massive_progenitor(row));
+        }
+    }
+    test_passed("most_massive_progenitor_index.order_children()");
+
+    // nodes of a lazy tree that are expanded later would not be ordered
+    Tree lazy_tree(nullptr, forest.get_tree(0)->root_node_row_in_data_,
+                   forest.get_tree(0)->next_root_node_row_in_data_);
+    lazy_tree.build_tree_lazy(consistent_trees_data);
+    bool thrown = false;
+    try {
+        mass_index.order_children(lazy_tree);
+    }
+    catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    lazy_tree.expand_tree(consistent_trees_data);
+    mass_index.order_children(lazy_tree);
+    tree_masses.clear();
+    index_masses.clear();
+    lazy_tree.traverse_most_massive_branch(consistent_trees_data, lazy_tree.root_node_,
+                                           virial_mass_key, tree_masses);
+    mass_index.traverse_most_massive_branch(consistent_trees_data, lazy_tree.root_node_row_in_data_,
+                                            virial_mass_key, index_masses);
+    assert(tree_masses == index_masses);
+    test_passed("most_massive_progenitor_index.order_children() with a lazy tree");
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/NodeArena.hpp"
+#include "../../io/DataIO.hpp"
+#include "test_tree.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto root_node_indices = Forest::find_root_rows(consistent_trees_data);
+    root_node_indices.push_back(N_halos_in_tree);
+
+    std::shared_ptr<Node> kept_node;
+    std::vector<int64_t> kept_flat_tree;
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        const auto root_node_index = root_node_indices[i];
+        const auto next_root_node_index = root_node_indices[i + 1];
+
+        Tree heap_tree(nullptr, root_node_index, next_root_node_index);
+        heap_tree.build_tree(consistent_trees_data, TreeBuildMode::adjacency);
+
+        for (const auto mode : {TreeBuildMode::recursive, TreeBuildMode::iterative, 
+                                TreeBuildMode::adjacency}) {
+            Tree arena_tree(nullptr, root_node_index, next_root_node_index);
+            arena_tree.use_node_arena();
+            arena_tree.build_tree(consistent_trees_data, mode);
+
+            assert(flatten_tree(arena_tree.root_node_) == flatten_tree(heap_tree.root_node_));
+            assert(arena_tree.node_arena_->get_allocated_bytes() > 0);
+            assert(arena_tree.root_node_->children_.get_allocator().resource() 
+                   == arena_tree.node_arena_.get());
+
+            // the report charges everything that was taken from the arena
+            const auto arena_report = arena_tree.get_memory_report();
+            assert(arena_report.data_bytes == arena_tree.node_arena_->get_allocated_bytes());
+            assert(arena_report.data_bytes >= heap_tree.get_memory_report().entries[0].second);
+
+            // hold on to a part of one of the trees after the tree is gone
+            if (i == 0 && mode == TreeBuildMode::adjacency 
+                && !arena_tree.root_node_->children_.empty()) {
+                kept_node = arena_tree.root_node_->children_[0];
+                kept_flat_tree = flatten_tree(kept_node);
+            }
+        }
+    }
+    test_passed("arena_tree.build_tree()");
+    test_passed("arena_tree.get_memory_report()");
+
+    // the node keeps the arena alive
+    assert(kept_node != nullptr);
+    assert(flatten_tree(kept_node) == kept_flat_tree);
+    assert(kept_node->get_parent() == nullptr);
+    kept_node.reset();
+    test_passed("kept_node");
+
+    Forest heap_forest, arena_forest;
+    heap_forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 4);
+    arena_forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 4, true);
+    assert(arena_forest.get_number_of_trees() == heap_forest.get_number_of_trees());
+    for (size_t i = 0; i < arena_forest.get_number_of_trees(); i++) {
+        assert(arena_forest.get_tree(i)->node_arena_ != nullptr);
+        assert(flatten_tree(arena_forest.get_tree(i)->root_node_) 
+               == flatten_tree(heap_forest.get_tree(i)->root_node_));
+    }
+    test_passed("arena_forest.build_forest()");
+
+    // the arenas are reported on their own, and nothing is charged as heap nodes
+    size_t total_arena_bytes = 0;
+    for (size_t i = 0; i < arena_forest.get_number_of_trees(); i++) {
+        total_arena_bytes += arena_forest.get_tree(i)->node_arena_->get_allocated_bytes();
+    }
+    const auto arena_forest_report = arena_forest.get_memory_report();
+    assert(arena_forest_report.entries[0].first == "nodes");
+    assert(arena_forest_report.entries[0].second == 0);
+    assert(arena_forest_report.entries[1].first == "child lists");
+    assert(arena_forest_report.entries[1].second == 0);
+    assert(arena_forest_report.entries[2].first == "node arena");
+    assert(arena_forest_report.entries[2].second == total_arena_bytes);
+    assert(arena_forest_report.data_bytes == total_arena_bytes);
+    assert(heap_forest.get_memory_report().entries[2].second == 0);
+    test_passed("arena_forest.get_memory_report()");
+
+    return 0;
+}
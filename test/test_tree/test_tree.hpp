@@ -0,0 +1,48 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEST_TREE_HPP
+#define TEST_TREE_HPP
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "../../tree/Node.hpp"
+
+// depth-first list of (row, id, parent id, number of children)
+inline std::vector<int64_t> flatten_tree(const std::shared_ptr<Node> &root_node) {
+    std::vector<int64_t> flat_tree;
+    std::vector<std::shared_ptr<Node>> to_visit = {root_node};
+    while (!to_visit.empty()) {
+        auto node = to_visit.back();
+        to_visit.pop_back();
+
+        flat_tree.push_back(node->get_data_row());
+        flat_tree.push_back(node->halo.get_id());
+        flat_tree.push_back(node->halo.get_parent_id());
+        flat_tree.push_back(node->children_.size());
+
+        for (auto child = node->children_.rbegin(); child != node->children_.rend(); child++) {
+            to_visit.push_back(*child);
+        }
+    }
+
+    return flat_tree;
+}
+
+#endif
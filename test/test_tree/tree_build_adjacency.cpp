@@ -0,0 +1,75 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../io/DataIO.hpp"
+#include "test_tree.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+
+    std::vector<size_t> root_node_indices;
+    for (size_t i = 0; i < N_halos_in_tree; i++) {
+        if (consistent_trees_data.get_data<int64_t>(i, descendant_id_key) == -1) {
+            root_node_indices.push_back(i);
+        }
+    }
+    root_node_indices.push_back(N_halos_in_tree);
+
+    size_t total_nodes = 0;
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        const auto root_node_index = root_node_indices[i];
+        const auto next_root_node_index = root_node_indices[i + 1];
+        int64_t id = consistent_trees_data.get_data<int64_t>(root_node_index, id_key);
+
+        Tree recursive_tree(std::make_shared<Node>(root_node_index, nullptr, id),
+                            root_node_index, next_root_node_index);
+        recursive_tree.build_tree(consistent_trees_data, TreeBuildMode::recursive);
+
+        Tree adjacency_tree(std::make_shared<Node>(root_node_index, nullptr, id),
+                            root_node_index, next_root_node_index);
+        adjacency_tree.build_tree(consistent_trees_data, TreeBuildMode::adjacency);
+
+        // same nodes, same parents, same order of the children
+        assert(flatten_tree(recursive_tree.root_node_) == flatten_tree(adjacency_tree.root_node_));
+        total_nodes += adjacency_tree.get_number_of_nodes();
+    }
+    test_passed("flatten_tree(adjacency_tree.root_node_)");
+
+    assert(total_nodes == N_halos_in_tree);
+    test_passed("total_nodes");
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ * 
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or 
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, 
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. 
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License 
+ * along with HaloDataManager. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <functional>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../io/DataIO.hpp"
+#include "test_tree.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    std::vector<size_t> root_node_indices;
+    for (size_t i = 0; i < N_halos_in_tree; i++) {
+        if (consistent_trees_data.get_data<int64_t>(i, descendant_id_key) == -1) {
+            root_node_indices.push_back(i);
+        }
+    }
+    root_node_indices.push_back(N_halos_in_tree);
+
+    // shared by all of the trees
+    TreeScratch scratch;
+    for (size_t i = 0; i < root_node_indices.size() - 1; i++) {
+        const auto root_node_index = root_node_indices[i];
+        const auto next_root_node_index = root_node_indices[i + 1];
+        int64_t id = consistent_trees_data.get_data<int64_t>(root_node_index, id_key);
+
+        Tree recursive_tree(std::make_shared<Node>(root_node_index, nullptr, id),
+                            root_node_index, next_root_node_index);
+        recursive_tree.build_tree(consistent_trees_data, TreeBuildMode::recursive);
+
+        Tree iterative_tree(std::make_shared<Node>(root_node_index, nullptr, id),
+                            root_node_index, next_root_node_index);
+        iterative_tree.build_tree(consistent_trees_data, TreeBuildMode::iterative, scratch);
+
+        assert(flatten_tree(recursive_tree.root_node_) == flatten_tree(iterative_tree.root_node_));
+
+        // the old recursive search, as the reference
+        std::queue<std::shared_ptr<Node>> to_visit;
+        to_visit.push(recursive_tree.root_node_);
+        std::vector<std::shared_ptr<Node>> recursive_nodes;
+        recursive_tree.recursive_breadth_first_search(consistent_trees_data, to_visit,
+                                                      virial_mass_key, 1.e11,
+                                                      std::greater<double>(),
+                                                      recursive_nodes);
+
+        auto nodes = iterative_tree.breadth_first_search(consistent_trees_data, 
+                                                         iterative_tree.root_node_,
+                                                         virial_mass_key, 1.e11,
+                                                         std::greater<double>(), scratch);
+        assert(nodes.size() == recursive_nodes.size());
+        for (size_t j = 0; j < nodes.size(); j++) {
+            assert(nodes[j]->get_data_row() == recursive_nodes[j]->get_data_row());
+        }
+    }
+    test_passed("flatten_tree(iterative_tree.root_node_)");
+    test_passed("iterative_tree.breadth_first_search()");
+
+    // a single main branch that is far deeper than the call stack allows
+    const int64_t total_halos = 1000000;
+    DataContainer<ConsistentTreesData> chain_data(consistent_mask);
+    auto chain_id_key = chain_data.get_internal_key("id");
+    auto chain_descendant_id_key = chain_data.get_internal_key("descendant_id");
+    auto chain_scale_key = chain_data.get_internal_key("scale");
+    auto chain_virial_mass_key = chain_data.get_internal_key("virial_mass");
+    for (int64_t i = 0; i < total_halos; i++) {
+        chain_data.data_[chain_id_key]->push_back(i);
+        chain_data.data_[chain_descendant_id_key]->push_back(i - 1);
+        chain_data.data_[chain_scale_key]->push_back(1. - (double)i / total_halos);
+        chain_data.data_[chain_virial_mass_key]->push_back((double)(total_halos - i));
+    }
+
+    {
+        Tree chain_tree(nullptr, 0, total_halos);
+        chain_tree.build_tree(chain_data, TreeBuildMode::iterative, scratch);
+        assert(chain_tree.get_number_of_nodes() == (size_t)total_halos);
+
+        std::vector<double> mass_list;
+        chain_tree.traverse_most_massive_branch(chain_data, chain_tree.root_node_,
+                                                chain_virial_mass_key, mass_list);
+        assert(mass_list.size() == (size_t)total_halos);
+        assert(mass_list.back() == 1.);
+
+        auto nodes = chain_tree.breadth_first_search(chain_data, chain_tree.root_node_,
+                                                     chain_virial_mass_key, 10.5,
+                                                     std::less<double>(), scratch);
+        assert(nodes.size() == 10);
+        assert(nodes.back()->get_data_row() == (size_t)total_halos - 1);
+    }
+    // and the chain was destroyed without a stack overflow
+    test_passed("chain_tree.build_tree()");
+    test_passed("chain_tree.traverse_most_massive_branch()");
+
+    // a deep comb (every node of the main branch has a second, leaf
+    // progenitor) is released completely, except for a subtree that is still
+    // referenced elsewhere
+    {
+        const size_t comb_length = 200000;
+        std::vector<std::weak_ptr<Node>> comb_nodes;
+        std::shared_ptr<Node> kept_node;
+        {
+            auto comb_root = std::make_shared<Node>(0, nullptr, 0);
+            comb_nodes.push_back(comb_root);
+            auto branch_node = comb_root;
+            for (size_t i = 1; i < comb_length; i++) {
+                auto leaf = std::make_shared<Node>(2 * i, nullptr, 2 * i);
+                auto next_branch_node = std::make_shared<Node>(2 * i - 1, nullptr, 2 * i - 1);
+                branch_node->add_child(next_branch_node);
+                branch_node->add_child(leaf);
+                comb_nodes.push_back(next_branch_node);
+                comb_nodes.push_back(leaf);
+                branch_node = next_branch_node;
+            }
+            // the lower half of the main branch stays alive
+            kept_node = comb_nodes[comb_length - 1].lock();
+        }
+
+        // branch nodes have odd indices and the leaf at index i is a
+        // progenitor of the branch node at index i - 3
+        for (size_t i = 0; i < comb_nodes.size(); i++) {
+            const bool below_kept = (i % 2 == 1) ? (i >= comb_length - 1) : (i >= comb_length + 2);
+            assert(comb_nodes[i].expired() != below_kept);
+        }
+        kept_node = nullptr;
+        for (const auto &node : comb_nodes) {
+            assert(node.expired());
+        }
+    }
+    test_passed("Node::~Node()");
+
+    return 0;
+}
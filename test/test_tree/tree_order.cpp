@@ -0,0 +1,170 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <cmath>
+#include <stdexcept>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Forest.hpp"
+#include "../../tree/TreeOrder.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+    consistent_trees_data.add_derived_column("log_mass", "virial_mass",
+                                             [](double mass) { return std::log10(mass); });
+
+    // reversing the rows twice gives back the same data
+    auto reversed_data = consistent_trees_data.select_rows({0, 1, 2, 3});
+    reversed_data.permute_rows({3, 2, 1, 0});
+    for (size_t row = 0; row < 4; row++) {
+        assert(reversed_data.get_data<int64_t>(row, id_key) 
+               == consistent_trees_data.get_data<int64_t>(3 - row, id_key));
+        assert(reversed_data.get_data<double>(row, "log_mass") 
+               == consistent_trees_data.get_data<double>(3 - row, "log_mass"));
+    }
+
+    bool threw = false;
+    try {
+        reversed_data.permute_rows({0, 1, 1, 3});
+    }
+    catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    test_passed("consistent_trees_data.permute_rows()");
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    // the id and mass of every node before the rows are moved
+    std::vector<std::vector<Node *>> tree_nodes(forest.get_number_of_trees());
+    std::vector<std::vector<std::pair<int64_t, double>>> node_values(forest.get_number_of_trees());
+    for (size_t t = 0; t < forest.get_number_of_trees(); t++) {
+        get_tree_nodes_in_order(*forest.get_tree(t), TreeOrder::breadth_first, tree_nodes[t]);
+        for (const auto node : tree_nodes[t]) {
+            const auto row = node->get_data_row();
+            node_values[t].push_back(std::make_pair(
+                consistent_trees_data.get_data<int64_t>(row, id_key),
+                consistent_trees_data.get_data<double>(row, virial_mass_key)
+            ));
+        }
+    }
+
+    for (const auto order : {TreeOrder::depth_first, TreeOrder::breadth_first}) {
+        reorder_forest_rows(consistent_trees_data, forest, order, 4);
+        assert(consistent_trees_data.get_number_of_rows() == N_halos_in_tree);
+
+        std::vector<Node *> nodes;
+        for (size_t t = 0; t < forest.get_number_of_trees(); t++) {
+            const auto &tree = forest.get_tree(t);
+            assert(tree->root_node_->get_data_row() == tree->root_node_row_in_data_);
+
+            // the nodes still point to their own halos
+            for (size_t i = 0; i < tree_nodes[t].size(); i++) {
+                const auto row = tree_nodes[t][i]->get_data_row();
+                assert(row >= tree->root_node_row_in_data_ 
+                       && row < tree->next_root_node_row_in_data_);
+                assert(consistent_trees_data.get_data<int64_t>(row, id_key) == node_values[t][i].first);
+                assert(consistent_trees_data.get_data<double>(row, virial_mass_key) 
+                       == node_values[t][i].second);
+                assert(consistent_trees_data.get_data<double>(row, "log_mass") 
+                       == std::log10(node_values[t][i].second));
+            }
+
+            // and the rows follow the traversal order
+            get_tree_nodes_in_order(*tree, order, nodes);
+            for (size_t i = 0; i < nodes.size(); i++) {
+                assert(nodes[i]->get_data_row() == tree->root_node_row_in_data_ + i);
+            }
+            if (order == TreeOrder::depth_first) {
+                for (const auto node : nodes) {
+                    if (!node->children_.empty()) {
+                        assert(node->children_[0]->get_data_row() == node->get_data_row() + 1);
+                    }
+                }
+            }
+        }
+    }
+    test_passed("reorder_forest_rows()");
+
+    // the reordered data builds the same trees
+    Forest rebuilt_forest;
+    rebuilt_forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+    assert(rebuilt_forest.get_number_of_trees() == forest.get_number_of_trees());
+    for (size_t t = 0; t < forest.get_number_of_trees(); t++) {
+        assert(rebuilt_forest.get_tree(t)->get_number_of_nodes() 
+               == forest.get_tree(t)->get_number_of_nodes());
+        assert(rebuilt_forest.get_tree(t)->root_node_row_in_data_ 
+               == forest.get_tree(t)->root_node_row_in_data_);
+    }
+    test_passed("rebuilt_forest.build_forest()");
+
+    // forests whose trees do not tile the rows are rejected before anything
+    // is changed
+    auto expect_rejected = [&](Forest &invalid_forest) {
+        const auto first_id = consistent_trees_data.get_data<int64_t>(0, id_key);
+        bool rejected = false;
+        try {
+            reorder_forest_rows(consistent_trees_data, invalid_forest, TreeOrder::breadth_first, 2);
+        }
+        catch (const std::runtime_error &) {
+            rejected = true;
+        }
+        assert(rejected);
+        assert(consistent_trees_data.get_data<int64_t>(0, id_key) == first_id);
+    };
+
+    // the same tree twice
+    Forest overlapping_forest;
+    overlapping_forest.trees_ = {rebuilt_forest.trees_[0], rebuilt_forest.trees_[0]};
+    expect_rejected(overlapping_forest);
+
+    // a tree whose range starts before its root
+    size_t large_tree = 1;
+    while (rebuilt_forest.get_tree(large_tree)->get_number_of_nodes() < 2) {
+        large_tree++;
+    }
+    Forest shifted_forest;
+    shifted_forest.trees_ = {std::make_shared<Tree>(
+        nullptr, rebuilt_forest.get_tree(large_tree)->root_node_row_in_data_ - 1,
+        rebuilt_forest.get_tree(large_tree)->next_root_node_row_in_data_
+    )};
+    shifted_forest.trees_[0]->root_node_ = rebuilt_forest.get_tree(large_tree)->root_node_;
+    expect_rejected(shifted_forest);
+    shifted_forest.trees_[0]->root_node_ = nullptr;
+    test_passed("reorder_forest_rows() with invalid trees");
+
+    return 0;
+}
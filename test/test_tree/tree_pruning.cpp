@@ -0,0 +1,145 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Forest.hpp"
+#include "../../tree/AncestryIndex.hpp"
+#include "../../tree/TreeReduce.hpp"
+#include "../../tree/TreePruning.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto id_key = consistent_trees_data.get_internal_key("id");
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+    auto scale_key = consistent_trees_data.get_internal_key("scale");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    // a derived column is recomputed for the selected rows
+    consistent_trees_data.add_derived_column("log_mass", "virial_mass",
+                                             [](double mass) { return std::log10(mass); });
+    auto log_mass_key = consistent_trees_data.get_internal_key("log_mass");
+    const std::vector<size_t> selected_rows = {5, 2, 7};
+    auto selected_data = consistent_trees_data.select_rows(selected_rows);
+    assert(selected_data.get_number_of_rows() == selected_rows.size());
+    for (size_t i = 0; i < selected_rows.size(); i++) {
+        assert(selected_data.get_data<int64_t>(i, id_key) 
+               == consistent_trees_data.get_data<int64_t>(selected_rows[i], id_key));
+        assert(selected_data.get_data<double>(i, "log_mass") 
+               == consistent_trees_data.get_data<double>(selected_rows[i], log_mass_key));
+    }
+    test_passed("consistent_trees_data.select_rows()");
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+    AncestryIndex ancestry_index;
+    ancestry_index.build(forest);
+
+    std::vector<double> max_masses;
+    reduce_forest<double>(forest,
+                          [&](const size_t row, const size_t) {
+                              return consistent_trees_data.get_data<double>(row, virial_mass_key);
+                          },
+                          [](const double a, const double b) { return std::max(a, b); },
+                          2, &max_masses);
+
+    std::vector<double> masses;
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        masses.push_back(consistent_trees_data.get_data<double>(row, virial_mass_key));
+    }
+    std::nth_element(masses.begin(), masses.begin() + masses.size() / 2, masses.end());
+
+    PruningLimits limits;
+    limits.min_mass = masses[masses.size() / 2];
+    limits.max_depth = 20;
+
+    PrunedForest<ConsistentTreesData> pruned_forest(consistent_trees_data, limits, 4);
+
+    const size_t N_kept = pruned_forest.get_number_of_nodes();
+    assert(N_kept > forest.get_number_of_trees() && N_kept < N_halos_in_tree);
+    assert(pruned_forest.data_.get_number_of_rows() == N_kept);
+    assert(pruned_forest.get_number_of_trees() == forest.get_number_of_trees());
+
+    // the derived columns are recomputed when they are looked up
+    assert(pruned_forest.data_.get_internal_key("log_mass") == log_mass_key);
+
+    // exactly the rows within the limits are kept, in their original order
+    std::vector<uint8_t> kept(N_halos_in_tree, 0);
+    for (size_t row = 0; row < N_kept; row++) {
+        const auto original_row = pruned_forest.get_original_row(row);
+        assert(row == 0 || original_row > pruned_forest.get_original_row(row - 1));
+        kept[original_row] = 1;
+
+        for (const auto key : {id_key, descendant_id_key}) {
+            assert(pruned_forest.data_.get_data<int64_t>(row, key) 
+                   == consistent_trees_data.get_data<int64_t>(original_row, key));
+        }
+        for (const auto key : {scale_key, virial_mass_key, log_mass_key}) {
+            assert(pruned_forest.data_.get_data<double>(row, key) 
+                   == consistent_trees_data.get_data<double>(original_row, key));
+        }
+    }
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        const bool is_root = ancestry_index.get_depth(row) == 0;
+        const bool expected = is_root || (max_masses[row] >= limits.min_mass 
+                                          && ancestry_index.get_depth(row) <= limits.max_depth);
+        assert(kept[row] == expected);
+    }
+    test_passed("pruned_forest.prune()");
+
+    // the compacted trees have the same links as the original trees
+    size_t N_tree_nodes = 0;
+    for (size_t t = 0; t < pruned_forest.get_number_of_trees(); t++) {
+        const auto &tree = pruned_forest.get_tree(t);
+        N_tree_nodes += tree.get_number_of_nodes();
+        assert(pruned_forest.get_original_row(tree.root_node_row_in_data_) 
+               == forest.get_tree(t)->root_node_row_in_data_);
+
+        for (FlatTree::NodeIndex node = 1; node < (FlatTree::NodeIndex)tree.get_number_of_nodes(); node++) {
+            const auto original_row = pruned_forest.get_original_row(tree.get_data_row(node));
+            const auto original_parent_row 
+                = pruned_forest.get_original_row(tree.get_data_row(tree.get_parent(node)));
+            assert(ancestry_index.get_depth(original_row) 
+                   == ancestry_index.get_depth(original_parent_row) + 1);
+            assert(ancestry_index.is_progenitor(original_row, original_parent_row));
+        }
+    }
+    assert(N_tree_nodes == N_kept);
+    assert(pruned_forest.get_memory_report().data_bytes 
+           < consistent_trees_data.get_memory_report().data_bytes);
+    test_passed("pruned_forest.get_tree()");
+
+    return 0;
+}
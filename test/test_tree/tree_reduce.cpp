@@ -0,0 +1,162 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <algorithm>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/FlatTree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/AncestryIndex.hpp"
+#include "../../tree/TreeReduce.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    auto count_nodes = [](const size_t, const size_t) { return (size_t)1; };
+    auto count_leaves = [](const size_t, const size_t children) { return (size_t)(children == 0); };
+    auto sum = [](const size_t a, const size_t b) { return a + b; };
+    auto zero_depth = [](const size_t, const size_t) { return (size_t)0; };
+    auto depth = [](const size_t a, const size_t b) { return std::max(a, b + 1); };
+    auto mass = [&](const size_t row, const size_t) {
+        return consistent_trees_data.get_data<double>(row, virial_mass_key);
+    };
+    auto max_mass = [](const double a, const double b) { return std::max(a, b); };
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    AncestryIndex ancestry_index;
+    ancestry_index.build(forest);
+
+    std::vector<size_t> row_sizes;
+    auto tree_sizes = reduce_forest<size_t>(forest, count_nodes, sum, 4, &row_sizes);
+    assert(tree_sizes.size() == forest.get_number_of_trees());
+    assert(row_sizes.size() == N_halos_in_tree);
+    for (size_t t = 0; t < forest.get_number_of_trees(); t++) {
+        assert(tree_sizes[t] == forest.get_tree(t)->get_number_of_nodes());
+    }
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        assert(row_sizes[row] == ancestry_index.get_subtree_size(row));
+    }
+    test_passed("reduce_forest()");
+
+    for (const auto &tree : forest.trees_) {
+        FlatTree flat_tree(tree->root_node_row_in_data_, tree->next_root_node_row_in_data_);
+        flat_tree.build_tree(consistent_trees_data);
+
+        auto leaves = reduce_tree<size_t>(*tree, count_leaves, sum);
+        auto flat_leaves = reduce_tree<size_t>(flat_tree, count_leaves, sum);
+        auto depths = reduce_tree<size_t>(*tree, zero_depth, depth);
+        auto flat_depths = reduce_tree<size_t>(flat_tree, zero_depth, depth);
+        auto max_masses = reduce_tree<double>(*tree, mass, max_mass);
+        auto flat_max_masses = reduce_tree<double>(flat_tree, mass, max_mass);
+
+        size_t expected_leaves = 0;
+        size_t expected_depth = 0;
+        double expected_max_mass = 0.;
+        for (auto row = tree->root_node_row_in_data_; row < tree->next_root_node_row_in_data_; row++) {
+            expected_leaves += (ancestry_index.get_subtree_size(row) == 1);
+            expected_depth = std::max(expected_depth, ancestry_index.get_depth(row));
+            expected_max_mass = std::max(expected_max_mass, mass(row, 0));
+        }
+        assert(leaves[0] == expected_leaves && flat_leaves[0] == expected_leaves);
+        assert(depths[0] == expected_depth && flat_depths[0] == expected_depth);
+        assert(max_masses[0] == expected_max_mass && flat_max_masses[0] == expected_max_mass);
+
+        // the flat tree is indexed by node instead of by row
+        for (FlatTree::NodeIndex node = 0; 
+             node < (FlatTree::NodeIndex)flat_tree.get_number_of_nodes(); node++) {
+            const auto local_row = flat_tree.get_data_row(node) - tree->root_node_row_in_data_;
+            assert(flat_leaves[node] == leaves[local_row]);
+            assert(flat_depths[node] == depths[local_row]);
+        }
+    }
+    test_passed("reduce_tree()");
+
+    // a binary tree that is large enough for parallel levels
+    const int64_t total_halos = 300000;
+    DataContainer<ConsistentTreesData> binary_data(consistent_mask);
+    auto binary_id_key = binary_data.get_internal_key("id");
+    auto binary_descendant_id_key = binary_data.get_internal_key("descendant_id");
+    auto binary_scale_key = binary_data.get_internal_key("scale");
+    auto binary_virial_mass_key = binary_data.get_internal_key("virial_mass");
+    for (int64_t i = 0; i < total_halos; i++) {
+        binary_data.data_[binary_id_key]->push_back(i);
+        binary_data.data_[binary_descendant_id_key]->push_back(i == 0 ? -1 : (i - 1) / 2);
+        binary_data.data_[binary_scale_key]->push_back(1. - (double)i / total_halos);
+        binary_data.data_[binary_virial_mass_key]->push_back((double)(total_halos - i));
+    }
+
+    Forest binary_forest;
+    binary_forest.build_forest(binary_data, TreeBuildMode::adjacency, 1);
+    FlatTree binary_flat_tree(0, total_halos);
+    binary_flat_tree.build_tree(binary_data);
+
+    auto serial_sizes = reduce_tree<size_t>(binary_flat_tree, count_nodes, sum);
+    auto parallel_sizes = reduce_tree<size_t>(*binary_forest.get_tree(0), count_nodes, sum, 4);
+    assert(parallel_sizes[0] == (size_t)total_halos);
+    for (FlatTree::NodeIndex node = 0; node < (FlatTree::NodeIndex)total_halos; node++) {
+        assert(parallel_sizes[binary_flat_tree.get_data_row(node)] == serial_sizes[node]);
+    }
+
+    std::vector<size_t> binary_row_depths;
+    auto binary_depths = reduce_forest<size_t>(binary_forest, zero_depth, depth, 4, 
+                                               &binary_row_depths);
+    assert(binary_depths.size() == 1 && binary_depths[0] == 18);
+    assert(binary_row_depths[total_halos - 1] == 0);
+    test_passed("reduce_tree() with parallel levels");
+
+    // called from inside a parallel loop, the levels are reduced serially,
+    // and a flag is reduced as uint8_t
+    auto is_heavy = [&](const size_t row, const size_t) {
+        return (uint8_t)(binary_data.get_data<double>(row, binary_virial_mass_key) > total_halos / 2);
+    };
+    auto any = [](const uint8_t a, const uint8_t b) { return (uint8_t)(a | b); };
+    std::vector<std::vector<size_t>> nested_sizes(2);
+    std::vector<std::vector<uint8_t>> nested_heavy(2);
+    parallel_for_chunks(0, 2, [&](const size_t chunk_begin, const size_t chunk_end) {
+        for (size_t i = chunk_begin; i < chunk_end; i++) {
+            nested_sizes[i] = reduce_tree<size_t>(*binary_forest.get_tree(0), count_nodes, sum, 4);
+            nested_heavy[i] = reduce_tree<uint8_t>(*binary_forest.get_tree(0), is_heavy, any, 4);
+        }
+    }, 2, 1);
+    for (size_t i = 0; i < 2; i++) {
+        assert(nested_sizes[i] == parallel_sizes);
+        assert(nested_heavy[i][0] == 1 && nested_heavy[i][total_halos - 1] == 0);
+    }
+    test_passed("reduce_tree() inside of a parallel loop");
+
+    return 0;
+}
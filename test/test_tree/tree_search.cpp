@@ -0,0 +1,177 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Tree.hpp"
+#include "../../tree/FlatTree.hpp"
+#include "../../tree/Forest.hpp"
+#include "../../tree/TreeSearch.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    size_t N_halos_in_tree = consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto descendant_id_key = consistent_trees_data.get_internal_key("descendant_id");
+    auto scale_key = consistent_trees_data.get_internal_key("scale");
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    // the median mass and scale, so that every predicate matches some of the rows
+    std::vector<double> masses, scales;
+    for (size_t row = 0; row < N_halos_in_tree; row++) {
+        masses.push_back(consistent_trees_data.get_data<double>(row, virial_mass_key));
+        scales.push_back(consistent_trees_data.get_data<double>(row, scale_key));
+    }
+    std::nth_element(masses.begin(), masses.begin() + masses.size() / 2, masses.end());
+    std::nth_element(scales.begin(), scales.begin() + scales.size() / 2, scales.end());
+    const double mass_cut = masses[masses.size() / 2];
+    const double scale_cut = scales[scales.size() / 2];
+
+    auto expected_match = [&](const size_t row, const bool all_of) {
+        const bool massive = consistent_trees_data.get_data<double>(row, virial_mass_key) > mass_cut;
+        const bool early = consistent_trees_data.get_data<double>(row, scale_key) <= scale_cut;
+        const bool has_descendant 
+            = consistent_trees_data.get_data<int64_t>(row, descendant_id_key) != -1;
+        return all_of ? (massive && early && has_descendant) : (massive || early || has_descendant);
+    };
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    for (const auto combination : {SearchCombination::all_of, SearchCombination::any_of}) {
+        const bool all_of = combination == SearchCombination::all_of;
+
+        TreeSearch search(combination);
+        search.add_predicate(virial_mass_key, SearchComparison::greater, mass_cut)
+              .add_predicate(scale_key, SearchComparison::less_equal, scale_cut)
+              .add_predicate(descendant_id_key, SearchComparison::not_equal, (int64_t)-1);
+        assert(search.get_number_of_predicates() == 3);
+
+        std::vector<size_t> all_expected_rows;
+        SearchScratch scratch;
+        std::vector<size_t> rows;
+        std::vector<std::shared_ptr<Node>> nodes;
+        std::vector<FlatTree::NodeIndex> flat_nodes;
+        for (const auto &tree : forest.trees_) {
+            std::vector<size_t> expected_rows;
+            for (size_t row = tree->root_node_row_in_data_; 
+                 row < tree->next_root_node_row_in_data_; row++) {
+                if (expected_match(row, all_of)) {
+                    expected_rows.push_back(row);
+                }
+            }
+            all_expected_rows.insert(all_expected_rows.end(), 
+                                     expected_rows.begin(), expected_rows.end());
+
+            assert(search.search(consistent_trees_data, *tree, rows, scratch) 
+                   == expected_rows.size());
+            assert(rows == expected_rows);
+
+            search.search(consistent_trees_data, *tree, nodes, scratch);
+            assert(nodes.size() == expected_rows.size());
+            for (size_t i = 0; i < nodes.size(); i++) {
+                assert(nodes[i]->get_data_row() == expected_rows[i]);
+            }
+
+            FlatTree flat_tree(tree->root_node_row_in_data_, tree->next_root_node_row_in_data_);
+            flat_tree.build_tree(consistent_trees_data);
+            search.search(consistent_trees_data, flat_tree, flat_nodes, scratch);
+            assert(flat_nodes.size() == expected_rows.size());
+            for (size_t i = 0; i < flat_nodes.size(); i++) {
+                assert(flat_tree.get_data_row(flat_nodes[i]) == expected_rows[i]);
+            }
+        }
+        assert(!all_expected_rows.empty() && all_expected_rows.size() < N_halos_in_tree);
+
+        assert(search.search(consistent_trees_data, 1) == all_expected_rows);
+        assert(search.search(consistent_trees_data, 4) == all_expected_rows);
+    }
+    test_passed("tree_search.search()");
+
+    // a single predicate gives the same halos as breadth_first_search
+    TreeSearch mass_search;
+    mass_search.add_predicate(virial_mass_key, SearchComparison::greater, mass_cut);
+    SearchScratch scratch;
+    for (const auto &tree : forest.trees_) {
+        std::vector<size_t> rows;
+        mass_search.search(consistent_trees_data, *tree, rows, scratch);
+
+        auto nodes = tree->breadth_first_search(consistent_trees_data, tree->root_node_,
+                                                virial_mass_key, mass_cut, 
+                                                std::greater<double>());
+        std::vector<size_t> breadth_first_rows;
+        for (const auto &node : nodes) {
+            breadth_first_rows.push_back(node->get_data_row());
+        }
+        std::sort(breadth_first_rows.begin(), breadth_first_rows.end());
+        assert(rows == breadth_first_rows);
+    }
+    test_passed("tree_search.search() and breadth_first_search()");
+
+    // without predicates, all_of matches everything and any_of nothing
+    assert(TreeSearch(SearchCombination::all_of).search(consistent_trees_data).size() 
+           == N_halos_in_tree);
+    assert(TreeSearch(SearchCombination::any_of).search(consistent_trees_data).empty());
+    test_passed("TreeSearch without predicates");
+
+    // a derived column is brought up-to-date before its storage is searched
+    {
+        DataContainer<ConsistentTreesData> derived_data(consistent_trees_data);
+        derived_data.add_derived_column("double_mass", "virial_mass",
+                                        [](const double mass) { return 2. * mass; });
+        const auto double_mass_key = derived_data.get_internal_key("double_mass");
+        derived_data.set_data<double>(0, virial_mass_key, 1.e30);
+
+        TreeSearch search;
+        search.add_predicate(double_mass_key, SearchComparison::greater, 1.e30);
+        const auto &tree = *forest.get_tree(0);
+        std::vector<std::shared_ptr<Node>> nodes;
+        SearchScratch scratch;
+        assert(search.search(derived_data, tree, nodes, scratch) == 1);
+        assert(nodes[0]->get_data_row() == 0);
+    }
+    test_passed("TreeSearch with a derived column");
+
+    // a tree without any nodes has no matching nodes
+    {
+        const Tree empty_tree(nullptr, 0, forest.get_tree(0)->next_root_node_row_in_data_);
+        std::vector<std::shared_ptr<Node>> nodes;
+        SearchScratch scratch;
+        assert(TreeSearch(SearchCombination::all_of).search(consistent_trees_data, empty_tree, 
+                                                            nodes, scratch) == 0);
+        assert(nodes.empty());
+    }
+    test_passed("TreeSearch on an empty tree");
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <memory>
+#include <unordered_map>
+#include "../test.hpp"
+#undef TREE_VERBOSE
+#include "../../tree/Forest.hpp"
+#include "../../tree/TreeOrder.hpp"
+#include "../../tree/TreeWalk.hpp"
+#include "../../io/DataIO.hpp"
+
+int main() {
+    DataIO<DataContainer<ConsistentTreesData>> consistent_io("../data/tree_0_0_0.dat");
+
+    std::vector<std::string> consistent_mask = {
+      "id", "descendant_id", "scale", "virial_mass"
+    };
+
+    DataContainer<ConsistentTreesData> consistent_trees_data(consistent_mask);
+    consistent_io.read_data_from_file(consistent_trees_data);
+
+    auto virial_mass_key = consistent_trees_data.get_internal_key("virial_mass");
+
+    Forest forest;
+    forest.build_forest(consistent_trees_data, TreeBuildMode::adjacency, 2);
+
+    TreeScratch scratch;
+    std::vector<Node *> expected_nodes;
+    std::vector<Node *> nodes;
+    for (size_t t = 0; t < forest.get_number_of_trees(); t++) {
+        const Tree &tree = *forest.get_tree(t);
+
+        get_tree_nodes_in_order(tree, TreeOrder::depth_first, expected_nodes);
+        nodes.clear();
+        for (const auto &node : walk_pre_order(tree, scratch)) {
+            nodes.push_back(node.get());
+        }
+        assert(nodes == expected_nodes);
+
+        get_tree_nodes_in_order(tree, TreeOrder::breadth_first, expected_nodes);
+        nodes.clear();
+        for (const auto &node : walk_breadth_first(tree, scratch)) {
+            nodes.push_back(node.get());
+        }
+        assert(nodes == expected_nodes);
+
+        // every node comes right after its last progenitor's subtree
+        std::unordered_map<const Node *, size_t> position;
+        for (const auto &node : walk_post_order(tree, scratch)) {
+            for (const auto &child : node->children_) {
+                assert(position.count(child.get()) == 1);
+            }
+            position[node.get()] = position.size();
+        }
+        assert(position.size() == expected_nodes.size());
+        assert(position[tree.root_node_.get()] == expected_nodes.size() - 1);
+    }
+    test_passed("walk_pre_order(), walk_post_order() and walk_breadth_first()");
+
+    // the largest tree
+    size_t largest_tree = 0;
+    for (size_t t = 1; t < forest.get_number_of_trees(); t++) {
+        if (forest.get_tree(t)->get_number_of_nodes() 
+            > forest.get_tree(largest_tree)->get_number_of_nodes()) {
+            largest_tree = t;
+        }
+    }
+    const Tree &tree = *forest.get_tree(largest_tree);
+
+    // the main branch of the root and the path back from its last node
+    std::vector<double> main_branch_masses;
+    tree.traverse_most_massive_branch(consistent_trees_data, tree.root_node_,
+                                      virial_mass_key, main_branch_masses);
+    std::vector<const Node *> main_branch;
+    for (const auto &node : walk_main_branch(tree.root_node_)) {
+        assert(consistent_trees_data.get_data<double>(node->get_data_row(), virial_mass_key) 
+               == main_branch_masses[main_branch.size()]);
+        main_branch.push_back(node.get());
+    }
+    assert(main_branch.size() == main_branch_masses.size());
+    test_passed("walk_main_branch()");
+
+    std::shared_ptr<Node> first_halo = tree.root_node_;
+    while (!first_halo->children_.empty()) {
+        first_halo = first_halo->children_[0];
+    }
+    size_t N_path = 0;
+    for (const auto &node : walk_to_root(first_halo)) {
+        assert(node.get() == main_branch[main_branch.size() - 1 - N_path]);
+        N_path++;
+    }
+    assert(N_path == main_branch.size());
+    test_passed("walk_to_root()");
+
+    // the walks can be left early, and progenitors can be skipped
+    size_t N_visited = 0;
+    for (const auto &node : walk_breadth_first(tree, scratch)) {
+        (void)node;
+        if (++N_visited == 10) {
+            break;
+        }
+    }
+    assert(N_visited == 10);
+
+    const double min_mass 
+        = consistent_trees_data.get_data<double>(tree.root_node_->get_data_row(), virial_mass_key) / 100.;
+    size_t N_expected_heavy = 0;
+    std::vector<const Node *> to_visit = {tree.root_node_.get()};
+    while (!to_visit.empty()) {
+        const Node *node = to_visit.back();
+        to_visit.pop_back();
+        if (consistent_trees_data.get_data<double>(node->get_data_row(), virial_mass_key) >= min_mass) {
+            N_expected_heavy++;
+            for (const auto &child : node->children_) {
+                to_visit.push_back(child.get());
+            }
+        }
+    }
+
+    size_t N_heavy = 0;
+    auto walk = walk_pre_order(tree, scratch);
+    for (auto node = walk.begin(); node != walk.end(); ++node) {
+        if (consistent_trees_data.get_data<double>((*node)->get_data_row(), virial_mass_key) < min_mass) {
+            node.skip_children();
+        }
+        else {
+            N_heavy++;
+        }
+    }
+    assert(N_heavy == N_expected_heavy && N_heavy > 1);
+    test_passed("PreOrderWalk::iterator::skip_children()");
+
+    // once the scratch buffers are large enough, the walks do not grow them
+    const size_t stack_capacity = scratch.walk_stack.capacity();
+    const size_t queue_capacity = scratch.walk_queue.capacity();
+    size_t N_walked = 0;
+    for (const auto &tree_pointer : forest.trees_) {
+        for (const auto &node : walk_pre_order(*tree_pointer, scratch)) {
+            N_walked += node->children_.size();
+        }
+        for (const auto &node : walk_post_order(*tree_pointer, scratch)) {
+            N_walked += node->children_.size();
+        }
+        for (const auto &node : walk_breadth_first(*tree_pointer, scratch)) {
+            N_walked += node->children_.size();
+        }
+        for (const auto &node : walk_main_branch(tree_pointer->root_node_)) {
+            for (const auto &descendant : walk_to_root(node)) {
+                N_walked += descendant->children_.size();
+            }
+        }
+    }
+    assert(N_walked > 0);
+    assert(scratch.walk_stack.capacity() == stack_capacity);
+    assert(scratch.walk_queue.capacity() == queue_capacity);
+    test_passed("tree walks with a reused TreeScratch");
+
+    return 0;
+}
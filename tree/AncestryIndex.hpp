@@ -0,0 +1,326 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ANCESTRYINDEX_HPP
+#define ANCESTRYINDEX_HPP
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <iostream>
+#include "Tree.hpp"
+#include "Forest.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * Pre-order entry and exit times of every node of a Tree or of all trees of a
+ * Forest, indexed by data row. The subtree of a node is the interval
+ * [entry, exit), so whether one halo is a progenitor of another is a constant
+ * time test instead of a walk up the parents. The trees of a forest get
+ * disjoint intervals, because every tree numbers its nodes from its root row.
+ *
+ * With build_lca, a binary lifting table (the 2^k-th descendant of every
+ * node) is stored as well, for lowest common ancestor queries in
+ * O(log depth). Lazily built trees have to be expanded completely first, and
+ * rows that have no node (e.g. below the limits of a lazy tree) are not
+ * indexed.
+ */
+class AncestryIndex {
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+private:
+    size_t first_row_ = 0;
+    size_t end_row_ = 0;
+
+    // per local row, npos for rows that are not in any tree
+    std::vector<size_t> entry_;
+    std::vector<size_t> exit_;
+    std::vector<size_t> depth_;
+
+    // the root rows of the trees, and the end of the last tree
+    std::vector<size_t> root_rows_;
+
+    // descendant_levels_[k][i] is the local row of the 2^k-th descendant of
+    // local row i, or of the root if that is closer
+    std::vector<std::vector<size_t>> descendant_levels_;
+
+    void index_tree(const Tree &tree, std::vector<size_t> *parents);
+    size_t get_local_row(const size_t row) const;
+    void build_lca_table(std::vector<size_t> &parents, const size_t requested_threads);
+
+public:
+    AncestryIndex() { }
+
+    void build(const Tree &tree, const bool build_lca = false);
+    void build(const Forest &forest, const bool build_lca = false,
+               const size_t requested_threads = 0);
+
+    bool contains(const size_t row) const;
+    bool has_lca_table(void) const { return !descendant_levels_.empty(); }
+
+    size_t get_entry(const size_t row) const { return entry_[get_local_row(row)]; }
+    size_t get_exit(const size_t row) const { return exit_[get_local_row(row)]; }
+    size_t get_depth(const size_t row) const { return depth_[get_local_row(row)]; }
+    size_t get_subtree_size(const size_t row) const { return get_exit(row) - get_entry(row); }
+
+    bool is_progenitor(const size_t progenitor_row, const size_t row) const;
+    size_t get_root_row(const size_t row) const;
+    size_t lowest_common_ancestor(const size_t row_a, const size_t row_b) const;
+
+    size_t get_memory_bytes(void) const;
+};
+
+/**
+ * Numbers the nodes of one tree in pre-order, starting from its root row, and
+ * optionally records the local row of the descendant of every node.
+ */
+inline void AncestryIndex::index_tree(const Tree &tree, std::vector<size_t> *parents) {
+    tree.check_complete();
+    if (tree.root_node_ == nullptr) {
+        return;
+    }
+
+    size_t time = tree.root_node_row_in_data_ - first_row_;
+
+    // (node, next child to visit) of every node on the current path
+    std::vector<std::pair<const Node *, size_t>> path = {
+        std::make_pair(tree.root_node_.get(), 0)
+    };
+    const size_t root = tree.root_node_row_in_data_ - first_row_;
+    entry_[root] = time++;
+    depth_[root] = 0;
+    if (parents != nullptr) {
+        (*parents)[root] = root;
+    }
+
+    while (!path.empty()) {
+        auto &[node, next_child] = path.back();
+        const size_t local_row = node->get_data_row() - first_row_;
+
+        if (next_child == node->children_.size()) {
+            exit_[local_row] = time;
+            path.pop_back();
+            continue;
+        }
+
+        const Node *child = node->children_[next_child++].get();
+        const size_t child_row = child->get_data_row() - first_row_;
+        entry_[child_row] = time++;
+        depth_[child_row] = path.size();
+        if (parents != nullptr) {
+            (*parents)[child_row] = local_row;
+        }
+        path.push_back(std::make_pair(child, 0));
+    }
+}
+
+/**
+ * Level k is built from level k - 1 (the 2^k-th descendant is the 2^(k-1)-th
+ * descendant of the 2^(k-1)-th descendant), every level in parallel over the
+ * nodes.
+ */
+inline void AncestryIndex::build_lca_table(std::vector<size_t> &parents,
+                                           const size_t requested_threads) {
+    size_t max_depth = 0;
+    for (size_t i = 0; i < depth_.size(); i++) {
+        if (entry_[i] != npos) {
+            max_depth = std::max(max_depth, depth_[i]);
+        }
+    }
+
+    size_t levels = 1;
+    while (((size_t)1 << levels) <= max_depth) {
+        levels++;
+    }
+
+    descendant_levels_.clear();
+    descendant_levels_.reserve(levels);
+    descendant_levels_.push_back(std::move(parents));
+    for (size_t k = 1; k < levels; k++) {
+        const auto &previous = descendant_levels_[k - 1];
+        std::vector<size_t> level(previous.size(), npos);
+        parallel_for_chunks(0, previous.size(),
+                            [&](const size_t chunk_begin, const size_t chunk_end) {
+                                for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                    if (previous[i] != npos) {
+                                        level[i] = previous[previous[i]];
+                                    }
+                                }
+                            }, requested_threads);
+        descendant_levels_.push_back(std::move(level));
+    }
+}
+
+inline void AncestryIndex::build(const Tree &tree, const bool build_lca) {
+    first_row_ = tree.root_node_row_in_data_;
+    end_row_ = tree.next_root_node_row_in_data_;
+    root_rows_ = {first_row_, end_row_};
+
+    const size_t total_rows = end_row_ - first_row_;
+    entry_.assign(total_rows, npos);
+    exit_.assign(total_rows, npos);
+    depth_.assign(total_rows, npos);
+    descendant_levels_.clear();
+
+    std::vector<size_t> parents;
+    if (build_lca) {
+        parents.assign(total_rows, npos);
+    }
+    index_tree(tree, build_lca ? &parents : nullptr);
+
+    if (build_lca) {
+        build_lca_table(parents, 1);
+    }
+}
+
+/**
+ * Indexes every tree of the forest, in parallel over the trees. The trees
+ * must be in root row order, as Forest::build_forest stores them.
+ */
+inline void AncestryIndex::build(const Forest &forest, const bool build_lca,
+                                 const size_t requested_threads) {
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    const size_t total_trees = forest.get_number_of_trees();
+    root_rows_.clear();
+    root_rows_.reserve(total_trees + 1);
+    for (size_t i = 0; i < total_trees; i++) {
+        const auto &tree = forest.get_tree(i);
+        if (i > 0 && tree->root_node_row_in_data_ < root_rows_.back()) {
+            throw std::runtime_error("The trees of the forest are not in root row order.\n");
+        }
+        root_rows_.push_back(tree->root_node_row_in_data_);
+    }
+
+    first_row_ = total_trees > 0 ? root_rows_.front() : 0;
+    end_row_ = total_trees > 0 ? forest.get_tree(total_trees - 1)->next_root_node_row_in_data_ : 0;
+    root_rows_.push_back(end_row_);
+
+    const size_t total_rows = end_row_ - first_row_;
+    entry_.assign(total_rows, npos);
+    exit_.assign(total_rows, npos);
+    depth_.assign(total_rows, npos);
+    descendant_levels_.clear();
+
+    std::vector<size_t> parents;
+    if (build_lca) {
+        parents.assign(total_rows, npos);
+    }
+
+    // every tree only writes its own rows
+    parallel_for_chunks(0, total_trees,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                index_tree(*forest.get_tree(i), build_lca ? &parents : nullptr);
+                            }
+                        }, requested_threads);
+
+    if (build_lca) {
+        build_lca_table(parents, requested_threads);
+    }
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    std::cout << "Indexed " << total_rows << " rows in " << seconds_interval.count() << " s\n";
+#endif
+}
+
+inline bool AncestryIndex::contains(const size_t row) const {
+    return row >= first_row_ && row < end_row_ && entry_[row - first_row_] != npos;
+}
+
+/**
+ * The row relative to the first indexed row, for rows that have a node in
+ * one of the indexed trees.
+ */
+inline size_t AncestryIndex::get_local_row(const size_t row) const {
+    if (!contains(row)) {
+        throw std::runtime_error("The row " + std::to_string(row)
+                                 + " is not a node of the indexed trees.\n");
+    }
+
+    return row - first_row_;
+}
+
+/**
+ * True if progenitor_row is in the subtree of row, including row itself, the
+ * same convention as FlatTree::is_progenitor.
+ */
+inline bool AncestryIndex::is_progenitor(const size_t progenitor_row, const size_t row) const {
+    const size_t progenitor_entry = get_entry(progenitor_row);
+    return progenitor_entry >= get_entry(row) && progenitor_entry < get_exit(row);
+}
+
+/**
+ * The root row of the tree that a row belongs to, i.e. the halo at the end
+ * of its descendant line.
+ */
+inline size_t AncestryIndex::get_root_row(const size_t row) const {
+    get_local_row(row);
+    return *(std::upper_bound(root_rows_.begin(), root_rows_.end(), row) - 1);
+}
+
+/**
+ * The row of the latest halo that both rows descend into, or npos if they are
+ * in different trees. Needs the binary lifting table.
+ */
+inline size_t AncestryIndex::lowest_common_ancestor(const size_t row_a,
+                                                    const size_t row_b) const {
+    if (!has_lca_table()) {
+        throw std::runtime_error("The ancestry index was built without the LCA table.\n");
+    }
+
+    if (is_progenitor(row_a, row_b)) {
+        return row_b;
+    }
+    if (is_progenitor(row_b, row_a)) {
+        return row_a;
+    }
+    if (get_root_row(row_a) != get_root_row(row_b)) {
+        return npos;
+    }
+
+    // lift row_a as long as it stays below the common ancestor
+    size_t local_row = get_local_row(row_a);
+    for (size_t k = descendant_levels_.size(); k-- > 0;) {
+        const size_t descendant = descendant_levels_[k][local_row];
+        if (!is_progenitor(row_b, first_row_ + descendant)) {
+            local_row = descendant;
+        }
+    }
+
+    return first_row_ + descendant_levels_[0][local_row];
+}
+
+inline size_t AncestryIndex::get_memory_bytes(void) const {
+    size_t bytes = (entry_.capacity() + exit_.capacity() + depth_.capacity()
+                    + root_rows_.capacity()) * sizeof(size_t);
+    for (const auto &level : descendant_levels_) {
+        bytes += level.capacity() * sizeof(size_t);
+    }
+
+    return bytes;
+}
+
+#endif
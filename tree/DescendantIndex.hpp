@@ -0,0 +1,203 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DESCENDANTINDEX_HPP
+#define DESCENDANTINDEX_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdint>
+#include <limits>
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * Maps every row in [first_row, end_row) of a data set to the rows of its
+ * direct progenitors (the rows whose descendant_id is its id), stored in
+ * compressed sparse row format. The progenitors of a row are kept in the order
+ * that they appear in the data, and only rows after the descendant are
+ * considered, which is the same convention that Tree::recursive_build_tree
+ * uses. The index is built in a single pass over the rows, and the trees of
+ * a forest are indexed in parallel.
+ */
+class DescendantIndex {
+private:
+    size_t first_row_ = 0;
+    size_t end_row_ = 0;
+
+    // progenitors of local row i are progenitor_rows_[offsets_[i]:offsets_[i + 1]]
+    std::vector<size_t> offsets_;
+    std::vector<size_t> progenitor_rows_;
+
+public:
+    DescendantIndex() { }
+
+    template <typename DataFileFormat>
+    void build(const DataContainer<DataFileFormat> &data,
+               const size_t first_row, const size_t end_row);
+
+    template <typename DataFileFormat>
+    void build(const DataContainer<DataFileFormat> &data,
+               const std::vector<size_t> &root_rows,
+               const size_t requested_threads = 0);
+
+    size_t get_first_row(void) const { return first_row_; }
+    size_t get_end_row(void) const { return end_row_; }
+
+    size_t get_number_of_progenitors(const size_t row) const {
+        return offsets_[row - first_row_ + 1] - offsets_[row - first_row_];
+    }
+
+    // pointers to the first and one past the last progenitor row of a row
+    const size_t *progenitors_begin(const size_t row) const {
+        return progenitor_rows_.data() + offsets_[row - first_row_];
+    }
+
+    const size_t *progenitors_end(const size_t row) const {
+        return progenitor_rows_.data() + offsets_[row - first_row_ + 1];
+    }
+
+    size_t get_memory_bytes(void) const {
+        return (offsets_.capacity() + progenitor_rows_.capacity()) * sizeof(size_t);
+    }
+};
+
+/**
+ * The first row is the root of the tree, any other row with descendant_id = -1
+ * belongs to the next tree and is an error.
+ */
+template <typename DataFileFormat>
+void DescendantIndex::build(const DataContainer<DataFileFormat> &data,
+                            const size_t first_row, const size_t end_row) {
+    build(data, std::vector<size_t>{first_row, end_row}, 1);
+}
+
+/**
+ * Indexes the trees that start at the given root rows, followed by the end of
+ * the last tree (as in Forest::build_forest), with one thread per tree. The
+ * progenitors of a row are always in the same tree, so every tree only
+ * touches its own part of the arrays.
+ */
+template <typename DataFileFormat>
+void DescendantIndex::build(const DataContainer<DataFileFormat> &data,
+                            const std::vector<size_t> &root_rows,
+                            const size_t requested_threads) {
+    if (root_rows.empty()) {
+        throw std::runtime_error("The root rows must at least contain the end of the last tree.\n");
+    }
+
+    first_row_ = root_rows.front();
+    end_row_ = root_rows.back();
+
+    const size_t total_rows = end_row_ - first_row_;
+    const size_t total_trees = root_rows.size() - 1;
+    const ColumnSpan<std::variant<double, int64_t>> id_span
+        = data.get_column_span(data.get_internal_key("id"));
+    const ColumnSpan<std::variant<double, int64_t>> descendant_id_span
+        = data.get_column_span(data.get_internal_key("descendant_id"));
+
+    // local row of the descendant of every row, or total_rows if it has none
+    std::vector<size_t> descendant_rows(total_rows, total_rows);
+    offsets_.assign(total_rows + 1, 0);
+    parallel_for_chunks(0, total_trees,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            // id -> local row
+                            std::unordered_map<int64_t, size_t> id_to_row;
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                const size_t tree_begin = root_rows[t] - first_row_;
+                                const size_t tree_end = root_rows[t + 1] - first_row_;
+
+                                id_to_row.clear();
+                                id_to_row.reserve(tree_end - tree_begin);
+                                for (size_t i = tree_begin; i < tree_end; i++) {
+                                    id_to_row.insert(std::make_pair(id_span.get<int64_t>(first_row_ + i), i));
+                                }
+
+                                for (size_t i = tree_begin + 1; i < tree_end; i++) {
+                                    const auto descendant_id = descendant_id_span.get<int64_t>(first_row_ + i);
+                                    if (descendant_id == -1) {
+                                        throw std::runtime_error("Should never reach the next tree!");
+                                    }
+
+                                    auto descendant = id_to_row.find(descendant_id);
+                                    // progenitors are always after their descendant in the data
+                                    if (descendant != id_to_row.end() && descendant->second < i) {
+                                        descendant_rows[i] = descendant->second;
+                                        offsets_[descendant->second + 1]++;
+                                    }
+                                }
+                            }
+                        }, requested_threads, 1);
+
+    for (size_t i = 0; i < total_rows; i++) {
+        offsets_[i + 1] += offsets_[i];
+    }
+
+    // fill in increasing row order, so the progenitors stay in data order
+    progenitor_rows_.resize(offsets_[total_rows]);
+    std::vector<size_t> fill_position(offsets_.begin(), offsets_.end() - 1);
+    parallel_for_chunks(0, total_trees,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                for (size_t i = root_rows[t] - first_row_ + 1;
+                                     i < root_rows[t + 1] - first_row_; i++) {
+                                    if (descendant_rows[i] != total_rows) {
+                                        progenitor_rows_[fill_position[descendant_rows[i]]++] = first_row_ + i;
+                                    }
+                                }
+                            }
+                        }, requested_threads, 1);
+}
+
+
+// the flag key for find_main_progenitor() when no flag column is used
+constexpr size_t no_progenitor_flag_key = std::numeric_limits<size_t>::max();
+
+/**
+ * The main progenitor among the progenitor rows [begin, end), which must not
+ * be empty. It is the first row whose flag column (e.g.
+ * is_most_massive_progenitor) is set, and otherwise (or with
+ * no_progenitor_flag_key) the first of the rows with the largest mass.
+ */
+template <typename DataFileFormat>
+size_t find_main_progenitor(const DataContainer<DataFileFormat> &data,
+                            const size_t *begin, const size_t *end,
+                            const size_t mass_key, const size_t flag_key) {
+    if (flag_key != no_progenitor_flag_key) {
+        for (auto p = begin; p != end; p++) {
+            if (data.get_data_as_double(*p, flag_key) != 0.) {
+                return *p;
+            }
+        }
+    }
+
+    size_t main_row = *begin;
+    double main_mass = data.get_data_as_double(main_row, mass_key);
+    for (auto p = begin + 1; p != end; p++) {
+        const double mass = data.get_data_as_double(*p, mass_key);
+        if (mass > main_mass) {
+            main_row = *p;
+            main_mass = mass;
+        }
+    }
+
+    return main_row;
+}
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FINALDESCENDANTS_HPP
+#define FINALDESCENDANTS_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include "Forest.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * The final descendant (the root at the end of the descendant line) of every
+ * row of a consistent-trees data set, e.g. to look up the z = 0 mass of every
+ * halo in a snapshot.
+ *
+ * The descendant row of every row is found first, in parallel over the trees,
+ * and then every row jumps to the descendant of its descendant in parallel
+ * until all of them reach a root, which takes log2 of the longest descendant
+ * line in rounds, i.e. O(N log depth) work. A row whose descendant is not in
+ * its tree (e.g. because the rows were cut) ends at the last descendant that
+ * is in the data. A line can be at most N rows long, so the rows that are
+ * still changing after ceil(log2(N)) + 1 rounds are on a cycle of
+ * descendants, which is an error in the data.
+ */
+class FinalDescendants {
+private:
+    std::vector<size_t> final_rows_;
+    size_t rounds_ = 0;
+
+public:
+    FinalDescendants() { }
+
+    template <typename DataFileFormat>
+    void build(const DataContainer<DataFileFormat> &data, const size_t requested_threads = 0);
+
+    size_t get_number_of_rows(void) const { return final_rows_.size(); }
+    size_t get_number_of_rounds(void) const { return rounds_; }
+    size_t get_final_row(const size_t row) const { return final_rows_[row]; }
+    const std::vector<size_t> &get_final_rows(void) const { return final_rows_; }
+
+    template <typename DataFileFormat>
+    std::vector<double> get_final_values(const DataContainer<DataFileFormat> &data,
+                                         const size_t key,
+                                         const size_t requested_threads = 0) const;
+};
+
+template <typename DataFileFormat>
+void FinalDescendants::build(const DataContainer<DataFileFormat> &data,
+                             const size_t requested_threads) {
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    const size_t total_rows = data.get_number_of_rows();
+    const ColumnSpan<std::variant<double, int64_t>> id_span
+        = data.get_column_span(data.get_internal_key("id"));
+    const ColumnSpan<std::variant<double, int64_t>> descendant_id_span
+        = data.get_column_span(data.get_internal_key("descendant_id"));
+
+    auto root_rows = Forest::find_root_rows(data);
+    root_rows.push_back(total_rows);
+
+    // the descendant row of every row, roots (and any rows before the first
+    // root) point to themselves
+    std::vector<size_t> next_rows(total_rows);
+    for (size_t row = 0; row < root_rows[0]; row++) {
+        next_rows[row] = row;
+    }
+    parallel_for_chunks(0, root_rows.size() - 1,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::unordered_map<int64_t, size_t> id_to_row;
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                id_to_row.clear();
+                                id_to_row.reserve(root_rows[t + 1] - root_rows[t]);
+                                for (size_t row = root_rows[t]; row < root_rows[t + 1]; row++) {
+                                    id_to_row.insert(std::make_pair(id_span.get<int64_t>(row), row));
+                                }
+
+                                for (size_t row = root_rows[t]; row < root_rows[t + 1]; row++) {
+                                    auto descendant 
+                                        = id_to_row.find(descendant_id_span.get<int64_t>(row));
+                                    next_rows[row] = (descendant != id_to_row.end()) 
+                                                     ? descendant->second : row;
+                                }
+                            }
+                        }, requested_threads);
+
+    // pointer jumping, every round doubles the distance that each row covers
+    size_t max_rounds = 1;
+    while (((size_t)1 << (max_rounds - 1)) < total_rows) {
+        max_rounds++;
+    }
+
+    final_rows_.resize(total_rows);
+    rounds_ = 0;
+    std::atomic<bool> changed(true);
+    while (changed) {
+        if (rounds_ == max_rounds) {
+            final_rows_.clear();
+            rounds_ = 0;
+            throw std::runtime_error("The descendants of some rows form a cycle.\n");
+        }
+
+        changed = false;
+        parallel_for_chunks(0, total_rows,
+                            [&](const size_t chunk_begin, const size_t chunk_end) {
+                                bool chunk_changed = false;
+                                for (size_t row = chunk_begin; row < chunk_end; row++) {
+                                    final_rows_[row] = next_rows[next_rows[row]];
+                                    chunk_changed |= (final_rows_[row] != next_rows[row]);
+                                }
+                                if (chunk_changed) {
+                                    changed = true;
+                                }
+                            }, requested_threads);
+        std::swap(final_rows_, next_rows);
+        rounds_++;
+    }
+    final_rows_.swap(next_rows);
+    std::vector<size_t>().swap(next_rows);
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    std::cout << "Found the final descendants of " << total_rows << " rows in ";
+    std::cout << rounds_ << " rounds and " << seconds_interval.count() << " s\n";
+#endif
+}
+
+/**
+ * The value of a column (e.g. virial_mass) of the final descendant of every
+ * row.
+ */
+template <typename DataFileFormat>
+std::vector<double> FinalDescendants::get_final_values(const DataContainer<DataFileFormat> &data,
+                                                       const size_t key,
+                                                       const size_t requested_threads) const {
+    std::vector<double> final_values(final_rows_.size());
+    parallel_for_chunks(0, final_rows_.size(),
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t row = chunk_begin; row < chunk_end; row++) {
+                                final_values[row] = data.get_data_as_double(final_rows_[row], key);
+                            }
+                        }, requested_threads);
+
+    return final_values;
+}
+
+#endif
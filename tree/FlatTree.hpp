@@ -0,0 +1,451 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FLATTREE_HPP
+#define FLATTREE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include "DescendantIndex.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/MemoryReport.hpp"
+
+/**
+ * A compact alternative to Tree where the nodes are not separate objects, but
+ * indices into a few contiguous arrays (16 bytes per node in total). The nodes
+ * are stored in depth-first (pre-order) order with the children in data order,
+ * so node 0 is the root and the first child of a node is the next node. The
+ * data row of a node is stored as an offset from the row of the root.
+ *
+ * Because of the depth-first order, the subtree and the main branch of a node
+ * are contiguous ranges of nodes, which are available after
+ * build_tree_from_depth_first() or compute_depth_first_ranges().
+ */
+class FlatTree {
+public:
+    using NodeIndex = int32_t;
+    static constexpr NodeIndex null_node = -1;
+
+    size_t root_node_row_in_data_;
+    size_t next_root_node_row_in_data_;
+
+private:
+    std::vector<NodeIndex> parent_;
+    std::vector<NodeIndex> first_child_;
+    std::vector<NodeIndex> next_sibling_;
+    std::vector<uint32_t> data_row_offset_;
+
+    // optional, the last node in the subtree and in the main branch of every
+    // node, see compute_depth_first_ranges()
+    std::vector<NodeIndex> last_progenitor_;
+    std::vector<NodeIndex> last_mainleaf_;
+
+public:
+    FlatTree(size_t root_node_row_in_data = 0,
+             size_t next_root_node_row_in_data = 0) {
+        root_node_row_in_data_ = root_node_row_in_data;
+        next_root_node_row_in_data_ = next_root_node_row_in_data;
+    }
+
+    template <typename DataFileFormat>
+    void build_tree(const DataContainer<DataFileFormat> &data);
+
+    template <typename DataFileFormat>
+    void build_tree_from_depth_first(const DataContainer<DataFileFormat> &data);
+
+    void load_topology(const NodeIndex *parent, const NodeIndex *first_child,
+                       const NodeIndex *next_sibling, const uint32_t *data_row_offset,
+                       const size_t total_nodes);
+
+    void compute_depth_first_ranges(void);
+    bool has_depth_first_ranges(void) const { return !last_progenitor_.empty(); }
+    std::pair<NodeIndex, NodeIndex> get_subtree_range(const NodeIndex node) const;
+    std::pair<NodeIndex, NodeIndex> get_main_branch_range(const NodeIndex node) const;
+    bool is_progenitor(const NodeIndex progenitor, const NodeIndex node) const;
+
+    size_t get_number_of_nodes(void) const { return parent_.size(); }
+    NodeIndex get_root_node(void) const { return parent_.empty() ? null_node : 0; }
+    NodeIndex get_parent(const NodeIndex node) const { return parent_[node]; }
+    NodeIndex get_first_child(const NodeIndex node) const { return first_child_[node]; }
+    NodeIndex get_next_sibling(const NodeIndex node) const { return next_sibling_[node]; }
+    size_t get_data_row(const NodeIndex node) const {
+        return root_node_row_in_data_ + data_row_offset_[node];
+    }
+    size_t get_number_of_children(const NodeIndex node) const;
+
+    template <typename T, typename DataFileFormat>
+    void traverse_most_massive_branch(const DataContainer<DataFileFormat> &data,
+                                      const NodeIndex node,
+                                      const size_t key,
+                                      std::vector<T> &value_list) const;
+
+    template <typename T, typename Comparison, typename DataFileFormat>
+    std::vector<NodeIndex>
+    breadth_first_search(const DataContainer<DataFileFormat> &data,
+                         const NodeIndex node,
+                         const size_t key, const T query,
+                         Comparison compare) const;
+
+    template <typename T, typename Comparison, typename DataFileFormat>
+    size_t breadth_first_search(const DataContainer<DataFileFormat> &data,
+                                const NodeIndex node,
+                                const size_t key, const T query,
+                                Comparison compare, std::vector<NodeIndex> &nodes,
+                                std::vector<NodeIndex> &to_visit) const;
+
+    MemoryReport get_memory_report(void) const;
+};
+
+/**
+ * Builds the same tree as Tree::build_tree, in O(N) through a DescendantIndex.
+ */
+template <typename DataFileFormat>
+void FlatTree::build_tree(const DataContainer<DataFileFormat> &data) {
+    const size_t total_rows = next_root_node_row_in_data_ - root_node_row_in_data_;
+    if (total_rows > (size_t)std::numeric_limits<NodeIndex>::max()) {
+        throw std::runtime_error("The tree has too many nodes for a FlatTree.\n");
+    }
+
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    DescendantIndex descendant_index;
+    descendant_index.build(data, root_node_row_in_data_, next_root_node_row_in_data_);
+
+    parent_.clear();
+    first_child_.clear();
+    next_sibling_.clear();
+    data_row_offset_.clear();
+    last_progenitor_.clear();
+    last_mainleaf_.clear();
+    parent_.reserve(total_rows);
+    first_child_.reserve(total_rows);
+    next_sibling_.reserve(total_rows);
+    data_row_offset_.reserve(total_rows);
+
+    // the most recently added child of every node, to link the siblings
+    std::vector<NodeIndex> last_child;
+    last_child.reserve(total_rows);
+
+    // (data row, parent node) pairs, the children are pushed in reverse so
+    // that they are numbered in data order
+    std::vector<std::pair<size_t, NodeIndex>> to_visit = {
+        std::make_pair(root_node_row_in_data_, null_node)
+    };
+    while (!to_visit.empty()) {
+        const auto [row, parent] = to_visit.back();
+        to_visit.pop_back();
+
+        const NodeIndex node = (NodeIndex)parent_.size();
+        parent_.push_back(parent);
+        first_child_.push_back(null_node);
+        next_sibling_.push_back(null_node);
+        data_row_offset_.push_back((uint32_t)(row - root_node_row_in_data_));
+        last_child.push_back(null_node);
+
+        if (parent != null_node) {
+            if (last_child[parent] == null_node) {
+                first_child_[parent] = node;
+            }
+            else {
+                next_sibling_[last_child[parent]] = node;
+            }
+            last_child[parent] = node;
+        }
+
+        const size_t *progenitor_begin = descendant_index.progenitors_begin(row);
+        const size_t *progenitor_row = descendant_index.progenitors_end(row);
+        while (progenitor_row != progenitor_begin) {
+            progenitor_row--;
+            to_visit.push_back(std::make_pair(*progenitor_row, node));
+        }
+    }
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    float iterations_per_second = (float)(parent_.size()) / seconds_interval.count();
+    std::cout << "Duration was " << seconds_interval.count() << " s\n";
+    std::cout << "The speed was " << iterations_per_second << " nodes per second\n";
+#endif
+}
+
+/**
+ * Builds the tree directly from the depth-first ordering that consistent-trees
+ * writes into every file, without searching for any ids. Node i is the halo
+ * with depth_first_id = i + depth_first_id of the root, so the children are
+ * in depth-first order (most massive progenitor first) rather than in data
+ * order. The subtree and main branch ranges are filled as well.
+ *
+ * Needs the depth_first_id, last_progenitor_depthfirst_id,
+ * next_coprogenitor_depthfirst_id and last_mainleaf_depthfirst_id columns.
+ */
+template <typename DataFileFormat>
+void FlatTree::build_tree_from_depth_first(const DataContainer<DataFileFormat> &data) {
+    const size_t total_rows = next_root_node_row_in_data_ - root_node_row_in_data_;
+    if (total_rows > (size_t)std::numeric_limits<NodeIndex>::max()) {
+        throw std::runtime_error("The tree has too many nodes for a FlatTree.\n");
+    }
+
+    const ColumnSpan<std::variant<double, int64_t>> depth_first_span
+        = data.get_column_span(data.get_internal_key("depth_first_id"));
+    const ColumnSpan<std::variant<double, int64_t>> last_progenitor_span
+        = data.get_column_span(data.get_internal_key("last_progenitor_depthfirst_id"));
+    const ColumnSpan<std::variant<double, int64_t>> next_coprogenitor_span
+        = data.get_column_span(data.get_internal_key("next_coprogenitor_depthfirst_id"));
+    const ColumnSpan<std::variant<double, int64_t>> last_mainleaf_span
+        = data.get_column_span(data.get_internal_key("last_mainleaf_depthfirst_id"));
+
+    const int64_t root_depth_first_id = depth_first_span.get<int64_t>(root_node_row_in_data_);
+    const int64_t total_nodes = (int64_t)total_rows;
+
+    // converts a depth-first id into a node index, checking that it is in the tree
+    auto to_node = [&](const int64_t depth_first_id) {
+        const int64_t node = depth_first_id - root_depth_first_id;
+        if (node < 0 || node >= total_nodes) {
+            throw std::runtime_error("The depth-first ids of the tree are not contiguous.\n");
+        }
+        return (NodeIndex)node;
+    };
+
+    parent_.assign(total_rows, null_node);
+    first_child_.assign(total_rows, null_node);
+    next_sibling_.assign(total_rows, null_node);
+    data_row_offset_.assign(total_rows, std::numeric_limits<uint32_t>::max());
+    last_progenitor_.assign(total_rows, null_node);
+    last_mainleaf_.assign(total_rows, null_node);
+
+    for (size_t i = 0; i < total_rows; i++) {
+        const size_t row = root_node_row_in_data_ + i;
+        const auto node = to_node(depth_first_span.get<int64_t>(row));
+        if (data_row_offset_[node] != std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("There are duplicate depth-first ids in the tree.\n");
+        }
+
+        data_row_offset_[node] = (uint32_t)i;
+        last_progenitor_[node] = to_node(last_progenitor_span.get<int64_t>(row));
+        last_mainleaf_[node] = to_node(last_mainleaf_span.get<int64_t>(row));
+        // the main branch starts at the node and stays inside of its progenitors
+        if (last_mainleaf_[node] < node || last_mainleaf_[node] > last_progenitor_[node]) {
+            throw std::runtime_error("The last main leaf of a halo is outside of "
+                                     "its progenitors in depth-first order.\n");
+        }
+
+        // the first progenitor always directly follows its descendant
+        if (last_progenitor_[node] > node) {
+            first_child_[node] = node + 1;
+        }
+
+        // the next co-progenitor has to come later, otherwise the children never end
+        const auto next_coprogenitor_id = next_coprogenitor_span.get<int64_t>(row);
+        if (next_coprogenitor_id != -1) {
+            next_sibling_[node] = to_node(next_coprogenitor_id);
+            if (next_sibling_[node] <= node) {
+                throw std::runtime_error("The next co-progenitor of a halo does not follow it "
+                                         "in depth-first order.\n");
+            }
+        }
+    }
+
+    for (NodeIndex node = 0; node < (NodeIndex)total_rows; node++) {
+        for (auto child = first_child_[node]; child != null_node; child = next_sibling_[child]) {
+            if (child > last_progenitor_[node] || parent_[child] != null_node) {
+                throw std::runtime_error("The co-progenitors of a halo are outside of "
+                                         "its progenitors in depth-first order.\n");
+            }
+            parent_[child] = node;
+        }
+    }
+
+    // every halo other than the root has to be reached from its descendant
+    for (NodeIndex node = 1; node < (NodeIndex)total_rows; node++) {
+        if (parent_[node] == null_node) {
+            throw std::runtime_error("A halo is not linked to its descendant "
+                                     "in depth-first order.\n");
+        }
+    }
+}
+
+/**
+ * Fills the subtree and main branch ranges for a tree built with build_tree().
+ * Since the nodes are in depth-first order, all of the progenitors of a node
+ * directly follow it, and so do the nodes on its main branch.
+ */
+inline void FlatTree::compute_depth_first_ranges(void) {
+    const auto total_nodes = (NodeIndex)get_number_of_nodes();
+    last_progenitor_.resize(total_nodes);
+    last_mainleaf_.resize(total_nodes);
+
+    for (NodeIndex node = 0; node < total_nodes; node++) {
+        last_progenitor_[node] = node;
+    }
+
+    // children always have larger indices than their parents
+    for (NodeIndex node = total_nodes - 1; node >= 0; node--) {
+        if (parent_[node] != null_node) {
+            last_progenitor_[parent_[node]] = std::max(last_progenitor_[parent_[node]],
+                                                       last_progenitor_[node]);
+        }
+
+        const auto first_child = first_child_[node];
+        last_mainleaf_[node] = (first_child == null_node) ? node : last_mainleaf_[first_child];
+    }
+}
+
+/**
+ * Returns [first, last + 1) of the node and all of its progenitors.
+ */
+inline std::pair<FlatTree::NodeIndex, FlatTree::NodeIndex>
+FlatTree::get_subtree_range(const NodeIndex node) const {
+    return std::make_pair(node, last_progenitor_[node] + 1);
+}
+
+/**
+ * Returns [first, last + 1) of the main branch of the node, ending at the
+ * last main leaf.
+ */
+inline std::pair<FlatTree::NodeIndex, FlatTree::NodeIndex>
+FlatTree::get_main_branch_range(const NodeIndex node) const {
+    return std::make_pair(node, last_mainleaf_[node] + 1);
+}
+
+/**
+ * True if progenitor is in the subtree of node (a node counts as its own
+ * progenitor).
+ */
+inline bool FlatTree::is_progenitor(const NodeIndex progenitor, const NodeIndex node) const {
+    return progenitor >= node && progenitor <= last_progenitor_[node];
+}
+
+/**
+ * Replaces the tree with previously built topology arrays (e.g. from a
+ * ForestFile), which must be in depth-first order with node 0 as the root.
+ */
+inline void FlatTree::load_topology(const NodeIndex *parent, const NodeIndex *first_child,
+                                    const NodeIndex *next_sibling,
+                                    const uint32_t *data_row_offset,
+                                    const size_t total_nodes) {
+    parent_.assign(parent, parent + total_nodes);
+    first_child_.assign(first_child, first_child + total_nodes);
+    next_sibling_.assign(next_sibling, next_sibling + total_nodes);
+    data_row_offset_.assign(data_row_offset, data_row_offset + total_nodes);
+    last_progenitor_.clear();
+    last_mainleaf_.clear();
+}
+
+inline size_t FlatTree::get_number_of_children(const NodeIndex node) const {
+    size_t number_of_children = 0;
+    for (auto child = first_child_[node]; child != null_node; child = next_sibling_[child]) {
+        number_of_children++;
+    }
+
+    return number_of_children;
+}
+
+/**
+ * Same as Tree::traverse_most_massive_branch, the first child is assumed to
+ * be the most massive progenitor.
+ */
+template <typename T, typename DataFileFormat>
+void FlatTree::traverse_most_massive_branch(const DataContainer<DataFileFormat> &data,
+                                            const NodeIndex node,
+                                            const size_t key,
+                                            std::vector<T> &value_list) const {
+    for (auto branch_node = node; branch_node != null_node;
+         branch_node = first_child_[branch_node]) {
+        value_list.push_back(data.template get_data<T>(get_data_row(branch_node), key));
+    }
+}
+
+/**
+ * Same as Tree::breadth_first_search, but returns the indices of the nodes.
+ */
+template <typename T, typename Comparison, typename DataFileFormat>
+std::vector<FlatTree::NodeIndex>
+FlatTree::breadth_first_search(const DataContainer<DataFileFormat> &data,
+                               const NodeIndex node,
+                               const size_t key, const T query,
+                               Comparison compare) const {
+    std::vector<NodeIndex> nodes;
+    std::vector<NodeIndex> to_visit;
+    breadth_first_search(data, node, key, query, compare, nodes, to_visit);
+
+    return nodes;
+}
+
+/**
+ * Writes the matching nodes into nodes (which is cleared first), using
+ * to_visit as the queue. Both buffers can be reused between searches, so
+ * that repeated searches over a forest do not allocate once the buffers are
+ * large enough. Returns the number of matching nodes.
+ */
+template <typename T, typename Comparison, typename DataFileFormat>
+size_t FlatTree::breadth_first_search(const DataContainer<DataFileFormat> &data,
+                                      const NodeIndex node,
+                                      const size_t key, const T query,
+                                      Comparison compare, std::vector<NodeIndex> &nodes,
+                                      std::vector<NodeIndex> &to_visit) const {
+    nodes.clear();
+    to_visit.clear();
+    if (node == null_node) {
+        return 0;
+    }
+
+    // the queue never holds more than the number of nodes, so a vector with
+    // a moving front is enough
+    to_visit.push_back(node);
+    for (size_t front = 0; front < to_visit.size(); front++) {
+        const auto current_node = to_visit[front];
+        for (auto child = first_child_[current_node]; child != null_node;
+             child = next_sibling_[child]) {
+            to_visit.push_back(child);
+        }
+
+        if (compare(data.template get_data<T>(get_data_row(current_node), key), query)) {
+            nodes.push_back(current_node);
+        }
+    }
+
+    return nodes.size();
+}
+
+inline MemoryReport FlatTree::get_memory_report(void) const {
+    MemoryReport report;
+
+    report.entries.push_back(std::make_pair("parents", vector_bytes(parent_)));
+    report.entries.push_back(std::make_pair("first children", vector_bytes(first_child_)));
+    report.entries.push_back(std::make_pair("next siblings", vector_bytes(next_sibling_)));
+    report.entries.push_back(std::make_pair("data rows", vector_bytes(data_row_offset_)));
+    if (has_depth_first_ranges()) {
+        report.entries.push_back(std::make_pair("last progenitors", vector_bytes(last_progenitor_)));
+        report.entries.push_back(std::make_pair("last main leaves", vector_bytes(last_mainleaf_)));
+    }
+    for (const auto &[name, bytes] : report.entries) {
+        report.data_bytes += bytes;
+    }
+    report.metadata_bytes = sizeof(root_node_row_in_data_) + sizeof(next_root_node_row_in_data_);
+
+    return report;
+}
+
+#endif
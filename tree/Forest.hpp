@@ -0,0 +1,228 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FOREST_HPP
+#define FOREST_HPP
+
+#include <vector>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include "Tree.hpp"
+#include "DescendantIndex.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/MemoryReport.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * All of the trees in a consistent-trees data set. Every tree occupies the
+ * rows from its root (descendant_id = -1) up to the next root, so the trees
+ * are independent and are built concurrently. The trees are always stored in
+ * root row order, no matter which thread built them.
+ */
+class Forest {
+public:
+    std::vector<std::shared_ptr<Tree>> trees_;
+
+    Forest() { }
+
+    template <typename DataFileFormat>
+    static std::vector<size_t> find_root_rows(const DataContainer<DataFileFormat> &data);
+
+    template <typename DataFileFormat>
+    void build_forest(DataContainer<DataFileFormat> &data,
+                      const TreeBuildMode mode = TreeBuildMode::adjacency,
+                      const size_t requested_threads = 0,
+                      const bool use_node_arenas = false);
+
+    template <typename DataFileFormat>
+    void build_forest_lazy(const DataContainer<DataFileFormat> &data,
+                           const LazyTreeLimits &limits = LazyTreeLimits(),
+                           const size_t requested_threads = 0,
+                           const bool use_node_arenas = false);
+
+    size_t get_number_of_trees(void) const { return trees_.size(); }
+    const std::shared_ptr<Tree> &get_tree(const size_t index) const { return trees_[index]; }
+    size_t get_number_of_nodes(void) const;
+    MemoryReport get_memory_report(void) const;
+};
+
+/**
+ * Returns the rows with descendant_id = -1, in increasing order.
+ */
+template <typename DataFileFormat>
+std::vector<size_t> Forest::find_root_rows(const DataContainer<DataFileFormat> &data) {
+    const ColumnSpan<std::variant<double, int64_t>> descendant_id_span
+        = data.get_column_span(data.get_internal_key("descendant_id"));
+
+    std::vector<size_t> root_rows;
+    for (size_t row = 0; row < descendant_id_span.size(); row++) {
+        if (descendant_id_span.get<int64_t>(row) == -1) {
+            root_rows.push_back(row);
+        }
+    }
+
+    return root_rows;
+}
+
+/**
+ * Builds every tree in the data. The trees are handed to the threads one at
+ * a time, largest first, through the dynamic scheduling of
+ * parallel_for_chunks, so that a few very large trees do not end up queued
+ * behind many small ones on the same thread. With use_node_arenas, every
+ * tree allocates its nodes from its own NodeArena.
+ */
+template <typename DataFileFormat>
+void Forest::build_forest(DataContainer<DataFileFormat> &data,
+                          const TreeBuildMode mode,
+                          const size_t requested_threads,
+                          const bool use_node_arenas) {
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    auto root_rows = find_root_rows(data);
+    root_rows.push_back(data.get_number_of_rows());
+
+    const size_t total_trees = root_rows.size() - 1;
+    trees_.assign(total_trees, nullptr);
+
+    std::vector<size_t> build_order(total_trees);
+    std::iota(build_order.begin(), build_order.end(), 0);
+    std::stable_sort(build_order.begin(), build_order.end(),
+                     [&root_rows](const size_t a, const size_t b) {
+                         return root_rows[a + 1] - root_rows[a] > root_rows[b + 1] - root_rows[b];
+                     });
+
+    parallel_for_chunks(0, total_trees, 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            TreeScratch scratch;
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                const size_t tree_index = build_order[i];
+                                const size_t root_row = root_rows[tree_index];
+
+                                auto tree = std::make_shared<Tree>(
+                                    nullptr, root_row, root_rows[tree_index + 1]
+                                );
+                                if (use_node_arenas) {
+                                    tree->use_node_arena();
+                                }
+                                tree->build_tree(data, mode, scratch);
+                                trees_[tree_index] = tree;
+                            }
+                        }, requested_threads, 1);
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    std::cout << "Built " << total_trees << " trees in " << seconds_interval.count() << " s\n";
+#endif
+}
+
+/**
+ * Builds the root of every tree lazily (see Tree::build_tree_lazy). The
+ * progenitors of all of the rows are indexed once, in parallel, and the index
+ * is shared by every tree, so expanding a node of a tree never has to scan
+ * the rest of the tree.
+ */
+template <typename DataFileFormat>
+void Forest::build_forest_lazy(const DataContainer<DataFileFormat> &data,
+                               const LazyTreeLimits &limits,
+                               const size_t requested_threads,
+                               const bool use_node_arenas) {
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    auto root_rows = find_root_rows(data);
+    root_rows.push_back(data.get_number_of_rows());
+
+    const size_t total_trees = root_rows.size() - 1;
+    trees_.assign(total_trees, nullptr);
+
+    auto descendant_index = std::make_shared<DescendantIndex>();
+    descendant_index->build(data, root_rows, requested_threads);
+
+    parallel_for_chunks(0, total_trees, 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                auto tree = std::make_shared<Tree>(
+                                    nullptr, root_rows[i], root_rows[i + 1]
+                                );
+                                if (use_node_arenas) {
+                                    tree->use_node_arena();
+                                }
+                                tree->build_tree_lazy(data, limits, descendant_index);
+                                trees_[i] = tree;
+                            }
+                        }, requested_threads);
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    std::cout << "Built " << total_trees << " lazy trees in " << seconds_interval.count() << " s\n";
+#endif
+}
+
+inline size_t Forest::get_number_of_nodes(void) const {
+    size_t total_nodes = 0;
+    for (const auto &tree : trees_) {
+        total_nodes += tree->get_number_of_nodes();
+    }
+
+    return total_nodes;
+}
+
+inline MemoryReport Forest::get_memory_report(void) const {
+    MemoryReport report;
+
+    size_t node_bytes = 0;
+    size_t child_list_bytes = 0;
+    size_t node_arena_bytes = 0;
+    for (const auto &tree : trees_) {
+        auto tree_report = tree->get_memory_report();
+        for (const auto &[name, bytes] : tree_report.entries) {
+            if (name == "nodes") {
+                node_bytes += bytes;
+            }
+            else if (name == "child lists") {
+                child_list_bytes += bytes;
+            }
+            else if (name == "node arena") {
+                node_arena_bytes += bytes;
+            }
+            else {
+                throw std::runtime_error("Unknown entry " + name 
+                                         + " in the memory report of a tree.\n");
+            }
+        }
+    }
+
+    report.entries.push_back(std::make_pair("nodes", node_bytes));
+    report.entries.push_back(std::make_pair("child lists", child_list_bytes));
+    report.entries.push_back(std::make_pair("node arena", node_arena_bytes));
+    report.entries.push_back(std::make_pair("trees", 
+                                            vector_bytes(trees_) + trees_.size() * sizeof(Tree)));
+    report.data_bytes = node_bytes + child_list_bytes + node_arena_bytes;
+    report.index_bytes = report.entries.back().second;
+    report.metadata_bytes = sizeof(*this);
+
+    return report;
+}
+
+#endif
@@ -0,0 +1,612 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FORESTFILE_HPP
+#define FORESTFILE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Tree.hpp"
+#include "FlatTree.hpp"
+#include "Forest.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * A binary file with the topology of every tree of a forest, so that the
+ * trees are built once and afterwards reopened without parsing the data or
+ * matching any ids. The file is memory mapped read-only, so opening it only
+ * reads the header, and pulling out one tree only touches the pages of that
+ * tree.
+ *
+ * The file has a header, a table with one entry per tree (root id, root rows
+ * and the range of its nodes), the tree indices sorted by root id, and the
+ * node arrays of all trees one after the other. The nodes of every tree are
+ * in depth-first order, exactly like a FlatTree, with the parent, first child
+ * and next sibling relative to the first node of the tree, the data row as an
+ * offset from the root row, and the halo id.
+ */
+class ForestFile {
+private:
+    struct FileHeader {
+        char magic[8];
+        uint64_t version;
+        uint64_t trees;
+        uint64_t nodes;
+        uint64_t total_bytes;
+        uint64_t tree_table_offset;
+        uint64_t sorted_trees_offset;
+        uint64_t parent_offset;
+        uint64_t first_child_offset;
+        uint64_t next_sibling_offset;
+        uint64_t data_row_offset_offset;
+        uint64_t id_offset;
+    };
+
+    struct TreeEntry {
+        int64_t root_id;
+        uint64_t root_row;
+        uint64_t next_root_row;
+        uint64_t first_node;
+        uint64_t nodes;
+    };
+
+    // the depth-first topology of a single tree while it is being written
+    struct FlatTopology {
+        std::vector<FlatTree::NodeIndex> parent;
+        std::vector<FlatTree::NodeIndex> first_child;
+        std::vector<FlatTree::NodeIndex> next_sibling;
+        std::vector<uint32_t> data_row_offset;
+        std::vector<int64_t> id;
+    };
+
+    static constexpr char magic_[8] = "HDMFRST";
+    static constexpr uint64_t format_version_ = 1;
+    static constexpr size_t alignment_ = 64;
+
+    std::string file_name_;
+    void *mapping_ = nullptr;
+    size_t mapping_bytes_ = 0;
+    const FileHeader *header_ = nullptr;
+    const TreeEntry *tree_table_ = nullptr;
+    const uint64_t *sorted_trees_ = nullptr;
+
+    static void flatten_tree(const Tree &tree, FlatTopology &topology);
+    void release(void);
+    bool section_fits(const uint64_t offset, const uint64_t count, const size_t element_bytes) const;
+    const TreeEntry &get_entry(const size_t tree_index) const;
+    size_t find_tree(const int64_t root_id) const;
+    void check_topology(const size_t tree_index, const bool check_links) const;
+
+    template <typename T>
+    const T *get_array(const uint64_t offset, const size_t tree_index) const;
+
+public:
+    ForestFile(const std::string &file_name);
+    ~ForestFile();
+
+    ForestFile(const ForestFile &) = delete;
+    ForestFile &operator=(const ForestFile &) = delete;
+    ForestFile(ForestFile &&other) noexcept;
+    ForestFile &operator=(ForestFile &&other) noexcept;
+
+    static void write(const std::vector<std::shared_ptr<Tree>> &trees,
+                      const std::string &file_name,
+                      const size_t requested_threads = 0);
+    static void write(const Forest &forest, const std::string &file_name,
+                      const size_t requested_threads = 0);
+
+    std::string get_file_name(void) const;
+    size_t get_number_of_trees(void) const;
+    size_t get_number_of_nodes(void) const;
+
+    int64_t get_root_id(const size_t tree_index) const;
+    size_t get_root_row(const size_t tree_index) const;
+    size_t get_next_root_row(const size_t tree_index) const;
+    size_t get_number_of_nodes(const size_t tree_index) const;
+
+    bool has_tree(const int64_t root_id) const;
+    size_t get_tree_index(const int64_t root_id) const;
+
+    FlatTree get_flat_tree(const size_t tree_index) const;
+    std::shared_ptr<Tree> get_tree(const size_t tree_index,
+                                   const bool use_node_arena = false) const;
+    void load_forest(Forest &forest, const size_t requested_threads = 0,
+                     const bool use_node_arenas = false) const;
+};
+
+/**
+ * Numbers the nodes in depth-first order with the children in order, which
+ * is the order of FlatTree::build_tree.
+ */
+inline void ForestFile::flatten_tree(const Tree &tree, FlatTopology &topology) {
+    using NodeIndex = FlatTree::NodeIndex;
+    tree.check_complete();
+
+    // the most recently added child of every node, to link the siblings
+    std::vector<NodeIndex> last_child;
+    std::vector<std::pair<const Node *, NodeIndex>> to_visit = {
+        std::make_pair(tree.root_node_.get(), FlatTree::null_node)
+    };
+    while (!to_visit.empty()) {
+        const auto [node, parent] = to_visit.back();
+        to_visit.pop_back();
+
+        if (topology.parent.size() >= (size_t)std::numeric_limits<NodeIndex>::max()) {
+            throw std::runtime_error("The tree has too many nodes for a forest file.\n");
+        }
+
+        const NodeIndex index = (NodeIndex)topology.parent.size();
+        topology.parent.push_back(parent);
+        topology.first_child.push_back(FlatTree::null_node);
+        topology.next_sibling.push_back(FlatTree::null_node);
+        topology.data_row_offset.push_back(
+            (uint32_t)(node->get_data_row() - tree.root_node_row_in_data_)
+        );
+        topology.id.push_back(node->halo.get_id());
+        last_child.push_back(FlatTree::null_node);
+
+        if (parent != FlatTree::null_node) {
+            if (last_child[parent] == FlatTree::null_node) {
+                topology.first_child[parent] = index;
+            }
+            else {
+                topology.next_sibling[last_child[parent]] = index;
+            }
+            last_child[parent] = index;
+        }
+
+        for (auto child = node->children_.rbegin(); child != node->children_.rend(); child++) {
+            to_visit.push_back(std::make_pair(child->get(), index));
+        }
+    }
+}
+
+/**
+ * Writes the topology of the trees to a file, replacing any existing file.
+ * The trees are flattened in parallel. A lazily built tree has to be
+ * expanded completely first.
+ */
+inline void ForestFile::write(const std::vector<std::shared_ptr<Tree>> &trees,
+                              const std::string &file_name,
+                              const size_t requested_threads) {
+    const size_t n_trees = trees.size();
+    std::vector<FlatTopology> topologies(n_trees);
+    parallel_for_chunks(0, n_trees,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                flatten_tree(*trees[i], topologies[i]);
+                            }
+                        }, requested_threads);
+
+    std::vector<uint64_t> first_nodes(n_trees + 1, 0);
+    for (size_t i = 0; i < n_trees; i++) {
+        first_nodes[i + 1] = first_nodes[i] + topologies[i].parent.size();
+    }
+    const size_t n_nodes = first_nodes[n_trees];
+
+    // the header is followed by the aligned tables and node arrays
+    size_t total_bytes = sizeof(FileHeader);
+    auto add_array = [&total_bytes](const size_t bytes) {
+        total_bytes = (total_bytes + alignment_ - 1) / alignment_ * alignment_;
+        const uint64_t offset = total_bytes;
+        total_bytes += bytes;
+        return offset;
+    };
+
+    FileHeader file_header;
+    std::memset(&file_header, 0, sizeof(file_header));
+    file_header.version = format_version_;
+    file_header.trees = n_trees;
+    file_header.nodes = n_nodes;
+    file_header.tree_table_offset = add_array(n_trees * sizeof(TreeEntry));
+    file_header.sorted_trees_offset = add_array(n_trees * sizeof(uint64_t));
+    file_header.parent_offset = add_array(n_nodes * sizeof(FlatTree::NodeIndex));
+    file_header.first_child_offset = add_array(n_nodes * sizeof(FlatTree::NodeIndex));
+    file_header.next_sibling_offset = add_array(n_nodes * sizeof(FlatTree::NodeIndex));
+    file_header.data_row_offset_offset = add_array(n_nodes * sizeof(uint32_t));
+    file_header.id_offset = add_array(n_nodes * sizeof(int64_t));
+    file_header.total_bytes = total_bytes;
+
+    unlink(file_name.c_str());
+    int file_descriptor = open(file_name.c_str(), O_CREAT | O_RDWR | O_EXCL, 0644);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("Could not open the forest file " + file_name
+                                 + ": " + std::strerror(errno) + "\n");
+    }
+    // an empty or partial file is never left behind
+    if (ftruncate(file_descriptor, (off_t)total_bytes) != 0) {
+        const std::string error = std::strerror(errno);
+        close(file_descriptor);
+        unlink(file_name.c_str());
+        throw std::runtime_error("Could not resize the forest file " + file_name
+                                 + ": " + error + "\n");
+    }
+
+    void *mapping = mmap(NULL, total_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         file_descriptor, 0);
+    const std::string map_error = (mapping == MAP_FAILED) ? std::strerror(errno) : "";
+    close(file_descriptor);
+    if (mapping == MAP_FAILED) {
+        unlink(file_name.c_str());
+        throw std::runtime_error("Could not map the forest file " + file_name
+                                 + ": " + map_error + "\n");
+    }
+
+    auto bytes = static_cast<char *>(mapping);
+    auto header = reinterpret_cast<FileHeader *>(bytes);
+    *header = file_header;
+
+    auto tree_table = reinterpret_cast<TreeEntry *>(bytes + file_header.tree_table_offset);
+    for (size_t i = 0; i < n_trees; i++) {
+        tree_table[i].root_id = topologies[i].id.empty() ? -1 : topologies[i].id[0];
+        tree_table[i].root_row = trees[i]->root_node_row_in_data_;
+        tree_table[i].next_root_row = trees[i]->next_root_node_row_in_data_;
+        tree_table[i].first_node = first_nodes[i];
+        tree_table[i].nodes = first_nodes[i + 1] - first_nodes[i];
+    }
+
+    auto sorted_trees = reinterpret_cast<uint64_t *>(bytes + file_header.sorted_trees_offset);
+    std::iota(sorted_trees, sorted_trees + n_trees, 0);
+    std::stable_sort(sorted_trees, sorted_trees + n_trees,
+                     [tree_table](const uint64_t a, const uint64_t b) {
+                         return tree_table[a].root_id < tree_table[b].root_id;
+                     });
+
+    auto copy_array = [&](const uint64_t offset, auto member) {
+        using T = typename std::remove_reference_t<decltype(topologies[0].*member)>::value_type;
+        auto values = reinterpret_cast<T *>(bytes + offset);
+        for (size_t i = 0; i < n_trees; i++) {
+            const auto &array = topologies[i].*member;
+            std::copy(array.begin(), array.end(), values + first_nodes[i]);
+        }
+    };
+    copy_array(file_header.parent_offset, &FlatTopology::parent);
+    copy_array(file_header.first_child_offset, &FlatTopology::first_child);
+    copy_array(file_header.next_sibling_offset, &FlatTopology::next_sibling);
+    copy_array(file_header.data_row_offset_offset, &FlatTopology::data_row_offset);
+    copy_array(file_header.id_offset, &FlatTopology::id);
+
+    // the magic string marks the file as complete
+    std::memcpy(header->magic, magic_, sizeof(magic_));
+
+    msync(mapping, total_bytes, MS_SYNC);
+    munmap(mapping, total_bytes);
+}
+
+inline void ForestFile::write(const Forest &forest, const std::string &file_name,
+                              const size_t requested_threads) {
+    write(forest.trees_, file_name, requested_threads);
+}
+
+/**
+ * Maps a forest file read-only. Only the header is read, so this takes the
+ * same time regardless of the size of the forest. The header is checked
+ * against the size of the file, so that every table and node array lies
+ * inside of the mapping.
+ */
+inline ForestFile::ForestFile(const std::string &file_name) {
+    file_name_ = file_name;
+
+    int file_descriptor = open(file_name.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("Could not open the forest file " + file_name
+                                 + ": " + std::strerror(errno) + "\n");
+    }
+
+    struct stat status;
+    if (fstat(file_descriptor, &status) != 0
+        || (size_t)status.st_size < sizeof(FileHeader)) {
+        close(file_descriptor);
+        throw std::runtime_error("The forest file " + file_name + " is incomplete.\n");
+    }
+
+    mapping_bytes_ = (size_t)status.st_size;
+    mapping_ = mmap(NULL, mapping_bytes_, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("Could not map the forest file " + file_name
+                                 + ": " + std::strerror(errno) + "\n");
+    }
+
+    auto bytes = static_cast<const char *>(mapping_);
+    header_ = reinterpret_cast<const FileHeader *>(bytes);
+
+    if (std::memcmp(header_->magic, magic_, sizeof(magic_)) != 0
+        || header_->version != format_version_
+        || header_->total_bytes != mapping_bytes_) {
+        release();
+        throw std::runtime_error("The forest file " + file_name
+                                 + " is incomplete or has the wrong format.\n");
+    }
+
+    if (!section_fits(header_->tree_table_offset, header_->trees, sizeof(TreeEntry))
+        || !section_fits(header_->sorted_trees_offset, header_->trees, sizeof(uint64_t))
+        || !section_fits(header_->parent_offset, header_->nodes, sizeof(FlatTree::NodeIndex))
+        || !section_fits(header_->first_child_offset, header_->nodes, sizeof(FlatTree::NodeIndex))
+        || !section_fits(header_->next_sibling_offset, header_->nodes, sizeof(FlatTree::NodeIndex))
+        || !section_fits(header_->data_row_offset_offset, header_->nodes, sizeof(uint32_t))
+        || !section_fits(header_->id_offset, header_->nodes, sizeof(int64_t))) {
+        release();
+        throw std::runtime_error("The forest file " + file_name
+                                 + " is corrupted, its sections do not fit in the file.\n");
+    }
+
+    tree_table_ = reinterpret_cast<const TreeEntry *>(bytes + header_->tree_table_offset);
+    sorted_trees_ = reinterpret_cast<const uint64_t *>(bytes + header_->sorted_trees_offset);
+}
+
+inline void ForestFile::release(void) {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_bytes_);
+    }
+
+    mapping_ = nullptr;
+    mapping_bytes_ = 0;
+    header_ = nullptr;
+    tree_table_ = nullptr;
+    sorted_trees_ = nullptr;
+}
+
+/**
+ * Whether count elements starting at offset are inside of the mapping, after
+ * the header and aligned like the writer aligns them.
+ */
+inline bool ForestFile::section_fits(const uint64_t offset, const uint64_t count,
+                                     const size_t element_bytes) const {
+    return offset >= sizeof(FileHeader) && offset % alignment_ == 0
+           && offset <= mapping_bytes_ && count <= (mapping_bytes_ - offset) / element_bytes;
+}
+
+/**
+ * The table entry of a tree, whose nodes have to be inside of the node arrays.
+ */
+inline const ForestFile::TreeEntry &ForestFile::get_entry(const size_t tree_index) const {
+    if (tree_index >= header_->trees) {
+        throw std::runtime_error("There is no tree " + std::to_string(tree_index)
+                                 + " in " + file_name_ + "\n");
+    }
+
+    const auto &entry = tree_table_[tree_index];
+    if (entry.first_node > header_->nodes || entry.nodes > header_->nodes - entry.first_node) {
+        throw std::runtime_error("The nodes of tree " + std::to_string(tree_index)
+                                 + " are outside of the node arrays of " + file_name_ + "\n");
+    }
+
+    return entry;
+}
+
+inline ForestFile::~ForestFile() {
+    release();
+}
+
+inline ForestFile::ForestFile(ForestFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+inline ForestFile &ForestFile::operator=(ForestFile &&other) noexcept {
+    if (this != &other) {
+        release();
+        file_name_ = std::move(other.file_name_);
+        mapping_ = other.mapping_;
+        mapping_bytes_ = other.mapping_bytes_;
+        header_ = other.header_;
+        tree_table_ = other.tree_table_;
+        sorted_trees_ = other.sorted_trees_;
+
+        other.mapping_ = nullptr;
+        other.mapping_bytes_ = 0;
+        other.header_ = nullptr;
+        other.tree_table_ = nullptr;
+        other.sorted_trees_ = nullptr;
+    }
+
+    return *this;
+}
+
+// the first element of a node array that belongs to a tree
+template <typename T>
+const T *ForestFile::get_array(const uint64_t offset, const size_t tree_index) const {
+    return reinterpret_cast<const T *>(static_cast<const char *>(mapping_) + offset)
+           + get_entry(tree_index).first_node;
+}
+
+inline std::string ForestFile::get_file_name(void) const {
+    return file_name_;
+}
+
+inline size_t ForestFile::get_number_of_trees(void) const {
+    return header_->trees;
+}
+
+inline size_t ForestFile::get_number_of_nodes(void) const {
+    return header_->nodes;
+}
+
+inline int64_t ForestFile::get_root_id(const size_t tree_index) const {
+    return get_entry(tree_index).root_id;
+}
+
+inline size_t ForestFile::get_root_row(const size_t tree_index) const {
+    return get_entry(tree_index).root_row;
+}
+
+inline size_t ForestFile::get_next_root_row(const size_t tree_index) const {
+    return get_entry(tree_index).next_root_row;
+}
+
+inline size_t ForestFile::get_number_of_nodes(const size_t tree_index) const {
+    return get_entry(tree_index).nodes;
+}
+
+/**
+ * Binary search for the tree with the given root id (TreeRootID in the
+ * consistent-trees files), returns the number of trees if there is none.
+ */
+inline size_t ForestFile::find_tree(const int64_t root_id) const {
+    const uint64_t *sorted_end = sorted_trees_ + header_->trees;
+    auto tree = std::lower_bound(sorted_trees_, sorted_end, root_id,
+                                 [this](const uint64_t index, const int64_t id) {
+                                     return get_entry(index).root_id < id;
+                                 });
+
+    if (tree == sorted_end || get_entry(*tree).root_id != root_id) {
+        return header_->trees;
+    }
+
+    return *tree;
+}
+
+inline bool ForestFile::has_tree(const int64_t root_id) const {
+    return find_tree(root_id) != header_->trees;
+}
+
+inline size_t ForestFile::get_tree_index(const int64_t root_id) const {
+    const size_t tree_index = find_tree(root_id);
+    if (tree_index == header_->trees) {
+        throw std::runtime_error("There is no tree with root id " + std::to_string(root_id)
+                                 + " in " + file_name_ + "\n");
+    }
+
+    return tree_index;
+}
+
+/**
+ * Checks the stored node arrays of a tree before anything follows them, so
+ * that a corrupted file can not index outside of the tree. Every parent has
+ * to come before its children in depth-first order, and every data row has to
+ * be inside of the rows of the tree. With check_links, the first child and
+ * the next sibling have to point forward to a node with the right parent, so
+ * that the FlatTree loops over the children always end.
+ */
+inline void ForestFile::check_topology(const size_t tree_index, const bool check_links) const {
+    using NodeIndex = FlatTree::NodeIndex;
+    const auto &entry = get_entry(tree_index);
+    const auto parent = get_array<NodeIndex>(header_->parent_offset, tree_index);
+    const auto first_child = get_array<NodeIndex>(header_->first_child_offset, tree_index);
+    const auto next_sibling = get_array<NodeIndex>(header_->next_sibling_offset, tree_index);
+    const auto data_row_offset = get_array<uint32_t>(header_->data_row_offset_offset, tree_index);
+    const uint64_t total_rows = (entry.next_root_row > entry.root_row) 
+                                ? entry.next_root_row - entry.root_row : 0;
+    const int64_t total_nodes = (int64_t)entry.nodes;
+
+    for (int64_t i = 0; i < total_nodes; i++) {
+        const bool parent_valid = (i == 0) ? parent[i] == FlatTree::null_node
+                                           : parent[i] >= 0 && parent[i] < i;
+        bool links_valid = true;
+        if (check_links) {
+            const auto child = first_child[i];
+            const auto sibling = next_sibling[i];
+            links_valid = (child == FlatTree::null_node
+                           || (child > i && child < total_nodes && parent[child] == i))
+                          && (sibling == FlatTree::null_node
+                              || (i > 0 && sibling > i && sibling < total_nodes 
+                                  && parent[sibling] == parent[i]));
+        }
+
+        if (!parent_valid || !links_valid || data_row_offset[i] >= total_rows) {
+            throw std::runtime_error("The forest file " + file_name_ + " is corrupted, node "
+                                     + std::to_string(i) + " of tree " 
+                                     + std::to_string(tree_index) 
+                                     + " has an invalid parent, child or data row.\n");
+        }
+    }
+}
+
+/**
+ * Copies the topology of a tree into a FlatTree, which owns its arrays and
+ * stays valid after the file is closed.
+ */
+inline FlatTree ForestFile::get_flat_tree(const size_t tree_index) const {
+    const auto &entry = get_entry(tree_index);
+    check_topology(tree_index, true);
+
+    FlatTree flat_tree(entry.root_row, entry.next_root_row);
+    flat_tree.load_topology(get_array<FlatTree::NodeIndex>(header_->parent_offset, tree_index),
+                            get_array<FlatTree::NodeIndex>(header_->first_child_offset, tree_index),
+                            get_array<FlatTree::NodeIndex>(header_->next_sibling_offset, tree_index),
+                            get_array<uint32_t>(header_->data_row_offset_offset, tree_index),
+                            entry.nodes);
+
+    return flat_tree;
+}
+
+/**
+ * Creates the nodes of a Tree straight from the stored topology, the children
+ * of every node are in the same order as when the tree was written.
+ */
+inline std::shared_ptr<Tree> ForestFile::get_tree(const size_t tree_index,
+                                                  const bool use_node_arena) const {
+    const auto &entry = get_entry(tree_index);
+    auto tree = std::make_shared<Tree>(nullptr, entry.root_row, entry.next_root_row);
+    if (use_node_arena) {
+        tree->use_node_arena();
+    }
+    if (entry.nodes == 0) {
+        return tree;
+    }
+    check_topology(tree_index, false);
+
+    const auto parent = get_array<FlatTree::NodeIndex>(header_->parent_offset, tree_index);
+    const auto data_row_offset = get_array<uint32_t>(header_->data_row_offset_offset, tree_index);
+    const auto id = get_array<int64_t>(header_->id_offset, tree_index);
+
+    // in depth-first order every parent comes before its children
+    std::vector<Node *> nodes(entry.nodes);
+    tree->root_node_ = tree->make_node(entry.root_row + data_row_offset[0], nullptr, id[0]);
+    nodes[0] = tree->root_node_.get();
+    for (size_t i = 1; i < entry.nodes; i++) {
+        auto node = tree->make_node(entry.root_row + data_row_offset[i], nullptr, id[i]);
+        nodes[i] = node.get();
+        nodes[parent[i]]->add_child(std::move(node));
+    }
+
+    return tree;
+}
+
+/**
+ * Recreates every tree of the file in a Forest, in parallel and in the order
+ * in which they were written.
+ */
+inline void ForestFile::load_forest(Forest &forest, const size_t requested_threads,
+                                    const bool use_node_arenas) const {
+    const size_t n_trees = get_number_of_trees();
+    forest.trees_.assign(n_trees, nullptr);
+
+    parallel_for_chunks(0, n_trees,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                forest.trees_[i] = get_tree(i, use_node_arenas);
+                            }
+                        }, requested_threads);
+}
+
+#endif
@@ -0,0 +1,203 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FORMATIONTIME_HPP
+#define FORMATIONTIME_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include "Tree.hpp"
+#include "FlatTree.hpp"
+#include "Forest.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+// how the formation scale is placed between the last progenitor above the
+// mass threshold and the first one below it
+enum class FormationInterpolation {
+    first_below,    // the scale of the first progenitor below the threshold
+    midpoint,       // the average of the two scales
+    linear,         // linear in mass between the two progenitors
+    log_linear      // linear in log(mass) between the two progenitors
+};
+
+/**
+ * Computes formation (assembly) scales: the scale factor at which the mass of
+ * the main branch first drops below ratio * (mass of the root), for any
+ * number of ratios. If the branch never drops below a ratio, the scale is
+ * missing_scale. The results of many trees are stored tree-major, i.e. the
+ * scale of ratio r of tree t is at t * get_number_of_ratios() + r.
+ *
+ * Either an existing forest can be used, or the trees of a DataContainer are
+ * built one at a time by every thread and thrown away again, so that the
+ * forest never has to be in memory. The container can be any set of complete
+ * trees, e.g. one chunk of rows of a large file at a time.
+ */
+class FormationTime {
+private:
+    std::vector<double> ratios_;
+    FormationInterpolation interpolation_;
+    double missing_scale_;
+    std::string mass_column_ = "virial_mass";
+    std::string scale_column_ = "scale";
+
+public:
+    FormationTime(const std::vector<double> &ratios,
+                  const FormationInterpolation interpolation = FormationInterpolation::midpoint,
+                  const double missing_scale = -1.) {
+        ratios_ = ratios;
+        interpolation_ = interpolation;
+        missing_scale_ = missing_scale;
+    }
+
+    size_t get_number_of_ratios(void) const { return ratios_.size(); }
+    const std::vector<double> &get_ratios(void) const { return ratios_; }
+    void set_mass_column(const std::string &mass_column) { mass_column_ = mass_column; }
+    void set_scale_column(const std::string &scale_column) { scale_column_ = scale_column; }
+
+    void compute_branch(const double *masses, const double *scales, const size_t length,
+                        double *formation_scales) const;
+
+    template <typename DataFileFormat>
+    std::vector<double> compute(const DataContainer<DataFileFormat> &data,
+                                const std::vector<std::shared_ptr<Tree>> &trees,
+                                const std::vector<size_t> &tree_indices,
+                                const size_t requested_threads = 0) const;
+
+    template <typename DataFileFormat>
+    std::vector<double> compute(const DataContainer<DataFileFormat> &data,
+                                const size_t requested_threads = 0) const;
+};
+
+/**
+ * The main branch is given from the root (index 0) to the earliest progenitor.
+ * Writes get_number_of_ratios() scales into formation_scales.
+ */
+inline void FormationTime::compute_branch(const double *masses, const double *scales,
+                                          const size_t length,
+                                          double *formation_scales) const {
+    for (size_t r = 0; r < ratios_.size(); r++) {
+        formation_scales[r] = missing_scale_;
+        if (length == 0) {
+            continue;
+        }
+
+        const double threshold = ratios_[r] * masses[0];
+        for (size_t i = 0; i < length; i++) {
+            if (masses[i] >= threshold) {
+                continue;
+            }
+
+            if (i == 0 || interpolation_ == FormationInterpolation::first_below) {
+                formation_scales[r] = scales[i];
+            }
+            else if (interpolation_ == FormationInterpolation::midpoint) {
+                formation_scales[r] = 0.5 * (scales[i - 1] + scales[i]);
+            }
+            else {
+                double upper = masses[i - 1];
+                double lower = masses[i];
+                double target = threshold;
+                // the logarithm needs positive masses, otherwise stay linear
+                if (interpolation_ == FormationInterpolation::log_linear 
+                    && lower > 0. && target > 0.) {
+                    upper = std::log(upper);
+                    lower = std::log(lower);
+                    target = std::log(target);
+                }
+
+                const double weight = (upper - target) / (upper - lower);
+                formation_scales[r] = scales[i - 1] + weight * (scales[i] - scales[i - 1]);
+            }
+
+            break;
+        }
+    }
+}
+
+/**
+ * Formation scales of trees[tree_indices[t]] for every t, in parallel.
+ */
+template <typename DataFileFormat>
+std::vector<double> FormationTime::compute(const DataContainer<DataFileFormat> &data,
+                                           const std::vector<std::shared_ptr<Tree>> &trees,
+                                           const std::vector<size_t> &tree_indices,
+                                           const size_t requested_threads) const {
+    const std::vector<size_t> keys = {
+        data.get_internal_key(mass_column_), data.get_internal_key(scale_column_)
+    };
+
+    std::vector<double> formation_scales(tree_indices.size() * ratios_.size());
+    parallel_for_chunks(0, tree_indices.size(), 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::vector<double> values;
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                const auto &tree = trees.at(tree_indices[t]);
+                                const auto length = tree->extract_main_branch(data, tree->root_node_, 
+                                                                              keys, values);
+                                compute_branch(values.data(), values.data() + length, length,
+                                               formation_scales.data() + t * ratios_.size());
+                            }
+                        }, requested_threads);
+
+    return formation_scales;
+}
+
+/**
+ * Formation scales of all of the trees in the data, in root row order. Every
+ * thread builds one FlatTree at a time and only keeps its main branch.
+ */
+template <typename DataFileFormat>
+std::vector<double> FormationTime::compute(const DataContainer<DataFileFormat> &data,
+                                           const size_t requested_threads) const {
+    const auto mass_key = data.get_internal_key(mass_column_);
+    const auto scale_key = data.get_internal_key(scale_column_);
+
+    auto root_rows = Forest::find_root_rows(data);
+    root_rows.push_back(data.get_number_of_rows());
+    const size_t total_trees = root_rows.size() - 1;
+
+    std::vector<double> formation_scales(total_trees * ratios_.size());
+    parallel_for_chunks(0, total_trees, 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::vector<double> masses, scales;
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                FlatTree tree(root_rows[t], root_rows[t + 1]);
+                                tree.build_tree(data);
+
+                                masses.clear();
+                                scales.clear();
+                                for (auto node = tree.get_root_node(); node != FlatTree::null_node;
+                                     node = tree.get_first_child(node)) {
+                                    const auto row = tree.get_data_row(node);
+                                    masses.push_back(data.get_data_as_double(row, mass_key));
+                                    scales.push_back(data.get_data_as_double(row, scale_key));
+                                }
+
+                                compute_branch(masses.data(), scales.data(), masses.size(),
+                                               formation_scales.data() + t * ratios_.size());
+                            }
+                        }, requested_threads);
+
+    return formation_scales;
+}
+
+#endif
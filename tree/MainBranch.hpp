@@ -0,0 +1,115 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MAINBRANCH_HPP
+#define MAINBRANCH_HPP
+
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "Tree.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * The values of several columns along the main branches of many trees, as a
+ * ragged (compressed sparse row) array. Branch b is the range
+ * [offsets_[b], offsets_[b + 1]) of every column. The columns are stored one
+ * after the other in values_, each holding all of the branches back to back,
+ * so that every column (and the offsets) can be written out directly, e.g. as
+ * a one-dimensional HDF5 dataset.
+ */
+struct MainBranchBatch {
+    std::vector<size_t> keys_;
+    std::vector<size_t> offsets_;
+    std::vector<double> values_;
+
+    size_t get_number_of_branches(void) const {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+    // the total number of values in every column
+    size_t get_number_of_values(void) const {
+        return offsets_.empty() ? 0 : offsets_.back();
+    }
+
+    size_t get_branch_length(const size_t branch) const {
+        return offsets_[branch + 1] - offsets_[branch];
+    }
+
+    // pointer to all of the values of the c-th column
+    const double *get_column(const size_t column) const {
+        return values_.data() + column * get_number_of_values();
+    }
+
+    // pointer to the first value of the branch in the c-th column
+    const double *get_branch(const size_t column, const size_t branch) const {
+        return get_column(column) + offsets_[branch];
+    }
+};
+
+/**
+ * Extracts the main branches (from the root nodes) of trees[tree_indices[b]]
+ * for every b into a MainBranchBatch. The branch lengths are counted first so
+ * that the output is allocated once, and then the branches are filled in
+ * parallel, each into its own slice of the columns.
+ */
+template <typename DataFileFormat>
+MainBranchBatch extract_main_branches(const DataContainer<DataFileFormat> &data,
+                                      const std::vector<std::shared_ptr<Tree>> &trees,
+                                      const std::vector<size_t> &tree_indices,
+                                      const std::vector<size_t> &keys,
+                                      const size_t requested_threads = 0) {
+    MainBranchBatch batch;
+    batch.keys_ = keys;
+
+    const size_t total_branches = tree_indices.size();
+    for (const auto &tree_index : tree_indices) {
+        if (tree_index >= trees.size() || trees[tree_index] == nullptr) {
+            throw std::runtime_error("There is no tree at index " 
+                                     + std::to_string(tree_index) + "\n");
+        }
+    }
+
+    batch.offsets_.assign(total_branches + 1, 0);
+    parallel_for(0, total_branches, [&](const size_t b) {
+        const auto &tree = trees[tree_indices[b]];
+        tree->expand_main_branch(data, tree->root_node_);
+        batch.offsets_[b + 1] = tree->get_main_branch_length(tree->root_node_);
+    }, requested_threads);
+
+    for (size_t b = 0; b < total_branches; b++) {
+        batch.offsets_[b + 1] += batch.offsets_[b];
+    }
+
+    // every branch writes its own slice of every column, with the columns
+    // total_values apart
+    const size_t total_values = batch.offsets_[total_branches];
+    batch.values_.resize(keys.size() * total_values);
+    parallel_for(0, total_branches, [&](const size_t b) {
+        const auto &tree = trees[tree_indices[b]];
+        tree->extract_main_branch(data, tree->root_node_, keys,
+                                  batch.values_.data() + batch.offsets_[b], total_values);
+    }, requested_threads);
+
+    return batch;
+}
+
+#endif
@@ -0,0 +1,444 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MERGERS_HPP
+#define MERGERS_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include "Tree.hpp"
+#include "Forest.hpp"
+#include "DescendantIndex.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * A merger of a secondary progenitor into the descendant. The main progenitor
+ * is the most massive progenitor of the descendant, the mass ratio is the
+ * mass of the secondary over the mass of the main progenitor, and the scale
+ * is the scale factor of the descendant.
+ */
+struct MergerEvent {
+    size_t descendant_row;
+    size_t main_progenitor_row;
+    size_t secondary_progenitor_row;
+    double mass_ratio;
+    double scale;
+};
+
+/**
+ * Finds all of the merger events in a forest, i.e. one event for every
+ * progenitor of a halo other than its most massive one, with a mass ratio of
+ * at least minimum_mass_ratio. When the is_most_massive_progenitor column is
+ * loaded, the flagged progenitor is the main one, otherwise (or when none of
+ * the progenitors is flagged) it is the one with the largest mass. The trees
+ * are processed in parallel, every chunk of trees fills its own buffer, and
+ * the buffers are joined in the order of the trees, so the events are always
+ * sorted by tree and then by descendant row.
+ */
+class MergerFinder {
+private:
+    double minimum_mass_ratio_;
+    std::string mass_column_ = "virial_mass";
+    std::string scale_column_ = "scale";
+    std::string flag_column_ = "is_most_massive_progenitor";
+
+    template <typename DataFileFormat>
+    size_t get_flag_key(const DataContainer<DataFileFormat> &data) const;
+
+    // one event per secondary progenitor in progenitor_rows
+    template <typename DataFileFormat>
+    void add_events(const DataContainer<DataFileFormat> &data,
+                    const size_t mass_key, const size_t scale_key,
+                    const size_t flag_key, const size_t descendant_row,
+                    const std::vector<size_t> &progenitor_rows,
+                    std::vector<MergerEvent> &events) const;
+
+    template <typename Function>
+    std::vector<MergerEvent> find_in_trees(const size_t total_trees, Function find_in_tree,
+                                           const size_t requested_threads) const;
+
+public:
+    MergerFinder(const double minimum_mass_ratio = 0.) {
+        minimum_mass_ratio_ = minimum_mass_ratio;
+    }
+
+    void set_mass_column(const std::string &mass_column) { mass_column_ = mass_column; }
+    void set_scale_column(const std::string &scale_column) { scale_column_ = scale_column; }
+    const std::string &get_mass_column(void) const { return mass_column_; }
+    const std::string &get_scale_column(void) const { return scale_column_; }
+
+    template <typename DataFileFormat>
+    std::vector<MergerEvent> find_mergers(const DataContainer<DataFileFormat> &data,
+                                          const size_t requested_threads = 0) const;
+
+    template <typename DataFileFormat>
+    std::vector<MergerEvent> find_mergers(const DataContainer<DataFileFormat> &data,
+                                          const std::vector<std::shared_ptr<Tree>> &trees,
+                                          const size_t requested_threads = 0) const;
+};
+
+template <typename DataFileFormat>
+size_t MergerFinder::get_flag_key(const DataContainer<DataFileFormat> &data) const {
+    const auto column_names = data.get_column_names();
+    if (std::find(column_names.begin(), column_names.end(), flag_column_) == column_names.end()) {
+        return no_progenitor_flag_key;
+    }
+
+    return data.get_internal_key(flag_column_);
+}
+
+template <typename DataFileFormat>
+void MergerFinder::add_events(const DataContainer<DataFileFormat> &data,
+                              const size_t mass_key, const size_t scale_key,
+                              const size_t flag_key, const size_t descendant_row,
+                              const std::vector<size_t> &progenitor_rows,
+                              std::vector<MergerEvent> &events) const {
+    if (progenitor_rows.size() < 2) {
+        return;
+    }
+
+    const size_t main_row = find_main_progenitor(data, progenitor_rows.data(),
+                                                 progenitor_rows.data() + progenitor_rows.size(),
+                                                 mass_key, flag_key);
+    const double main_mass = data.get_data_as_double(main_row, mass_key);
+
+    const double scale = data.get_data_as_double(descendant_row, scale_key);
+    for (const auto &progenitor_row : progenitor_rows) {
+        if (progenitor_row == main_row) {
+            continue;
+        }
+
+        const double mass_ratio = (main_mass > 0.) 
+                                  ? data.get_data_as_double(progenitor_row, mass_key) / main_mass
+                                  : 0.;
+        if (mass_ratio >= minimum_mass_ratio_) {
+            events.push_back(MergerEvent{descendant_row, main_row, progenitor_row, 
+                                         mass_ratio, scale});
+        }
+    }
+}
+
+template <typename Function>
+std::vector<MergerEvent> MergerFinder::find_in_trees(const size_t total_trees, 
+                                                     Function find_in_tree,
+                                                     const size_t requested_threads) const {
+    // fixed chunks, so that the buffers can be joined in tree order
+    const size_t n_threads = get_number_of_threads(requested_threads);
+    const size_t chunk_size = std::max((size_t)1, total_trees / (8 * n_threads));
+    const size_t total_chunks = (total_trees + chunk_size - 1) / chunk_size;
+
+    std::vector<std::vector<MergerEvent>> chunk_events(total_chunks);
+    parallel_for_chunks(0, total_trees,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            auto &events = chunk_events[chunk_begin / chunk_size];
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                find_in_tree(t, events);
+                            }
+                        }, requested_threads, chunk_size);
+
+    size_t total_events = 0;
+    for (const auto &events : chunk_events) {
+        total_events += events.size();
+    }
+
+    std::vector<MergerEvent> all_events;
+    all_events.reserve(total_events);
+    for (const auto &events : chunk_events) {
+        all_events.insert(all_events.end(), events.begin(), events.end());
+    }
+
+    return all_events;
+}
+
+/**
+ * Finds the mergers directly from the rows of the data, without building any
+ * Tree objects.
+ */
+template <typename DataFileFormat>
+std::vector<MergerEvent> MergerFinder::find_mergers(const DataContainer<DataFileFormat> &data,
+                                                    const size_t requested_threads) const {
+    const auto mass_key = data.get_internal_key(mass_column_);
+    const auto scale_key = data.get_internal_key(scale_column_);
+    const auto flag_key = get_flag_key(data);
+
+    auto root_rows = Forest::find_root_rows(data);
+    root_rows.push_back(data.get_number_of_rows());
+
+    return find_in_trees(root_rows.size() - 1, 
+                         [&](const size_t t, std::vector<MergerEvent> &events) {
+                             DescendantIndex descendant_index;
+                             descendant_index.build(data, root_rows[t], root_rows[t + 1]);
+
+                             std::vector<size_t> progenitor_rows;
+                             for (size_t row = root_rows[t]; row < root_rows[t + 1]; row++) {
+                                 progenitor_rows.assign(descendant_index.progenitors_begin(row),
+                                                        descendant_index.progenitors_end(row));
+                                 add_events(data, mass_key, scale_key, flag_key, row, 
+                                            progenitor_rows, events);
+                             }
+                         }, requested_threads);
+}
+
+/**
+ * Finds the mergers in already built trees, in the order of the nodes within
+ * every tree sorted by data row.
+ */
+template <typename DataFileFormat>
+std::vector<MergerEvent> MergerFinder::find_mergers(const DataContainer<DataFileFormat> &data,
+                                                    const std::vector<std::shared_ptr<Tree>> &trees,
+                                                    const size_t requested_threads) const {
+    const auto mass_key = data.get_internal_key(mass_column_);
+    const auto scale_key = data.get_internal_key(scale_column_);
+    const auto flag_key = get_flag_key(data);
+
+    return find_in_trees(trees.size(), 
+                         [&](const size_t t, std::vector<MergerEvent> &events) {
+                             const size_t first_event = events.size();
+                             std::vector<size_t> progenitor_rows;
+                             std::vector<Node *> to_visit = {trees[t]->root_node_.get()};
+                             while (!to_visit.empty()) {
+                                 Node *node = to_visit.back();
+                                 to_visit.pop_back();
+                                 trees[t]->expand_node(data, node);
+
+                                 progenitor_rows.clear();
+                                 for (const auto &child : node->children_) {
+                                     progenitor_rows.push_back(child->get_data_row());
+                                     to_visit.push_back(child.get());
+                                 }
+                                 add_events(data, mass_key, scale_key, flag_key, 
+                                            node->get_data_row(),
+                                            progenitor_rows, events);
+                             }
+
+                             // the events of every descendant are already in data order
+                             std::stable_sort(events.begin() + first_event, events.end(),
+                                              [](const MergerEvent &a, const MergerEvent &b) {
+                                                  return a.descendant_row < b.descendant_row;
+                                              });
+                         }, requested_threads);
+}
+
+/**
+ * Merger counts binned in descendant mass, mass ratio and redshift, together
+ * with the number of halos in every (mass, redshift) bin so that the rates
+ * per halo, per unit mass ratio and per unit redshift can be computed. The
+ * bins are given by their edges, values outside of the edges are ignored.
+ *
+ * Every halo is counted once at every snapshot, so a redshift bin usually
+ * contains several snapshots. Each merger is therefore weighted by 1 / dz of
+ * its own step, from the main progenitor to the descendant, rather than
+ * dividing by the width of the redshift bin.
+ */
+class MergerRateHistogram {
+private:
+    std::vector<double> mass_edges_;
+    std::vector<double> ratio_edges_;
+    std::vector<double> redshift_edges_;
+
+    // [mass][ratio][redshift] and [mass][redshift]
+    std::vector<size_t> merger_counts_;
+    std::vector<size_t> halo_counts_;
+    // [mass][ratio][redshift], the sum of 1 / dz of the mergers
+    std::vector<double> merger_weights_;
+
+    // the bin of value, or -1 if it is outside of the edges
+    static int64_t find_bin(const std::vector<double> &edges, const double value);
+
+    size_t get_number_of_mass_bins(void) const { return mass_edges_.size() - 1; }
+    size_t get_number_of_ratio_bins(void) const { return ratio_edges_.size() - 1; }
+    size_t get_number_of_redshift_bins(void) const { return redshift_edges_.size() - 1; }
+
+public:
+    MergerRateHistogram(const std::vector<double> &mass_edges,
+                        const std::vector<double> &ratio_edges,
+                        const std::vector<double> &redshift_edges);
+
+    template <typename DataFileFormat>
+    void add_mergers(const DataContainer<DataFileFormat> &data,
+                     const std::vector<MergerEvent> &events,
+                     const std::string &mass_column = "virial_mass",
+                     const std::string &scale_column = "scale",
+                     const size_t requested_threads = 0);
+
+    template <typename DataFileFormat>
+    void add_halos(const DataContainer<DataFileFormat> &data,
+                   const std::string &mass_column = "virial_mass",
+                   const std::string &scale_column = "scale",
+                   const size_t requested_threads = 0);
+
+    size_t get_merger_count(const size_t mass_bin, const size_t ratio_bin,
+                            const size_t redshift_bin) const;
+    size_t get_halo_count(const size_t mass_bin, const size_t redshift_bin) const;
+    double get_merger_rate(const size_t mass_bin, const size_t ratio_bin,
+                           const size_t redshift_bin) const;
+};
+
+inline MergerRateHistogram::MergerRateHistogram(const std::vector<double> &mass_edges,
+                                                const std::vector<double> &ratio_edges,
+                                                const std::vector<double> &redshift_edges) {
+    for (const auto &edges : {mass_edges, ratio_edges, redshift_edges}) {
+        if (edges.size() < 2 || !std::is_sorted(edges.begin(), edges.end())) {
+            throw std::runtime_error("The bin edges must be sorted and define at least one bin.\n");
+        }
+    }
+
+    mass_edges_ = mass_edges;
+    ratio_edges_ = ratio_edges;
+    redshift_edges_ = redshift_edges;
+
+    merger_counts_.assign(get_number_of_mass_bins() * get_number_of_ratio_bins()
+                          * get_number_of_redshift_bins(), 0);
+    merger_weights_.assign(merger_counts_.size(), 0.);
+    halo_counts_.assign(get_number_of_mass_bins() * get_number_of_redshift_bins(), 0);
+}
+
+inline int64_t MergerRateHistogram::find_bin(const std::vector<double> &edges, const double value) {
+    if (!(value >= edges.front() && value < edges.back())) {
+        return -1;
+    }
+
+    return (int64_t)(std::upper_bound(edges.begin(), edges.end(), value) - edges.begin()) - 1;
+}
+
+/**
+ * Bins the events by the mass of their descendant, their mass ratio and the
+ * redshift of the descendant. Events without a redshift step between the main
+ * progenitor and the descendant are counted, but do not add to the rate.
+ */
+template <typename DataFileFormat>
+void MergerRateHistogram::add_mergers(const DataContainer<DataFileFormat> &data,
+                                      const std::vector<MergerEvent> &events,
+                                      const std::string &mass_column,
+                                      const std::string &scale_column,
+                                      const size_t requested_threads) {
+    const auto mass_key = data.get_internal_key(mass_column);
+    const auto scale_key = data.get_internal_key(scale_column);
+
+    // every chunk is counted separately and then added to the totals
+    std::mutex add_mutex;
+    parallel_for_chunks(0, events.size(),
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::vector<size_t> counts(merger_counts_.size(), 0);
+                            std::vector<double> weights(merger_weights_.size(), 0.);
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                const auto &event = events[i];
+                                const auto mass_bin = find_bin(mass_edges_, 
+                                    data.get_data_as_double(event.descendant_row, mass_key));
+                                const auto ratio_bin = find_bin(ratio_edges_, event.mass_ratio);
+                                const auto redshift_bin = find_bin(redshift_edges_, 
+                                                                   1. / event.scale - 1.);
+                                if (mass_bin < 0 || ratio_bin < 0 || redshift_bin < 0) {
+                                    continue;
+                                }
+
+                                const size_t bin = (mass_bin * get_number_of_ratio_bins() + ratio_bin)
+                                                   * get_number_of_redshift_bins() + redshift_bin;
+                                counts[bin]++;
+
+                                const double step = 1. / data.get_data_as_double(
+                                    event.main_progenitor_row, scale_key) - 1. / event.scale;
+                                if (step > 0.) {
+                                    weights[bin] += 1. / step;
+                                }
+                            }
+
+                            std::lock_guard<std::mutex> lock(add_mutex);
+                            for (size_t j = 0; j < counts.size(); j++) {
+                                merger_counts_[j] += counts[j];
+                                merger_weights_[j] += weights[j];
+                            }
+                        }, requested_threads);
+}
+
+/**
+ * Bins every halo in the data by its mass and redshift, these are the
+ * halos that the merger rates are normalized by. A halo that exists at
+ * several snapshots of a redshift bin is counted once per snapshot.
+ */
+template <typename DataFileFormat>
+void MergerRateHistogram::add_halos(const DataContainer<DataFileFormat> &data,
+                                    const std::string &mass_column,
+                                    const std::string &scale_column,
+                                    const size_t requested_threads) {
+    const auto mass_key = data.get_internal_key(mass_column);
+    const auto scale_key = data.get_internal_key(scale_column);
+
+    std::mutex add_mutex;
+    parallel_for_chunks(0, data.get_number_of_rows(),
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::vector<size_t> counts(halo_counts_.size(), 0);
+                            for (size_t row = chunk_begin; row < chunk_end; row++) {
+                                const auto mass_bin = find_bin(mass_edges_, 
+                                    data.get_data_as_double(row, mass_key));
+                                const auto redshift_bin = find_bin(redshift_edges_, 
+                                    1. / data.get_data_as_double(row, scale_key) - 1.);
+                                if (mass_bin < 0 || redshift_bin < 0) {
+                                    continue;
+                                }
+
+                                counts[mass_bin * get_number_of_redshift_bins() + redshift_bin]++;
+                            }
+
+                            std::lock_guard<std::mutex> lock(add_mutex);
+                            for (size_t j = 0; j < counts.size(); j++) {
+                                halo_counts_[j] += counts[j];
+                            }
+                        }, requested_threads);
+}
+
+inline size_t MergerRateHistogram::get_merger_count(const size_t mass_bin, 
+                                                    const size_t ratio_bin,
+                                                    const size_t redshift_bin) const {
+    return merger_counts_.at((mass_bin * get_number_of_ratio_bins() + ratio_bin)
+                             * get_number_of_redshift_bins() + redshift_bin);
+}
+
+inline size_t MergerRateHistogram::get_halo_count(const size_t mass_bin, 
+                                                  const size_t redshift_bin) const {
+    return halo_counts_.at(mass_bin * get_number_of_redshift_bins() + redshift_bin);
+}
+
+/**
+ * Mergers per halo, per unit mass ratio and per unit redshift, or zero if
+ * there are no halos in the (mass, redshift) bin. This is the average over
+ * the snapshots in the redshift bin of the mergers per halo and per dz of
+ * each step, weighted by the number of halos at every snapshot.
+ */
+inline double MergerRateHistogram::get_merger_rate(const size_t mass_bin, 
+                                                   const size_t ratio_bin,
+                                                   const size_t redshift_bin) const {
+    const auto halo_count = get_halo_count(mass_bin, redshift_bin);
+    if (halo_count == 0) {
+        return 0.;
+    }
+
+    const double ratio_width = ratio_edges_[ratio_bin + 1] - ratio_edges_[ratio_bin];
+    const double merger_weight = merger_weights_.at((mass_bin * get_number_of_ratio_bins() + ratio_bin)
+                                                    * get_number_of_redshift_bins() + redshift_bin);
+
+    return merger_weight / ((double)halo_count * ratio_width);
+}
+
+#endif
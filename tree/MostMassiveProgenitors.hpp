@@ -0,0 +1,226 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOSTMASSIVEPROGENITORS_HPP
+#define MOSTMASSIVEPROGENITORS_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "Tree.hpp"
+#include "Forest.hpp"
+#include "DescendantIndex.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+// how the most massive progenitor of a halo is chosen: from the
+// is_most_massive_progenitor flag of consistent-trees, or from the largest mass
+enum class MostMassiveProgenitorSource {
+    flag,
+    mass
+};
+
+/**
+ * The row of the most massive progenitor (MMP) of every row of a
+ * consistent-trees data set, in one flat array. Tree and FlatTree assume that
+ * the first progenitor in the data is the most massive one, which only holds
+ * for files that are ordered by mass. This index chooses it explicitly, from
+ * the is_most_massive_progenitor flag or from the largest mass (the first one
+ * in data order on ties), so main branch walks are correct for any order and
+ * only chase row indices.
+ *
+ * With the flag, rows where none of the progenitors is flagged fall back to
+ * the mass. The index is built in parallel over the trees.
+ */
+class MostMassiveProgenitorIndex {
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+private:
+    MostMassiveProgenitorSource source_;
+    std::string mass_column_;
+    std::string flag_column_ = "is_most_massive_progenitor";
+
+    // the row of the most massive progenitor of every row, npos for leaves
+    std::vector<size_t> most_massive_progenitor_rows_;
+
+public:
+    MostMassiveProgenitorIndex(const MostMassiveProgenitorSource source 
+                                   = MostMassiveProgenitorSource::mass,
+                               const std::string &mass_column = "virial_mass") {
+        source_ = source;
+        mass_column_ = mass_column;
+    }
+
+    template <typename DataFileFormat>
+    void build(const DataContainer<DataFileFormat> &data, const size_t requested_threads = 0);
+
+    size_t get_number_of_rows(void) const { return most_massive_progenitor_rows_.size(); }
+    size_t get_most_massive_progenitor(const size_t row) const {
+        return most_massive_progenitor_rows_[row];
+    }
+    const std::vector<size_t> &get_most_massive_progenitor_rows(void) const {
+        return most_massive_progenitor_rows_;
+    }
+
+    size_t get_main_branch_length(const size_t row) const;
+    void get_main_branch_rows(const size_t row, std::vector<size_t> &rows) const;
+
+    template <typename T, typename DataFileFormat>
+    void traverse_most_massive_branch(const DataContainer<DataFileFormat> &data,
+                                      const size_t row, const size_t key,
+                                      std::vector<T> &value_list) const;
+
+    void order_children(Tree &tree) const;
+    void order_children(Forest &forest, const size_t requested_threads = 0) const;
+};
+
+template <typename DataFileFormat>
+void MostMassiveProgenitorIndex::build(const DataContainer<DataFileFormat> &data,
+                                       const size_t requested_threads) {
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    const size_t total_rows = data.get_number_of_rows();
+    const auto mass_key = data.get_internal_key(mass_column_);
+    const auto flag_key = (source_ == MostMassiveProgenitorSource::flag) 
+                          ? data.get_internal_key(flag_column_) : no_progenitor_flag_key;
+
+    auto root_rows = Forest::find_root_rows(data);
+    root_rows.push_back(total_rows);
+
+    most_massive_progenitor_rows_.assign(total_rows, npos);
+    parallel_for_chunks(0, root_rows.size() - 1,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            DescendantIndex descendant_index;
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                descendant_index.build(data, root_rows[t], root_rows[t + 1]);
+
+                                for (size_t row = root_rows[t]; row < root_rows[t + 1]; row++) {
+                                    const size_t *progenitor_begin 
+                                        = descendant_index.progenitors_begin(row);
+                                    const size_t *progenitor_end
+                                        = descendant_index.progenitors_end(row);
+                                    if (progenitor_begin == progenitor_end) {
+                                        continue;
+                                    }
+
+                                    most_massive_progenitor_rows_[row] 
+                                        = find_main_progenitor(data, progenitor_begin, 
+                                                               progenitor_end, mass_key, 
+                                                               flag_key);
+                                }
+                            }
+                        }, requested_threads);
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    std::cout << "Indexed the most massive progenitors of " << total_rows << " rows in ";
+    std::cout << seconds_interval.count() << " s\n";
+#endif
+}
+
+inline size_t MostMassiveProgenitorIndex::get_main_branch_length(const size_t row) const {
+    size_t length = 0;
+    for (size_t branch_row = row; branch_row != npos;
+         branch_row = most_massive_progenitor_rows_[branch_row]) {
+        length++;
+    }
+
+    return length;
+}
+
+/**
+ * The rows of the main branch, starting from row. The rows are cleared first.
+ */
+inline void MostMassiveProgenitorIndex::get_main_branch_rows(const size_t row,
+                                                             std::vector<size_t> &rows) const {
+    rows.clear();
+    for (size_t branch_row = row; branch_row != npos;
+         branch_row = most_massive_progenitor_rows_[branch_row]) {
+        rows.push_back(branch_row);
+    }
+}
+
+/**
+ * Same as Tree::traverse_most_massive_branch, but starting from a data row
+ * and following the index instead of the first children.
+ */
+template <typename T, typename DataFileFormat>
+void MostMassiveProgenitorIndex::traverse_most_massive_branch(
+    const DataContainer<DataFileFormat> &data, const size_t row, const size_t key,
+    std::vector<T> &value_list) const {
+    for (size_t branch_row = row; branch_row != npos;
+         branch_row = most_massive_progenitor_rows_[branch_row]) {
+        value_list.push_back(data.template get_data<T>(branch_row, key));
+    }
+}
+
+/**
+ * Moves the most massive progenitor of every node to the front of its
+ * children, so that the functions that follow the first child of a Tree
+ * (traverse_most_massive_branch, extract_main_branch, FormationTime::compute
+ * with trees, ...) follow this index. The other children keep their order.
+ * Only the nodes of the tree are reordered: FlatTrees built from the data
+ * (e.g. by FormationTime::compute without trees or by PrunedForest) still
+ * take the first progenitor in data order. Lazily built trees have to be
+ * expanded completely first, since nodes expanded later would be in data
+ * order again.
+ */
+inline void MostMassiveProgenitorIndex::order_children(Tree &tree) const {
+    tree.check_complete();
+    if (tree.root_node_ == nullptr) {
+        return;
+    }
+
+    std::vector<Node *> to_visit = {tree.root_node_.get()};
+    while (!to_visit.empty()) {
+        Node *node = to_visit.back();
+        to_visit.pop_back();
+
+        auto &children = node->children_;
+        const size_t most_massive_row = most_massive_progenitor_rows_[node->get_data_row()];
+        auto most_massive_child = std::find_if(children.begin(), children.end(),
+                                               [most_massive_row](const auto &child) {
+                                                   return child->get_data_row() == most_massive_row;
+                                               });
+        if (most_massive_child != children.end()) {
+            std::rotate(children.begin(), most_massive_child, most_massive_child + 1);
+        }
+
+        for (const auto &child : children) {
+            to_visit.push_back(child.get());
+        }
+    }
+}
+
+inline void MostMassiveProgenitorIndex::order_children(Forest &forest,
+                                                       const size_t requested_threads) const {
+    parallel_for_chunks(0, forest.get_number_of_trees(),
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                order_children(*forest.trees_[t]);
+                            }
+                        }, requested_threads);
+}
+
+#endif
@@ -21,6 +21,8 @@
 
 #include <memory>
 #include <vector>
+#include <memory_resource>
+#include <cstdint>
 #include "Halo.hpp"
 
 // we need to share the "current" node as the parent of the added child
@@ -33,10 +35,19 @@ public:
 
     // prevent cyclic references from parent -> child -> parent by using a weak_ptr
     std::weak_ptr<Node> parent_;
-    std::vector<std::shared_ptr<Node>> children_;
+    // the list of children is allocated from the same memory resource as the
+    // node when the node lives in a NodeArena
+    std::pmr::vector<std::shared_ptr<Node>> children_;
+
+    // in a lazily built tree, the number of generations of progenitors that
+    // can still be attached below this node when it is first traversed, zero
+    // once the children are complete
+    uint32_t pending_depth_ = 0;
 
     Node(const size_t node_index, 
-         const std::shared_ptr<Node> parent, const int64_t id) {
+         const std::shared_ptr<Node> parent, const int64_t id,
+         std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : children_(resource) {
         data_row_ = node_index;
 
         set_parent(parent);
@@ -50,6 +61,8 @@ public:
         halo.set_id(id);
     }
 
+    ~Node();
+
     void add_child(std::shared_ptr<Node> child);
     std::shared_ptr<Node> get_parent(void) const;
     void set_parent(std::shared_ptr<Node> parent);
@@ -58,6 +71,49 @@ public:
     void info(void) const;
 };
 
+/**
+ * The descendants are released iteratively, so that destroying a very deep
+ * tree (e.g. a long main branch) does not overflow the stack, and without
+ * allocating: the child lists of the nodes that are destroyed here are the
+ * work stack. When a node with progenitors is taken off the current list, the
+ * rest of the list moves into that node, with the previously saved node at
+ * its back (there is always room, since the node itself was just removed),
+ * and its progenitors become the current list. Once a list is done, the
+ * saved node gives back the rest of its list and is released.
+ */
+inline Node::~Node() {
+    std::shared_ptr<Node> saved;
+    while (true) {
+        if (children_.empty()) {
+            if (saved == nullptr) {
+                break;
+            }
+
+            children_.swap(saved->children_);
+            std::shared_ptr<Node> previous = std::move(children_.back());
+            children_.pop_back();
+            // the saved node has no children left, so it is released right away
+            saved = std::move(previous);
+            continue;
+        }
+
+        std::shared_ptr<Node> node = std::move(children_.back());
+        children_.pop_back();
+
+        // nodes that are shared elsewhere keep their children, leaves are
+        // simply released, and lists from another memory resource cannot be
+        // swapped, so those nodes release their own progenitors
+        if (node.use_count() != 1 || node->children_.empty()
+            || node->children_.get_allocator() != children_.get_allocator()) {
+            continue;
+        }
+
+        children_.push_back(std::move(saved));
+        children_.swap(node->children_);
+        saved = std::move(node);
+    }
+}
+
 inline void Node::add_child(std::shared_ptr<Node> child) {
     children_.push_back(child);
     child->parent_ = shared_from_this();
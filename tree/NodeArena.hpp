@@ -0,0 +1,112 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NODEARENA_HPP
+#define NODEARENA_HPP
+
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include "Node.hpp"
+
+/**
+ * Bump allocator for the nodes of a tree and their lists of children. The
+ * memory is taken from large blocks of a monotonic_buffer_resource and is
+ * only released, all at once, when the arena is destroyed.
+ *
+ * Every node that is made with make_node() keeps the arena alive through its
+ * shared_ptr control block, so nodes that are held outside of the tree stay
+ * valid after the tree is gone. The arena is not thread-safe, so a tree should
+ * be built by a single thread (Forest uses one arena per tree).
+ */
+class NodeArena : public std::pmr::memory_resource,
+                  public std::enable_shared_from_this<NodeArena> {
+private:
+    std::pmr::monotonic_buffer_resource resource_;
+    size_t allocated_bytes_ = 0;
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        allocated_bytes_ += bytes;
+        return resource_.allocate(bytes, alignment);
+    }
+
+    // everything is released when the arena is destroyed
+    void do_deallocate(void *, size_t, size_t) override { }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit NodeArena(const size_t initial_bytes = 65536) : resource_(initial_bytes) { }
+
+    NodeArena(const NodeArena &) = delete;
+    NodeArena &operator=(const NodeArena &) = delete;
+
+    size_t get_allocated_bytes(void) const { return allocated_bytes_; }
+
+    std::shared_ptr<Node> make_node(const size_t node_index,
+                                    const std::shared_ptr<Node> parent,
+                                    const int64_t id);
+};
+
+/**
+ * The allocator that allocate_shared stores in the control block of every
+ * node, it holds a reference to the arena so that the arena outlives the node.
+ */
+template <typename T>
+class NodeArenaAllocator {
+public:
+    using value_type = T;
+
+    std::shared_ptr<NodeArena> arena_;
+
+    explicit NodeArenaAllocator(std::shared_ptr<NodeArena> arena) : arena_(std::move(arena)) { }
+
+    template <typename U>
+    NodeArenaAllocator(const NodeArenaAllocator<U> &other) : arena_(other.arena_) { }
+
+    T *allocate(const size_t n) {
+        return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, const size_t n) {
+        arena_->deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const NodeArenaAllocator<U> &other) const { return arena_ == other.arena_; }
+
+    template <typename U>
+    bool operator!=(const NodeArenaAllocator<U> &other) const { return arena_ != other.arena_; }
+};
+
+/**
+ * Allocates the node, its control block and its list of children in the arena.
+ * The arena must be owned by a shared_ptr.
+ */
+inline std::shared_ptr<Node> NodeArena::make_node(const size_t node_index,
+                                                  const std::shared_ptr<Node> parent,
+                                                  const int64_t id) {
+    return std::allocate_shared<Node>(NodeArenaAllocator<Node>(shared_from_this()),
+                                      node_index, parent, id, this);
+}
+
+#endif
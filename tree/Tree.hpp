@@ -25,8 +25,51 @@
 #include <chrono>
 #include <iostream>
 #include <queue>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <string>
 #include "Node.hpp"
+#include "NodeArena.hpp"
+#include "DescendantIndex.hpp"
 #include "../io/DataContainer.hpp"
+#include "../io/MemoryReport.hpp"
+#include "../io/DataView.hpp"
+
+// recursive scans the rows once per node, iterative does the same scan with
+// an explicit stack instead of the call stack, adjacency groups the rows by
+// descendant first and builds the same tree in linear time, and lazy only
+// creates the root and attaches the children of a node when it is traversed
+// (lazy trees are built with build_tree_lazy, which takes their limits)
+enum class TreeBuildMode {
+    recursive,
+    iterative,
+    adjacency,
+    lazy
+};
+
+// limits of a lazily built tree: nodes deeper than max_depth below the root
+// are never expanded, and progenitors with a mass (in mass_column) below
+// min_mass are not attached if min_mass is positive
+struct LazyTreeLimits {
+    uint32_t max_depth = std::numeric_limits<uint32_t>::max();
+    double min_mass = 0.;
+    std::string mass_column = "virial_mass";
+};
+
+// reusable buffers for the iterative build and search functions, so that
+// calling them for every tree in a forest does not allocate every time
+struct TreeScratch {
+    // (node, next row to scan) of every node that is being built
+    std::vector<std::pair<Node *, size_t>> build_stack;
+    // the first unvisited local row at or after every local row
+    std::vector<size_t> next_unvisited_rows;
+    std::vector<const std::shared_ptr<Node> *> node_queue;
+    // (node, index of its next child) along the path of a depth-first walk,
+    // and the queue of a breadth-first walk, see TreeWalk.hpp
+    std::vector<std::pair<const std::shared_ptr<Node> *, size_t>> walk_stack;
+    std::vector<const std::shared_ptr<Node> *> walk_queue;
+};
 
 class Tree {
 public:
@@ -34,6 +77,20 @@ public:
     size_t root_node_row_in_data_;
     size_t next_root_node_row_in_data_;
 
+    // optional, the arena that build_tree allocates the nodes from
+    std::shared_ptr<NodeArena> node_arena_;
+
+private:
+    // for lazily built trees, the progenitors of every row, either shared by
+    // all of the trees of a forest or indexed when the first node is expanded
+    mutable std::shared_ptr<const DescendantIndex> lazy_index_;
+    double lazy_min_mass_ = 0.;
+    size_t lazy_mass_key_ = 0;
+    size_t lazy_id_key_ = 0;
+    // the number of nodes that still have to be expanded
+    mutable size_t lazy_pending_nodes_ = 0;
+
+public:
     Tree(std::shared_ptr<Node> root_node,
          size_t root_node_row_in_data,
          size_t next_root_node_row_in_data) { 
@@ -42,6 +99,11 @@ public:
         next_root_node_row_in_data_ = next_root_node_row_in_data;
     }
 
+    void use_node_arena(size_t initial_bytes = 0);
+    std::shared_ptr<Node> make_node(const size_t node_index,
+                                    const std::shared_ptr<Node> parent,
+                                    const int64_t id) const;
+
     template <typename DataFileFormat>
     void recursive_build_tree(const DataContainer<DataFileFormat> &data,
                               std::shared_ptr<Node> &parent_node, 
@@ -49,7 +111,37 @@ public:
                               const size_t start_index, const size_t end_index);
 
     template <typename DataFileFormat>
-    void build_tree(DataContainer<DataFileFormat> &data);
+    void iterative_build_tree(const DataContainer<DataFileFormat> &data,
+                              TreeScratch &scratch);
+
+    template <typename DataFileFormat>
+    void build_tree_from_adjacency(const DataContainer<DataFileFormat> &data);
+
+    template <typename DataFileFormat>
+    void build_tree(DataContainer<DataFileFormat> &data,
+                    const TreeBuildMode mode = TreeBuildMode::recursive);
+
+    template <typename DataFileFormat>
+    void build_tree(DataContainer<DataFileFormat> &data,
+                    const TreeBuildMode mode, TreeScratch &scratch);
+
+    template <typename DataFileFormat>
+    void build_tree_lazy(const DataContainer<DataFileFormat> &data,
+                         const LazyTreeLimits &limits = LazyTreeLimits(),
+                         std::shared_ptr<const DescendantIndex> descendant_index = nullptr);
+
+    template <typename DataFileFormat>
+    void expand_node(const DataContainer<DataFileFormat> &data, Node *node) const;
+
+    template <typename DataFileFormat>
+    void expand_tree(const DataContainer<DataFileFormat> &data) const;
+
+    bool is_complete(void) const { return lazy_pending_nodes_ == 0; }
+    void check_complete(void) const;
+
+    template <typename DataFileFormat>
+    void expand_main_branch(const DataContainer<DataFileFormat> &data,
+                            const std::shared_ptr<Node> &node) const;
 
     template <typename T, typename DataFileFormat>
     void traverse_most_massive_branch(const DataContainer<DataFileFormat> &data,
@@ -57,6 +149,20 @@ public:
                                       const size_t key,
                                       std::vector<T> &value_list) const;
 
+    size_t get_main_branch_length(const std::shared_ptr<Node> &node) const;
+
+    template <typename DataFileFormat>
+    size_t extract_main_branch(const DataContainer<DataFileFormat> &data,
+                               const std::shared_ptr<Node> &node,
+                               const std::vector<size_t> &keys,
+                               double *values, const size_t stride) const;
+
+    template <typename DataFileFormat>
+    size_t extract_main_branch(const DataContainer<DataFileFormat> &data,
+                               const std::shared_ptr<Node> &node,
+                               const std::vector<size_t> &keys,
+                               std::vector<double> &values) const;
+
     template <typename T, typename Comparison, typename DataFileFormat>
     void recursive_breadth_first_search(const DataContainer<DataFileFormat> &data,
                                         std::queue<std::shared_ptr<Node>> &to_visit,
@@ -70,8 +176,57 @@ public:
                          const std::shared_ptr<Node> &node,
                          const size_t key, const T query,
                          Comparison compare) const;
+
+    template <typename T, typename Comparison, typename DataFileFormat>
+    std::vector<std::shared_ptr<Node>>
+    breadth_first_search(const DataContainer<DataFileFormat> &data,
+                         const std::shared_ptr<Node> &node,
+                         const size_t key, const T query,
+                         Comparison compare, TreeScratch &scratch) const;
+
+    template <typename T, typename Comparison, typename DataFileFormat>
+    size_t breadth_first_search(const DataContainer<DataFileFormat> &data,
+                                const std::shared_ptr<Node> &node,
+                                const size_t key, const T query,
+                                Comparison compare, std::vector<size_t> &rows,
+                                TreeScratch &scratch) const;
+
+    template <typename DataFileFormat>
+    DataRangeView<DataFileFormat> get_data_view(const DataContainer<DataFileFormat> &data) const;
+
+    size_t get_number_of_nodes(void) const;
+    size_t get_number_of_expanded_nodes(void) const;
+    MemoryReport get_memory_report(void) const;
 };
 
+/**
+ * All of the nodes that are built from now on are allocated from a new
+ * NodeArena, instead of one heap allocation per node. Without a size, the
+ * first block of the arena is estimated from the number of rows in the tree.
+ */
+inline void Tree::use_node_arena(size_t initial_bytes) {
+    if (initial_bytes == 0) {
+        // the node, its control block and its entry in the list of children
+        const size_t bytes_per_node = sizeof(Node) + sizeof(std::shared_ptr<NodeArena>)
+                                      + 2 * sizeof(std::shared_ptr<Node>);
+        initial_bytes = std::max((size_t)1024, 
+                                 (next_root_node_row_in_data_ - root_node_row_in_data_)
+                                 * bytes_per_node);
+    }
+
+    node_arena_ = std::make_shared<NodeArena>(initial_bytes);
+}
+
+inline std::shared_ptr<Node> Tree::make_node(const size_t node_index,
+                                             const std::shared_ptr<Node> parent,
+                                             const int64_t id) const {
+    if (node_arena_ != nullptr) {
+        return node_arena_->make_node(node_index, parent, id);
+    }
+
+    return std::make_shared<Node>(node_index, parent, id);
+}
+
 template <typename DataFileFormat>
 void Tree::recursive_build_tree(const DataContainer<DataFileFormat> &data,
                                 std::shared_ptr<Node> &parent_node, 
@@ -98,7 +253,7 @@ void Tree::recursive_build_tree(const DataContainer<DataFileFormat> &data,
 
         if (descendant_id == parent_node->halo.get_id()) {
             parent_node->add_child(
-                std::make_shared<Node>(indexer, parent_node, child_id)
+                make_node(indexer, parent_node, child_id)
             );
 
             // make sure we do not visit this node again
@@ -115,23 +270,153 @@ void Tree::recursive_build_tree(const DataContainer<DataFileFormat> &data,
     }
 }
 
+/**
+ * Builds exactly the same tree as recursive_build_tree, with the same scan
+ * over the rows, but keeps the nodes that are being built on an explicit
+ * stack so that the depth of the tree does not matter. The visited rows are
+ * skipped through path-compressed links to the next unvisited row, so a long
+ * main branch does not rescan all of the rows that were already attached.
+ */
 template <typename DataFileFormat>
-void Tree::build_tree(DataContainer<DataFileFormat> &data) {
+void Tree::iterative_build_tree(const DataContainer<DataFileFormat> &data,
+                                TreeScratch &scratch) {
+    const ColumnSpan<std::variant<double, int64_t>> id_span
+        = data.get_column_span(data.get_internal_key("id"));
+    const ColumnSpan<std::variant<double, int64_t>> descendant_id_span
+        = data.get_column_span(data.get_internal_key("descendant_id"));
+
+    const size_t total_rows = next_root_node_row_in_data_ - root_node_row_in_data_;
+    auto &next_unvisited = scratch.next_unvisited_rows;
+    next_unvisited.resize(total_rows + 1);
+    for (size_t i = 0; i <= total_rows; i++) {
+        next_unvisited[i] = i;
+    }
+    next_unvisited[0] = 1;
+
+    auto find_unvisited = [&next_unvisited](size_t local_row) {
+        while (next_unvisited[local_row] != local_row) {
+            next_unvisited[local_row] = next_unvisited[next_unvisited[local_row]];
+            local_row = next_unvisited[local_row];
+        }
+        return local_row;
+    };
+
+    auto &to_build = scratch.build_stack;
+    to_build.clear();
+    to_build.push_back(std::make_pair(root_node_.get(), root_node_row_in_data_ + 1));
+
+    while (!to_build.empty()) {
+        Node *parent_node = to_build.back().first;
+        const int64_t parent_id = parent_node->halo.get_id();
+
+        // continue the scan of the parent where it stopped for the last child
+        size_t indexer = to_build.back().second;
+        for (; indexer < next_root_node_row_in_data_; indexer++) {
+            indexer = root_node_row_in_data_ 
+                      + find_unvisited(indexer - root_node_row_in_data_);
+            if (indexer == next_root_node_row_in_data_) {
+                break;
+            }
+
+            const auto descendant_id = descendant_id_span.get<int64_t>(indexer);
+            if (descendant_id == parent_id) {
+                break;
+            }
+            else if (descendant_id == -1) {
+                throw std::runtime_error("Should never reach the next tree!");
+            }
+        }
+
+        if (indexer == next_root_node_row_in_data_) {
+            to_build.pop_back();
+            continue;
+        }
+
+        next_unvisited[indexer - root_node_row_in_data_] = indexer - root_node_row_in_data_ + 1;
+        parent_node->add_child(
+            make_node(indexer, nullptr, id_span.get<int64_t>(indexer))
+        );
+
+        to_build.back().second = indexer + 1;
+        to_build.push_back(std::make_pair(parent_node->children_.back().get(), indexer + 1));
+    }
+}
+
+/**
+ * Builds the tree in O(N) by first grouping the rows by their descendant
+ * (see DescendantIndex) and then linking the nodes, without any recursion.
+ * The shape and the order of the children are the same as recursive_build_tree.
+ */
+template <typename DataFileFormat>
+void Tree::build_tree_from_adjacency(const DataContainer<DataFileFormat> &data) {
+    DescendantIndex descendant_index;
+    descendant_index.build(data, root_node_row_in_data_, next_root_node_row_in_data_);
+
+    const ColumnSpan<std::variant<double, int64_t>> id_span
+        = data.get_column_span(data.get_internal_key("id"));
+
+    std::vector<Node *> to_visit = {root_node_.get()};
+    while (!to_visit.empty()) {
+        Node *parent_node = to_visit.back();
+        to_visit.pop_back();
+
+        const auto parent_row = parent_node->get_data_row();
+        const size_t *progenitor_row = descendant_index.progenitors_begin(parent_row);
+        const size_t *progenitor_end = descendant_index.progenitors_end(parent_row);
+        parent_node->children_.reserve(progenitor_end - progenitor_row);
+
+        for (; progenitor_row != progenitor_end; progenitor_row++) {
+            auto child_id = id_span.get<int64_t>(*progenitor_row);
+            parent_node->add_child(
+                make_node(*progenitor_row, nullptr, child_id)
+            );
+            to_visit.push_back(parent_node->children_.back().get());
+        }
+    }
+}
+
+template <typename DataFileFormat>
+void Tree::build_tree(DataContainer<DataFileFormat> &data, const TreeBuildMode mode) {
+    TreeScratch scratch;
+    build_tree(data, mode, scratch);
+}
+
+/**
+ * The scratch buffers are only used by TreeBuildMode::iterative. Lazy trees
+ * are built with build_tree_lazy, which takes their limits.
+ */
+template <typename DataFileFormat>
+void Tree::build_tree(DataContainer<DataFileFormat> &data, const TreeBuildMode mode,
+                      TreeScratch &scratch) {
+    if (mode == TreeBuildMode::lazy) {
+        throw std::runtime_error("Lazy trees are built with build_tree_lazy (or Forest::build_forest_lazy).\n");
+    }
+    lazy_index_ = nullptr;
+    lazy_min_mass_ = 0.;
+    lazy_pending_nodes_ = 0;
 
     int64_t id;
 
     id = data.template
          get_data<int64_t>(root_node_row_in_data_, data.get_internal_key("id"));
-    root_node_ = std::make_shared<Node>(root_node_row_in_data_, nullptr, id);
-
-    std::unordered_set<size_t> visited_node_indices;
-    visited_node_indices.insert(root_node_row_in_data_);
+    root_node_ = make_node(root_node_row_in_data_, nullptr, id);
 
 #ifdef TREE_VERBOSE
     auto start_time = std::chrono::high_resolution_clock::now();
 #endif
-    recursive_build_tree(data, root_node_, visited_node_indices,
-                         root_node_row_in_data_, next_root_node_row_in_data_);
+    if (mode == TreeBuildMode::adjacency) {
+        build_tree_from_adjacency(data);
+    }
+    else if (mode == TreeBuildMode::iterative) {
+        iterative_build_tree(data, scratch);
+    }
+    else {
+        std::unordered_set<size_t> visited_node_indices;
+        visited_node_indices.insert(root_node_row_in_data_);
+
+        recursive_build_tree(data, root_node_, visited_node_indices,
+                             root_node_row_in_data_, next_root_node_row_in_data_);
+    }
 #ifdef TREE_VERBOSE
     auto end_time = std::chrono::high_resolution_clock::now();
     int64_t total_nodes = next_root_node_row_in_data_ - root_node_row_in_data_;
@@ -142,23 +427,209 @@ void Tree::build_tree(DataContainer<DataFileFormat> &data) {
 #endif
 }
 
+/**
+ * Only creates the root node. The children of a node are attached the first
+ * time that the node is traversed (by traverse_most_massive_branch,
+ * breadth_first_search, extract_main_branch, or expand_node), so analyses
+ * that only look at the top of the tree or at the main branch only build the
+ * nodes that they visit. The children are in the same order as in the other
+ * build modes. A lazy tree must not be traversed by several threads at once.
+ *
+ * The progenitors are looked up in descendant_index, which has to cover the
+ * rows of the tree and is usually shared by all of the trees of a forest (see
+ * Forest::build_forest_lazy). Without it, the rows of the tree are indexed
+ * when the first node is expanded.
+ */
+template <typename DataFileFormat>
+void Tree::build_tree_lazy(const DataContainer<DataFileFormat> &data,
+                           const LazyTreeLimits &limits,
+                           std::shared_ptr<const DescendantIndex> descendant_index) {
+    if (descendant_index != nullptr
+        && (descendant_index->get_first_row() > root_node_row_in_data_
+            || descendant_index->get_end_row() < next_root_node_row_in_data_)) {
+        throw std::runtime_error("The descendant index does not cover the rows of the tree.\n");
+    }
+
+    lazy_id_key_ = data.get_internal_key("id");
+    const int64_t id = data.template get_data<int64_t>(root_node_row_in_data_, lazy_id_key_);
+    root_node_ = make_node(root_node_row_in_data_, nullptr, id);
+    root_node_->pending_depth_ = limits.max_depth;
+    lazy_pending_nodes_ = (limits.max_depth > 0) ? 1 : 0;
+
+    lazy_index_ = descendant_index;
+    lazy_min_mass_ = limits.min_mass;
+    if (lazy_min_mass_ > 0.) {
+        lazy_mass_key_ = data.get_internal_key(limits.mass_column);
+    }
+}
+
+/**
+ * Attaches the progenitors of a node of a lazily built tree, if they are not
+ * attached yet. Does nothing for nodes of fully built trees.
+ */
+template <typename DataFileFormat>
+void Tree::expand_node(const DataContainer<DataFileFormat> &data, Node *node) const {
+    if (node->pending_depth_ == 0) {
+        return;
+    }
+
+    const uint32_t child_pending_depth = node->pending_depth_ - 1;
+    node->pending_depth_ = 0;
+    lazy_pending_nodes_--;
+
+    if (lazy_index_ == nullptr) {
+        auto descendant_index = std::make_shared<DescendantIndex>();
+        descendant_index->build(data, root_node_row_in_data_, next_root_node_row_in_data_);
+        lazy_index_ = descendant_index;
+    }
+
+    const ColumnSpan<std::variant<double, int64_t>> id_span = data.get_column_span(lazy_id_key_);
+
+    const auto row = node->get_data_row();
+    const size_t *progenitor_row = lazy_index_->progenitors_begin(row);
+    const size_t *progenitor_end = lazy_index_->progenitors_end(row);
+    node->children_.reserve(progenitor_end - progenitor_row);
+
+    for (; progenitor_row != progenitor_end; progenitor_row++) {
+        if (lazy_min_mass_ > 0. 
+            && data.get_data_as_double(*progenitor_row, lazy_mass_key_) < lazy_min_mass_) {
+            continue;
+        }
+
+        node->add_child(
+            make_node(*progenitor_row, nullptr, id_span.get<int64_t>(*progenitor_row))
+        );
+        node->children_.back()->pending_depth_ = child_pending_depth;
+        if (child_pending_depth > 0) {
+            lazy_pending_nodes_++;
+        }
+    }
+}
+
+/**
+ * Expands every node of a lazily built tree (within its limits), so that it
+ * can be used like a fully built tree.
+ */
+template <typename DataFileFormat>
+void Tree::expand_tree(const DataContainer<DataFileFormat> &data) const {
+    if (root_node_ == nullptr) {
+        return;
+    }
+
+    std::vector<Node *> to_visit = {root_node_.get()};
+    while (!to_visit.empty() && !is_complete()) {
+        Node *node = to_visit.back();
+        to_visit.pop_back();
+        expand_node(data, node);
+
+        for (const auto &child : node->children_) {
+            to_visit.push_back(child.get());
+        }
+    }
+}
+
+/**
+ * Everything that visits all of the nodes of a tree without the data calls
+ * this first, so that a lazily built tree that is not expanded completely is
+ * never mistaken for the whole tree.
+ */
+inline void Tree::check_complete(void) const {
+    if (!is_complete()) {
+        throw std::runtime_error("The lazily built tree is not expanded completely, "
+                                 "call expand_tree first.\n");
+    }
+}
+
+/**
+ * Expands every node on the main branch, starting from node.
+ */
+template <typename DataFileFormat>
+void Tree::expand_main_branch(const DataContainer<DataFileFormat> &data,
+                              const std::shared_ptr<Node> &node) const {
+    Node *current_node = node.get();
+    while (current_node != nullptr) {
+        expand_node(data, current_node);
+        current_node = current_node->children_.empty() 
+                       ? nullptr : current_node->children_[0].get();
+    }
+}
+
 template <typename T, typename DataFileFormat>
 void Tree::traverse_most_massive_branch(const DataContainer<DataFileFormat> &data,
                                         const std::shared_ptr<Node> &node,
                                         const size_t key,
                                         std::vector<T> &value_list) const {
-    if (node == nullptr) {
-        return;
+    // the most massive progenitor is always the first child
+    Node *current_node = node.get();
+    while (current_node != nullptr) {
+        T value = data.template
+                  get_data<T>(current_node->get_data_row(), key);
+        value_list.push_back(value);
+
+        expand_node(data, current_node);
+        current_node = current_node->children_.empty() 
+                       ? nullptr : current_node->children_[0].get();
     }
+}
 
-    T value = data.template
-              get_data<T>(node->get_data_row(), key);
-    value_list.push_back(value);
+/**
+ * The number of nodes on the main branch, starting from (and including) node.
+ */
+inline size_t Tree::get_main_branch_length(const std::shared_ptr<Node> &node) const {
+    size_t length = 0;
+    const Node *current_node = node.get();
+    while (current_node != nullptr) {
+        length++;
+        current_node = current_node->children_.empty() 
+                       ? nullptr : current_node->children_[0].get();
+    }
+
+    return length;
+}
 
-    if (!node->children_.empty()) {
-        traverse_most_massive_branch<T, DataFileFormat>(data, node->children_[0], 
-                                                        key, value_list);
+/**
+ * Walks the main branch once and writes the values of all of the columns in
+ * keys, as doubles, into values in column-major order: the value of column
+ * keys[c] at the i-th node of the branch goes to values[c * stride + i]. The
+ * output must have room for get_main_branch_length(node) values per column.
+ * Returns the length of the branch.
+ */
+template <typename DataFileFormat>
+size_t Tree::extract_main_branch(const DataContainer<DataFileFormat> &data,
+                                 const std::shared_ptr<Node> &node,
+                                 const std::vector<size_t> &keys,
+                                 double *values, const size_t stride) const {
+    size_t length = 0;
+    Node *current_node = node.get();
+    while (current_node != nullptr) {
+        const auto row = current_node->get_data_row();
+        for (size_t c = 0; c < keys.size(); c++) {
+            values[c * stride + length] = data.get_data_as_double(row, keys[c]);
+        }
+        length++;
+
+        expand_node(data, current_node);
+        current_node = current_node->children_.empty() 
+                       ? nullptr : current_node->children_[0].get();
     }
+
+    return length;
+}
+
+/**
+ * Same as above, with values resized to hold exactly the branch, i.e. the
+ * stride is the length of the branch.
+ */
+template <typename DataFileFormat>
+size_t Tree::extract_main_branch(const DataContainer<DataFileFormat> &data,
+                                 const std::shared_ptr<Node> &node,
+                                 const std::vector<size_t> &keys,
+                                 std::vector<double> &values) const {
+    expand_main_branch(data, node);
+    const size_t length = get_main_branch_length(node);
+    values.resize(keys.size() * length);
+
+    return extract_main_branch(data, node, keys, values.data(), length);
 }
 
 template <typename T, typename Comparison, typename DataFileFormat>
@@ -192,17 +663,164 @@ Tree::breadth_first_search(const DataContainer<DataFileFormat> &data,
                            const std::shared_ptr<Node> &node,
                            const size_t key, const T query,
                            Comparison compare) const {
-    // stack of the the visited nodes
-    std::queue<std::shared_ptr<Node>> to_visit;
-    to_visit.push(node);
+    TreeScratch scratch;
+    return breadth_first_search(data, node, key, query, compare, scratch);
+}
+
+/**
+ * Same as breadth_first_search, but the queue is kept in the scratch buffers.
+ * The queue is a vector whose front only moves forward, and it holds pointers
+ * to the shared_ptrs in the trees so that no reference counts change.
+ */
+template <typename T, typename Comparison, typename DataFileFormat>
+std::vector<std::shared_ptr<Node>>
+Tree::breadth_first_search(const DataContainer<DataFileFormat> &data,
+                           const std::shared_ptr<Node> &node,
+                           const size_t key, const T query,
+                           Comparison compare, TreeScratch &scratch) const {
+    auto &to_visit = scratch.node_queue;
+    to_visit.clear();
+    to_visit.push_back(&node);
 
     std::vector<std::shared_ptr<Node>> nodes;
 
-    recursive_breadth_first_search(data, to_visit, key, query, 
-                                   compare, nodes);
-    
+    T value;
+    for (size_t front = 0; front < to_visit.size(); front++) {
+        const std::shared_ptr<Node> &visiting = *to_visit[front];
+        expand_node(data, visiting.get());
+        for (const auto &child : visiting->children_) {
+            to_visit.push_back(&child);
+        }
+
+        value = data.template 
+                get_data<T>(visiting->get_data_row(), key);
+        if (compare(value, query)) {
+            nodes.push_back(visiting);
+        }
+    }
+
     return nodes;
 }
 
-#endif
+/**
+ * Same search as breadth_first_search, but the data rows of the matching nodes
+ * are written into rows (which is cleared first) instead of copying the
+ * shared_ptrs. Once rows and the scratch buffers have grown to the size of
+ * the largest search, repeated searches do not allocate. Returns the number
+ * of matching nodes.
+ */
+template <typename T, typename Comparison, typename DataFileFormat>
+size_t Tree::breadth_first_search(const DataContainer<DataFileFormat> &data,
+                                  const std::shared_ptr<Node> &node,
+                                  const size_t key, const T query,
+                                  Comparison compare, std::vector<size_t> &rows,
+                                  TreeScratch &scratch) const {
+    rows.clear();
+    if (node == nullptr) {
+        return 0;
+    }
+
+    auto &to_visit = scratch.node_queue;
+    to_visit.clear();
+    to_visit.push_back(&node);
+
+    for (size_t front = 0; front < to_visit.size(); front++) {
+        Node *visiting = to_visit[front]->get();
+        expand_node(data, visiting);
+        for (const auto &child : visiting->children_) {
+            to_visit.push_back(&child);
+        }
+
+        const auto row = visiting->get_data_row();
+        if (compare(data.template get_data<T>(row, key), query)) {
+            rows.push_back(row);
+        }
+    }
+
+    return rows.size();
+}
+
+/**
+ * Returns a zero-copy view of the rows of the data that belong to this tree.
+ */
+template <typename DataFileFormat>
+DataRangeView<DataFileFormat> Tree::get_data_view(const DataContainer<DataFileFormat> &data) const {
+    return DataRangeView<DataFileFormat>(data, root_node_row_in_data_, 
+                                         next_root_node_row_in_data_);
+}
+
+inline size_t Tree::get_number_of_nodes(void) const {
+    check_complete();
+    return get_number_of_expanded_nodes();
+}
+
+/**
+ * The number of nodes that are attached so far, which is less than the
+ * number of nodes of a lazily built tree that is not expanded completely.
+ */
+inline size_t Tree::get_number_of_expanded_nodes(void) const {
+    if (root_node_ == nullptr) {
+        return 0;
+    }
+
+    size_t total_nodes = 0;
+    std::vector<const Node *> to_visit = {root_node_.get()};
+    while (!to_visit.empty()) {
+        const Node *node = to_visit.back();
+        to_visit.pop_back();
+        total_nodes++;
+
+        for (const auto &child : node->children_) {
+            to_visit.push_back(child.get());
+        }
+    }
 
+    return total_nodes;
+}
+
+/**
+ * Reports the bytes used by the Node objects (including the shared_ptr control
+ * blocks from make_shared) and by their lists of children. With a node arena
+ * the nodes, control blocks and lists of children all come from the arena,
+ * which never gives memory back, so the bytes allocated from the arena are
+ * reported instead, including the lists of children that were outgrown.
+ */
+inline MemoryReport Tree::get_memory_report(void) const {
+    MemoryReport report;
+
+    if (node_arena_ != nullptr) {
+        report.entries.push_back(std::make_pair("node arena", 
+                                                node_arena_->get_allocated_bytes()));
+        report.data_bytes = node_arena_->get_allocated_bytes();
+        report.metadata_bytes = sizeof(*this) + sizeof(NodeArena);
+
+        return report;
+    }
+
+    size_t node_bytes = 0;
+    size_t child_list_bytes = 0;
+    if (root_node_ != nullptr) {
+        std::vector<const Node *> to_visit = {root_node_.get()};
+        while (!to_visit.empty()) {
+            const Node *node = to_visit.back();
+            to_visit.pop_back();
+
+            // the control block holds a vtable pointer and two reference counts
+            node_bytes += sizeof(Node) + sizeof(void *) + 2 * sizeof(int);
+            child_list_bytes += node->children_.capacity() * sizeof(std::shared_ptr<Node>);
+
+            for (const auto &child : node->children_) {
+                to_visit.push_back(child.get());
+            }
+        }
+    }
+
+    report.entries.push_back(std::make_pair("nodes", node_bytes));
+    report.entries.push_back(std::make_pair("child lists", child_list_bytes));
+    report.data_bytes = node_bytes + child_list_bytes;
+    report.metadata_bytes = sizeof(*this);
+
+    return report;
+}
+
+#endif
@@ -0,0 +1,179 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TREEORDER_HPP
+#define TREEORDER_HPP
+
+#include <vector>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+#include "Tree.hpp"
+#include "Forest.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+// depth_first puts every node directly before its subtree, with the first
+// (most massive) progenitor first, so that main branches and subtrees are
+// contiguous rows, and breadth_first puts every tree level by level
+enum class TreeOrder {
+    depth_first,
+    breadth_first
+};
+
+/**
+ * The nodes of a tree in the given order. The root is always first, so a
+ * tree keeps the rows [root, next root) when its rows are put in this order.
+ * Lazily built trees have to be expanded completely first.
+ */
+inline void get_tree_nodes_in_order(const Tree &tree, const TreeOrder order,
+                                    std::vector<Node *> &nodes) {
+    tree.check_complete();
+    nodes.clear();
+    if (tree.root_node_ == nullptr) {
+        return;
+    }
+
+    if (order == TreeOrder::breadth_first) {
+        // nodes doubles as the queue
+        nodes.push_back(tree.root_node_.get());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            for (const auto &child : nodes[i]->children_) {
+                nodes.push_back(child.get());
+            }
+        }
+        return;
+    }
+
+    std::vector<Node *> to_visit = {tree.root_node_.get()};
+    while (!to_visit.empty()) {
+        Node *node = to_visit.back();
+        to_visit.pop_back();
+        nodes.push_back(node);
+        for (auto child = node->children_.rbegin(); child != node->children_.rend(); child++) {
+            to_visit.push_back(child->get());
+        }
+    }
+}
+
+/**
+ * Puts the rows of every tree of the forest into the given order and points
+ * the nodes to their new rows. The trees keep their row ranges [root, next
+ * root), since the root stays first, and the rows of a range that are not in
+ * the tree are moved behind the nodes in their original order. Progenitors
+ * still come after their descendants, so the reordered data can be used to
+ * build trees again. Everything else that stores rows of the data (indices,
+ * flat trees or row lists) has to be rebuilt afterwards.
+ */
+template <typename DataFileFormat>
+void reorder_forest_rows(DataContainer<DataFileFormat> &data, Forest &forest,
+                         const TreeOrder order = TreeOrder::depth_first,
+                         const size_t requested_threads = 0) {
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    const size_t total_rows = data.get_number_of_rows();
+
+    // new row -> old row, and the node of every new row, if it has one
+    std::vector<size_t> row_order(total_rows);
+    std::iota(row_order.begin(), row_order.end(), 0);
+    std::vector<Node *> row_nodes(total_rows, nullptr);
+
+    // nothing is changed before every tree is known to be valid, and the
+    // trees only write their own ranges, so the ranges must not overlap
+    std::vector<std::pair<size_t, size_t>> tree_ranges(forest.get_number_of_trees());
+    for (size_t t = 0; t < forest.get_number_of_trees(); t++) {
+        const Tree &tree = *forest.get_tree(t);
+        tree_ranges[t] = std::make_pair(tree.root_node_row_in_data_,
+                                        tree.next_root_node_row_in_data_);
+        if (tree_ranges[t].second > total_rows || tree_ranges[t].first > tree_ranges[t].second) {
+            throw std::runtime_error("The forest was not built from this data.\n");
+        }
+    }
+    std::sort(tree_ranges.begin(), tree_ranges.end());
+    for (size_t t = 1; t < tree_ranges.size(); t++) {
+        if (tree_ranges[t].first < tree_ranges[t - 1].second) {
+            throw std::runtime_error("The row ranges of the trees overlap.\n");
+        }
+    }
+
+    parallel_for_chunks(0, forest.get_number_of_trees(), 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::vector<Node *> nodes;
+                            std::vector<uint8_t> in_tree;
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                const Tree &tree = *forest.get_tree(t);
+                                const size_t root_row = tree.root_node_row_in_data_;
+                                const size_t end_row = tree.next_root_node_row_in_data_;
+                                get_tree_nodes_in_order(tree, order, nodes);
+                                if (!nodes.empty() && nodes[0]->get_data_row() != root_row) {
+                                    throw std::runtime_error("The root of a tree has to be the first row of its range.\n");
+                                }
+
+                                in_tree.assign(end_row - root_row, 0);
+                                for (size_t i = 0; i < nodes.size(); i++) {
+                                    const size_t row = nodes[i]->get_data_row();
+                                    if (row < root_row || row >= end_row || in_tree[row - root_row]) {
+                                        throw std::runtime_error("The nodes of a tree have to be unique rows of its range.\n");
+                                    }
+                                    in_tree[row - root_row] = 1;
+                                    row_order[root_row + i] = row;
+                                    row_nodes[root_row + i] = nodes[i];
+                                }
+
+                                size_t new_row = root_row + nodes.size();
+                                for (size_t row = root_row; row < end_row; row++) {
+                                    if (!in_tree[row - root_row]) {
+                                        row_order[new_row++] = row;
+                                    }
+                                }
+                            }
+                        }, requested_threads, 1);
+
+    // every old row has to end up in exactly one new row
+    std::vector<uint8_t> assigned(total_rows, 0);
+    for (size_t row = 0; row < total_rows; row++) {
+        if (assigned[row_order[row]]) {
+            throw std::runtime_error("The new order of the rows is not a permutation.\n");
+        }
+        assigned[row_order[row]] = 1;
+    }
+
+    parallel_for_chunks(0, total_rows, 
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t row = chunk_begin; row < chunk_end; row++) {
+                                if (row_nodes[row] != nullptr) {
+                                    row_nodes[row]->set_data_row(row);
+                                }
+                            }
+                        }, requested_threads);
+
+    data.permute_rows(row_order, requested_threads);
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    std::cout << "Reordered " << total_rows << " rows in " << seconds_interval.count() << " s\n";
+#endif
+}
+
+#endif
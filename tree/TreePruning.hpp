@@ -0,0 +1,171 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TREEPRUNING_HPP
+#define TREEPRUNING_HPP
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "FlatTree.hpp"
+#include "Forest.hpp"
+#include "TreeReduce.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/MemoryReport.hpp"
+#include "../io/Parallel.hpp"
+
+// a node and its whole subtree are removed when the largest mass in the
+// subtree (in mass_column) is below min_mass, or when the node is more than
+// max_depth generations below its root. The roots are always kept.
+struct PruningLimits {
+    double min_mass = 0.;
+    size_t max_depth = std::numeric_limits<size_t>::max();
+    std::string mass_column = "virial_mass";
+};
+
+/**
+ * The trees of a data set without the progenitors that an analysis would
+ * discard anyway (e.g. resolution-limited halos), compacted into a reduced
+ * copy of the data and one FlatTree per tree over that copy, so that the
+ * memory and the traversals only scale with the halos that are kept.
+ *
+ * The kept rows stay in their original order, so the reduced data is still a
+ * valid consistent-trees data set, and original_rows_ maps every row of the
+ * reduced data back to the original data.
+ */
+template <typename DataFileFormat>
+class PrunedForest {
+public:
+    DataContainer<DataFileFormat> data_;
+    std::vector<FlatTree> trees_;
+    std::vector<size_t> original_rows_;
+
+    // data_ starts with the columns of data but no rows, until prune fills it
+    PrunedForest(const DataContainer<DataFileFormat> &data, const PruningLimits &limits,
+                 const size_t requested_threads = 0) 
+        : data_(data.select_rows(std::vector<size_t>())) {
+        prune(data, limits, requested_threads);
+    }
+
+    void prune(const DataContainer<DataFileFormat> &data, const PruningLimits &limits,
+               const size_t requested_threads = 0);
+
+    size_t get_number_of_trees(void) const { return trees_.size(); }
+    const FlatTree &get_tree(const size_t index) const { return trees_[index]; }
+    size_t get_number_of_nodes(void) const { return original_rows_.size(); }
+    size_t get_original_row(const size_t row) const { return original_rows_[row]; }
+    MemoryReport get_memory_report(void) const;
+};
+
+/**
+ * Every tree is built as a FlatTree, the largest mass in every subtree is
+ * found with reduce_tree, and the depth of every node follows from the
+ * depth-first order. Both only grow towards the root, so the kept nodes
+ * always form a connected tree. The trees are pruned in parallel.
+ */
+template <typename DataFileFormat>
+void PrunedForest<DataFileFormat>::prune(const DataContainer<DataFileFormat> &data,
+                                         const PruningLimits &limits,
+                                         const size_t requested_threads) {
+#ifdef TREE_VERBOSE
+    auto start_time = std::chrono::high_resolution_clock::now();
+#endif
+    const auto mass_key = data.get_internal_key(limits.mass_column);
+    const size_t total_rows = data.get_number_of_rows();
+
+    auto root_rows = Forest::find_root_rows(data);
+    root_rows.push_back(total_rows);
+
+    std::vector<uint8_t> keep_rows(total_rows, 0);
+    parallel_for_chunks(0, root_rows.size() - 1,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::vector<size_t> depths;
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                FlatTree tree(root_rows[t], root_rows[t + 1]);
+                                tree.build_tree(data);
+
+                                const auto max_masses = reduce_tree<double>(
+                                    tree,
+                                    [&](const size_t row, const size_t) {
+                                        return data.get_data_as_double(row, mass_key);
+                                    },
+                                    [](const double a, const double b) { return std::max(a, b); }
+                                );
+
+                                const auto total_nodes = (FlatTree::NodeIndex)tree.get_number_of_nodes();
+                                depths.assign(total_nodes, 0);
+                                keep_rows[tree.get_data_row(0)] = 1;
+                                for (FlatTree::NodeIndex node = 1; node < total_nodes; node++) {
+                                    depths[node] = depths[tree.get_parent(node)] + 1;
+                                    keep_rows[tree.get_data_row(node)] 
+                                        = max_masses[node] >= limits.min_mass 
+                                          && depths[node] <= limits.max_depth;
+                                }
+                            }
+                        }, requested_threads);
+
+    original_rows_.clear();
+    for (size_t row = 0; row < total_rows; row++) {
+        if (keep_rows[row]) {
+            original_rows_.push_back(row);
+        }
+    }
+    std::vector<uint8_t>().swap(keep_rows);
+
+    data_ = data.select_rows(original_rows_);
+
+    auto pruned_root_rows = Forest::find_root_rows(data_);
+    pruned_root_rows.push_back(data_.get_number_of_rows());
+
+    trees_.assign(pruned_root_rows.size() - 1, FlatTree());
+    parallel_for_chunks(0, trees_.size(),
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            for (size_t t = chunk_begin; t < chunk_end; t++) {
+                                trees_[t] = FlatTree(pruned_root_rows[t], pruned_root_rows[t + 1]);
+                                trees_[t].build_tree(data_);
+                            }
+                        }, requested_threads);
+#ifdef TREE_VERBOSE
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> seconds_interval = end_time - start_time;
+    std::cout << "Kept " << original_rows_.size() << " of " << total_rows << " rows in ";
+    std::cout << seconds_interval.count() << " s\n";
+#endif
+}
+
+template <typename DataFileFormat>
+MemoryReport PrunedForest<DataFileFormat>::get_memory_report(void) const {
+    MemoryReport report = data_.get_memory_report();
+
+    size_t tree_bytes = 0;
+    for (const auto &tree : trees_) {
+        tree_bytes += tree.get_memory_report().data_bytes;
+    }
+
+    report.entries.push_back(std::make_pair("trees", tree_bytes));
+    report.entries.push_back(std::make_pair("original rows", vector_bytes(original_rows_)));
+    report.data_bytes += tree_bytes;
+    report.index_bytes += vector_bytes(original_rows_);
+
+    return report;
+}
+
+#endif
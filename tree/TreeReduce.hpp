@@ -0,0 +1,233 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TREEREDUCE_HPP
+#define TREEREDUCE_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include "Tree.hpp"
+#include "FlatTree.hpp"
+#include "Forest.hpp"
+#include "../io/Parallel.hpp"
+
+/**
+ * Bottom-up (post-order) reductions over trees, without any recursion. The
+ * value of a node starts as initial(row, number_of_children) and the values
+ * of its children are folded into it in order:
+ *
+ *     value = initial(row, number_of_children);
+ *     for (child : children) value = combine(value, value of child);
+ *
+ * For example, initial = 1 and combine = + gives the number of nodes in every
+ * subtree, initial = (number_of_children == 0) and combine = + the number of
+ * leaves, initial = 0 and combine = max(a, b + 1) the depth, and
+ * initial = mass(row) and combine = max the largest mass in the past.
+ *
+ * The nodes of a Tree are reduced level by level from the deepest level up,
+ * so the nodes of large levels are reduced in parallel. Forests are reduced
+ * in parallel over the trees, except for the largest trees, which are reduced
+ * one at a time with all of the threads. initial and combine are called
+ * concurrently, so they must not modify any shared state. The values are
+ * written concurrently as well, so T cannot be bool (std::vector<bool> packs
+ * its values into shared words), use uint8_t instead.
+ */
+
+// trees with at least this many rows are reduced with parallel levels
+constexpr size_t parallel_reduce_tree_rows = 65536;
+
+// levels with fewer nodes are not worth splitting between threads
+constexpr size_t parallel_reduce_level_nodes = 4096;
+
+/**
+ * The nodes of a tree in breadth-first order, so that every level is
+ * contiguous, and the offset of every level (plus the end of the last).
+ * Lazily built trees have to be expanded completely first.
+ */
+inline void get_tree_levels(const Tree &tree, std::vector<const Node *> &nodes,
+                            std::vector<size_t> &level_offsets) {
+    tree.check_complete();
+    nodes.clear();
+    level_offsets.clear();
+    if (tree.root_node_ == nullptr) {
+        level_offsets.push_back(0);
+        return;
+    }
+
+    nodes.push_back(tree.root_node_.get());
+    size_t level_begin = 0;
+    while (level_begin < nodes.size()) {
+        level_offsets.push_back(level_begin);
+        const size_t level_end = nodes.size();
+        for (size_t i = level_begin; i < level_end; i++) {
+            for (const auto &child : nodes[i]->children_) {
+                nodes.push_back(child.get());
+            }
+        }
+        level_begin = level_end;
+    }
+    level_offsets.push_back(nodes.size());
+}
+
+/**
+ * Reduces one tree into values, which is indexed by the data row relative to
+ * the root row and must have room for all of the rows of the tree. Inside of
+ * another parallel loop (e.g. the trees of reduce_forest), the levels are
+ * always reduced on the calling thread.
+ */
+template <typename T, typename Initial, typename Combine>
+void reduce_tree_into(const Tree &tree, Initial initial, Combine combine, T *values,
+                      const size_t requested_threads = 1) {
+    static_assert(!std::is_same_v<T, bool>,
+                  "The values of a reduction are written concurrently, use uint8_t instead of bool.");
+    std::vector<const Node *> nodes;
+    std::vector<size_t> level_offsets;
+    get_tree_levels(tree, nodes, level_offsets);
+
+    const size_t root_row = tree.root_node_row_in_data_;
+    auto reduce_nodes = [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Node *node = nodes[i];
+            T value = initial(node->get_data_row(), node->children_.size());
+            for (const auto &child : node->children_) {
+                value = combine(value, values[child->get_data_row() - root_row]);
+            }
+            values[node->get_data_row() - root_row] = std::move(value);
+        }
+    };
+
+    const size_t n_threads = in_parallel_region() ? 1 : get_number_of_threads(requested_threads);
+    for (size_t level = level_offsets.size() - 1; level-- > 0;) {
+        const size_t begin = level_offsets[level];
+        const size_t end = level_offsets[level + 1];
+        if (n_threads > 1 && end - begin >= parallel_reduce_level_nodes) {
+            parallel_for_chunks(begin, end, reduce_nodes, n_threads);
+        }
+        else {
+            reduce_nodes(begin, end);
+        }
+    }
+}
+
+/**
+ * Returns the reduced value of every row of the tree (relative to the root
+ * row, so the value of the whole tree is the first one). Rows without a node,
+ * e.g. below the limits of a lazily built tree, are T().
+ */
+template <typename T, typename Initial, typename Combine>
+std::vector<T> reduce_tree(const Tree &tree, Initial initial, Combine combine,
+                           const size_t requested_threads = 1) {
+    static_assert(!std::is_same_v<T, bool>,
+                  "The values of a reduction are written concurrently, use uint8_t instead of bool.");
+    std::vector<T> values(tree.next_root_node_row_in_data_ - tree.root_node_row_in_data_);
+    reduce_tree_into(tree, initial, combine, values.data(), requested_threads);
+
+    return values;
+}
+
+/**
+ * Returns the reduced value of every node of a FlatTree, by node index. The
+ * nodes are in depth-first order, so going through them backwards reduces
+ * every child before its parent.
+ */
+template <typename T, typename Initial, typename Combine>
+std::vector<T> reduce_tree(const FlatTree &tree, Initial initial, Combine combine) {
+    std::vector<T> values(tree.get_number_of_nodes());
+    for (auto node = (FlatTree::NodeIndex)tree.get_number_of_nodes(); node-- > 0;) {
+        T value = initial(tree.get_data_row(node), tree.get_number_of_children(node));
+        for (auto child = tree.get_first_child(node); child != FlatTree::null_node;
+             child = tree.get_next_sibling(child)) {
+            value = combine(value, values[child]);
+        }
+        values[node] = std::move(value);
+    }
+
+    return values;
+}
+
+/**
+ * Returns the reduced value of the root of every tree of the forest, in the
+ * order of the trees. If row_values is given, it receives the value of every
+ * row, indexed by data row.
+ */
+template <typename T, typename Initial, typename Combine>
+std::vector<T> reduce_forest(const Forest &forest, Initial initial, Combine combine,
+                             const size_t requested_threads = 0,
+                             std::vector<T> *row_values = nullptr) {
+    static_assert(!std::is_same_v<T, bool>,
+                  "The values of a reduction are written concurrently, use uint8_t instead of bool.");
+    const size_t total_trees = forest.get_number_of_trees();
+    std::vector<T> tree_values(total_trees);
+
+    if (row_values != nullptr) {
+        size_t end_row = 0;
+        for (const auto &tree : forest.trees_) {
+            end_row = std::max(end_row, tree->next_root_node_row_in_data_);
+        }
+        row_values->assign(end_row, T());
+    }
+
+    auto tree_rows = [&forest](const size_t t) {
+        return forest.trees_[t]->next_root_node_row_in_data_ 
+               - forest.trees_[t]->root_node_row_in_data_;
+    };
+
+    auto reduce_one = [&](const size_t t, std::vector<T> &scratch, const size_t threads) {
+        const auto &tree = *forest.trees_[t];
+        T *values;
+        if (row_values != nullptr) {
+            values = row_values->data() + tree.root_node_row_in_data_;
+        }
+        else {
+            scratch.assign(tree_rows(t), T());
+            values = scratch.data();
+        }
+
+        if (tree.root_node_ != nullptr) {
+            reduce_tree_into(tree, initial, combine, values, threads);
+            tree_values[t] = values[0];
+        }
+    };
+
+    // the largest trees use all of the threads, one after the other
+    std::vector<size_t> small_trees;
+    std::vector<T> scratch;
+    for (size_t t = 0; t < total_trees; t++) {
+        if (tree_rows(t) >= parallel_reduce_tree_rows) {
+            reduce_one(t, scratch, requested_threads);
+        }
+        else {
+            small_trees.push_back(t);
+        }
+    }
+
+    parallel_for_chunks(0, small_trees.size(),
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            std::vector<T> chunk_scratch;
+                            // one thread per tree, the levels are not split again
+                            for (size_t i = chunk_begin; i < chunk_end; i++) {
+                                reduce_one(small_trees[i], chunk_scratch, 1);
+                            }
+                        }, requested_threads);
+
+    return tree_values;
+}
+
+#endif
@@ -0,0 +1,394 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TREESEARCH_HPP
+#define TREESEARCH_HPP
+
+#include <vector>
+#include <memory>
+#include <variant>
+#include <algorithm>
+#include <cstdint>
+#include "Tree.hpp"
+#include "FlatTree.hpp"
+#include "../io/DataContainer.hpp"
+#include "../io/Parallel.hpp"
+
+enum class SearchComparison {
+    less,
+    less_equal,
+    greater,
+    greater_equal,
+    equal,
+    not_equal
+};
+
+// whether a row has to satisfy all of the predicates (AND) or any of them (OR)
+enum class SearchCombination {
+    all_of,
+    any_of
+};
+
+struct SearchPredicate {
+    size_t key;
+    SearchComparison comparison;
+    std::variant<double, int64_t> value;
+};
+
+// buffers of a search, so that searching many trees does not allocate every time
+struct SearchScratch {
+    std::vector<double> double_values;
+    std::vector<int64_t> int_values;
+    std::vector<uint8_t> matches;
+    std::vector<uint8_t> predicate_matches;
+    // the node of every row of the tree that is searched
+    std::vector<const std::shared_ptr<Node> *> nodes_by_row;
+    std::vector<FlatTree::NodeIndex> flat_nodes_by_row;
+    // the nodes left to visit and the matching rows of a node search
+    std::vector<const std::shared_ptr<Node> *> to_visit;
+    std::vector<size_t> rows;
+};
+
+/**
+ * Evaluates several predicates on the rows of a tree (or of any row range) in
+ * one pass, e.g. virial_mass > 1e12 AND scale < 0.5 AND type == 0, instead of
+ * chaining several breadth_first_search calls.
+ *
+ * The rows are processed in blocks in data order. For every predicate, the
+ * block of the column is gathered into a plain double or int64_t array and
+ * compared in a tight loop that the compiler vectorizes, and the results are
+ * combined in a byte mask. Integer columns compared with integer values are
+ * compared exactly, any other combination is compared as double.
+ */
+class TreeSearch {
+private:
+    std::vector<SearchPredicate> predicates_;
+    SearchCombination combination_;
+
+    static constexpr size_t block_rows_ = 1024;
+
+    template <typename T>
+    static void compare_block(const T *values, const size_t count, const T query,
+                              const SearchComparison comparison, uint8_t *matches);
+
+    template <typename DataFileFormat>
+    void match_block(const DataContainer<DataFileFormat> &data, const size_t begin_row,
+                     const size_t count, SearchScratch &scratch) const;
+
+public:
+    TreeSearch(const SearchCombination combination = SearchCombination::all_of) {
+        combination_ = combination;
+    }
+
+    TreeSearch &add_predicate(const size_t key, const SearchComparison comparison,
+                              const double value);
+    TreeSearch &add_predicate(const size_t key, const SearchComparison comparison,
+                              const int64_t value);
+
+    size_t get_number_of_predicates(void) const { return predicates_.size(); }
+    SearchCombination get_combination(void) const { return combination_; }
+
+    template <typename DataFileFormat>
+    size_t search_rows(const DataContainer<DataFileFormat> &data,
+                       const size_t begin_row, const size_t end_row,
+                       std::vector<size_t> &rows, SearchScratch &scratch) const;
+
+    template <typename DataFileFormat>
+    size_t search(const DataContainer<DataFileFormat> &data, const Tree &tree,
+                  std::vector<size_t> &rows, SearchScratch &scratch) const;
+
+    template <typename DataFileFormat>
+    size_t search(const DataContainer<DataFileFormat> &data, const Tree &tree,
+                  std::vector<std::shared_ptr<Node>> &nodes, SearchScratch &scratch) const;
+
+    template <typename DataFileFormat>
+    size_t search(const DataContainer<DataFileFormat> &data, const FlatTree &tree,
+                  std::vector<FlatTree::NodeIndex> &nodes, SearchScratch &scratch) const;
+
+    template <typename DataFileFormat>
+    std::vector<size_t> search(const DataContainer<DataFileFormat> &data,
+                               const size_t requested_threads = 0) const;
+};
+
+inline TreeSearch &TreeSearch::add_predicate(const size_t key,
+                                             const SearchComparison comparison,
+                                             const double value) {
+    predicates_.push_back(SearchPredicate{key, comparison, value});
+    return *this;
+}
+
+inline TreeSearch &TreeSearch::add_predicate(const size_t key,
+                                             const SearchComparison comparison,
+                                             const int64_t value) {
+    predicates_.push_back(SearchPredicate{key, comparison, value});
+    return *this;
+}
+
+// the comparison is chosen once per block, so every loop is branch-free
+template <typename T>
+void TreeSearch::compare_block(const T *values, const size_t count, const T query,
+                               const SearchComparison comparison, uint8_t *matches) {
+    switch (comparison) {
+    case SearchComparison::less:
+        for (size_t i = 0; i < count; i++) {
+            matches[i] = values[i] < query;
+        }
+        break;
+    case SearchComparison::less_equal:
+        for (size_t i = 0; i < count; i++) {
+            matches[i] = values[i] <= query;
+        }
+        break;
+    case SearchComparison::greater:
+        for (size_t i = 0; i < count; i++) {
+            matches[i] = values[i] > query;
+        }
+        break;
+    case SearchComparison::greater_equal:
+        for (size_t i = 0; i < count; i++) {
+            matches[i] = values[i] >= query;
+        }
+        break;
+    case SearchComparison::equal:
+        for (size_t i = 0; i < count; i++) {
+            matches[i] = values[i] == query;
+        }
+        break;
+    case SearchComparison::not_equal:
+        for (size_t i = 0; i < count; i++) {
+            matches[i] = values[i] != query;
+        }
+        break;
+    }
+}
+
+/**
+ * Fills scratch.matches[0:count] for the rows [begin_row, begin_row + count).
+ * Without any predicates, all_of matches every row and any_of matches none.
+ */
+template <typename DataFileFormat>
+void TreeSearch::match_block(const DataContainer<DataFileFormat> &data, const size_t begin_row,
+                             const size_t count, SearchScratch &scratch) const {
+    uint8_t *matches = scratch.matches.data();
+    uint8_t *predicate_matches = scratch.predicate_matches.data();
+    std::fill(matches, matches + count, combination_ == SearchCombination::all_of);
+
+    for (const auto &predicate : predicates_) {
+        const ColumnSpan<std::variant<double, int64_t>> column
+            = data.get_column_span(predicate.key);
+        // the declared type of the column, derived columns are always double
+        const bool is_double = data.is_internal_column_double(predicate.key);
+
+        if (!is_double && std::holds_alternative<int64_t>(predicate.value)) {
+            int64_t *values = scratch.int_values.data();
+            for (size_t i = 0; i < count; i++) {
+                values[i] = *std::get_if<int64_t>(&column[begin_row + i]);
+            }
+            compare_block(values, count, std::get<int64_t>(predicate.value),
+                          predicate.comparison, predicate_matches);
+        }
+        else {
+            double *values = scratch.double_values.data();
+            if (is_double) {
+                for (size_t i = 0; i < count; i++) {
+                    values[i] = *std::get_if<double>(&column[begin_row + i]);
+                }
+            }
+            else {
+                for (size_t i = 0; i < count; i++) {
+                    values[i] = (double)*std::get_if<int64_t>(&column[begin_row + i]);
+                }
+            }
+
+            const double query = std::holds_alternative<double>(predicate.value)
+                                 ? std::get<double>(predicate.value)
+                                 : (double)std::get<int64_t>(predicate.value);
+            compare_block(values, count, query, predicate.comparison, predicate_matches);
+        }
+
+        if (combination_ == SearchCombination::all_of) {
+            for (size_t i = 0; i < count; i++) {
+                matches[i] &= predicate_matches[i];
+            }
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                matches[i] |= predicate_matches[i];
+            }
+        }
+    }
+}
+
+/**
+ * Appends the rows in [begin_row, end_row) that match, in data order, to
+ * rows and returns the number of matches. The derived columns of the
+ * predicates are filled first, since the blocks read the column storage.
+ */
+template <typename DataFileFormat>
+size_t TreeSearch::search_rows(const DataContainer<DataFileFormat> &data,
+                               const size_t begin_row, const size_t end_row,
+                               std::vector<size_t> &rows, SearchScratch &scratch) const {
+    scratch.double_values.resize(block_rows_);
+    scratch.int_values.resize(block_rows_);
+    scratch.matches.resize(block_rows_);
+    scratch.predicate_matches.resize(block_rows_);
+
+    for (const auto &predicate : predicates_) {
+        if (data.is_derived_column(predicate.key)) {
+            data.materialize_derived_column(predicate.key);
+        }
+    }
+
+    const size_t initial_size = rows.size();
+    for (size_t block_begin = begin_row; block_begin < end_row; block_begin += block_rows_) {
+        const size_t count = std::min(block_rows_, end_row - block_begin);
+        match_block(data, block_begin, count, scratch);
+
+        for (size_t i = 0; i < count; i++) {
+            if (scratch.matches[i]) {
+                rows.push_back(block_begin + i);
+            }
+        }
+    }
+
+    return rows.size() - initial_size;
+}
+
+/**
+ * Searches all of the rows of the tree. The rows are cleared first.
+ */
+template <typename DataFileFormat>
+size_t TreeSearch::search(const DataContainer<DataFileFormat> &data, const Tree &tree,
+                          std::vector<size_t> &rows, SearchScratch &scratch) const {
+    rows.clear();
+    return search_rows(data, tree.root_node_row_in_data_, tree.next_root_node_row_in_data_,
+                       rows, scratch);
+}
+
+/**
+ * Returns the matching nodes of the tree, in data row order. Rows without a
+ * node (e.g. of a lazily built tree that is not fully expanded) are skipped.
+ * The nodes are cleared first.
+ */
+template <typename DataFileFormat>
+size_t TreeSearch::search(const DataContainer<DataFileFormat> &data, const Tree &tree,
+                          std::vector<std::shared_ptr<Node>> &nodes,
+                          SearchScratch &scratch) const {
+    nodes.clear();
+    if (tree.root_node_ == nullptr) {
+        return 0;
+    }
+
+    const size_t first_row = tree.root_node_row_in_data_;
+    const size_t total_rows = tree.next_root_node_row_in_data_ - first_row;
+
+    auto &nodes_by_row = scratch.nodes_by_row;
+    nodes_by_row.assign(total_rows, nullptr);
+    auto &to_visit = scratch.to_visit;
+    to_visit.clear();
+    to_visit.push_back(&tree.root_node_);
+    while (!to_visit.empty()) {
+        const auto node = to_visit.back();
+        to_visit.pop_back();
+
+        nodes_by_row[(*node)->get_data_row() - first_row] = node;
+        for (const auto &child : (*node)->children_) {
+            to_visit.push_back(&child);
+        }
+    }
+
+    auto &rows = scratch.rows;
+    rows.clear();
+    search_rows(data, first_row, first_row + total_rows, rows, scratch);
+    for (const auto row : rows) {
+        if (nodes_by_row[row - first_row] != nullptr) {
+            nodes.push_back(*nodes_by_row[row - first_row]);
+        }
+    }
+
+    return nodes.size();
+}
+
+/**
+ * Returns the matching nodes of the flat tree, in data row order. The nodes
+ * are cleared first.
+ */
+template <typename DataFileFormat>
+size_t TreeSearch::search(const DataContainer<DataFileFormat> &data, const FlatTree &tree,
+                          std::vector<FlatTree::NodeIndex> &nodes,
+                          SearchScratch &scratch) const {
+    nodes.clear();
+    const size_t first_row = tree.root_node_row_in_data_;
+    const size_t total_rows = tree.next_root_node_row_in_data_ - first_row;
+
+    auto &flat_nodes_by_row = scratch.flat_nodes_by_row;
+    flat_nodes_by_row.assign(total_rows, FlatTree::null_node);
+    for (FlatTree::NodeIndex node = 0; node < (FlatTree::NodeIndex)tree.get_number_of_nodes(); node++) {
+        flat_nodes_by_row[tree.get_data_row(node) - first_row] = node;
+    }
+
+    auto &rows = scratch.rows;
+    rows.clear();
+    search_rows(data, first_row, first_row + total_rows, rows, scratch);
+    for (const auto row : rows) {
+        if (flat_nodes_by_row[row - first_row] != FlatTree::null_node) {
+            nodes.push_back(flat_nodes_by_row[row - first_row]);
+        }
+    }
+
+    return nodes.size();
+}
+
+/**
+ * Searches every row of the data in parallel, the rows are returned in data
+ * order.
+ */
+template <typename DataFileFormat>
+std::vector<size_t> TreeSearch::search(const DataContainer<DataFileFormat> &data,
+                                       const size_t requested_threads) const {
+    const size_t total_rows = data.get_number_of_rows();
+
+    // fixed chunks of whole blocks, so that the buffers can be joined in order
+    const size_t n_threads = get_number_of_threads(requested_threads);
+    const size_t chunk_size = std::max((size_t)1, total_rows / (8 * n_threads * block_rows_))
+                              * block_rows_;
+    const size_t total_chunks = (total_rows + chunk_size - 1) / chunk_size;
+
+    std::vector<std::vector<size_t>> chunk_rows(total_chunks);
+    parallel_for_chunks(0, total_rows,
+                        [&](const size_t chunk_begin, const size_t chunk_end) {
+                            SearchScratch scratch;
+                            search_rows(data, chunk_begin, chunk_end,
+                                        chunk_rows[chunk_begin / chunk_size], scratch);
+                        }, requested_threads, chunk_size);
+
+    size_t total_matches = 0;
+    for (const auto &rows : chunk_rows) {
+        total_matches += rows.size();
+    }
+
+    std::vector<size_t> all_rows;
+    all_rows.reserve(total_matches);
+    for (const auto &rows : chunk_rows) {
+        all_rows.insert(all_rows.end(), rows.begin(), rows.end());
+    }
+
+    return all_rows;
+}
+
+#endif
@@ -0,0 +1,381 @@
+/**
+ * This file is part of HaloDataManager.
+ * Copyright (c) 2024 Douglas Rennehan (douglas.rennehan@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TREEWALK_HPP
+#define TREEWALK_HPP
+
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <cstddef>
+#include <stdexcept>
+#include <limits>
+#include "Node.hpp"
+#include "Tree.hpp"
+
+/**
+ * Ranges over the nodes of a tree for range-based for loops, which can be
+ * left at any point with break:
+ *
+ *     TreeScratch scratch;
+ *     for (const auto &node : walk_pre_order(tree, scratch)) {
+ *         if (data.get_data<double>(node->get_data_row(), mass_key) > 1.e14) {
+ *             break;
+ *         }
+ *     }
+ *
+ * The pre-order, post-order and breadth-first walks keep their stack or queue
+ * in a TreeScratch, so they only allocate while its buffers grow, and reusing
+ * one TreeScratch for many walks does not allocate at all. Since the iterators
+ * share the buffers, a walk can only be iterated once, and a TreeScratch can
+ * only be used by one walk at a time. The main branch and the path to the
+ * root do not need any buffers. The iterators point into the range, so the
+ * range has to outlive them. A walk starts at any node and covers the part
+ * of the tree below (or, for walk_to_root, above) it. The walks throw when
+ * they reach a node of a lazily built tree that is not expanded yet, so a
+ * lazy tree has to be expanded (e.g. with Tree::expand_tree) first.
+ */
+
+// the progenitors of a node that a walk goes on to
+inline const auto &get_walk_children(const Node &node) {
+    if (node.pending_depth_ != 0) {
+        throw std::runtime_error("Reached a node of a lazily built tree that is not expanded, "
+                                 "call expand_tree first.\n");
+    }
+
+    return node.children_;
+}
+
+// the nodes of a subtree, every node before its progenitors, and the
+// progenitors of a node in the order of its children
+class PreOrderWalk {
+private:
+    std::shared_ptr<Node> node_;
+    TreeScratch *scratch_;
+public:
+    class iterator {
+    private:
+        // marks a node whose progenitors are skipped on the stack
+        static constexpr size_t skipped = std::numeric_limits<size_t>::max();
+
+        std::vector<std::pair<const std::shared_ptr<Node> *, size_t>> *stack_;
+        const std::shared_ptr<Node> *node_;
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::shared_ptr<Node>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::shared_ptr<Node> *;
+        using reference = const std::shared_ptr<Node> &;
+
+        iterator(std::vector<std::pair<const std::shared_ptr<Node> *, size_t>> *stack = nullptr,
+                 const std::shared_ptr<Node> *node = nullptr) : stack_(stack), node_(node) { }
+
+        reference operator*(void) const { return *node_; }
+        pointer operator->(void) const { return node_; }
+        iterator &operator++(void);
+        bool operator==(const iterator &other) const { return node_ == other.node_; }
+        bool operator!=(const iterator &other) const { return node_ != other.node_; }
+
+        // the progenitors of the current node are not visited
+        void skip_children(void) { stack_->back().second = skipped; }
+    };
+
+    PreOrderWalk(const std::shared_ptr<Node> &node, TreeScratch &scratch)
+        : node_(node), scratch_(&scratch) { }
+
+    iterator begin(void) const;
+    iterator end(void) const { return iterator(); }
+};
+
+// the nodes of a subtree, every node after all of its progenitors
+class PostOrderWalk {
+private:
+    std::shared_ptr<Node> node_;
+    TreeScratch *scratch_;
+public:
+    class iterator {
+    private:
+        std::vector<std::pair<const std::shared_ptr<Node> *, size_t>> *stack_;
+        const std::shared_ptr<Node> *node_;
+
+        void descend(void);
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::shared_ptr<Node>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::shared_ptr<Node> *;
+        using reference = const std::shared_ptr<Node> &;
+
+        iterator(std::vector<std::pair<const std::shared_ptr<Node> *, size_t>> *stack = nullptr)
+            : stack_(stack), node_(nullptr) {
+            if (stack_ != nullptr) {
+                descend();
+            }
+        }
+
+        reference operator*(void) const { return *node_; }
+        pointer operator->(void) const { return node_; }
+        iterator &operator++(void);
+        bool operator==(const iterator &other) const { return node_ == other.node_; }
+        bool operator!=(const iterator &other) const { return node_ != other.node_; }
+    };
+
+    PostOrderWalk(const std::shared_ptr<Node> &node, TreeScratch &scratch)
+        : node_(node), scratch_(&scratch) { }
+
+    iterator begin(void) const;
+    iterator end(void) const { return iterator(); }
+};
+
+// the nodes of a subtree level by level
+class BreadthFirstWalk {
+private:
+    std::shared_ptr<Node> node_;
+    TreeScratch *scratch_;
+public:
+    class iterator {
+    private:
+        std::vector<const std::shared_ptr<Node> *> *queue_;
+        size_t head_;
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::shared_ptr<Node>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::shared_ptr<Node> *;
+        using reference = const std::shared_ptr<Node> &;
+
+        iterator(std::vector<const std::shared_ptr<Node> *> *queue = nullptr)
+            : queue_(queue), head_(0) { }
+
+        reference operator*(void) const { return *(*queue_)[head_]; }
+        pointer operator->(void) const { return (*queue_)[head_]; }
+        iterator &operator++(void);
+        bool operator==(const iterator &other) const {
+            return queue_ == other.queue_ && head_ == other.head_;
+        }
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+    };
+
+    BreadthFirstWalk(const std::shared_ptr<Node> &node, TreeScratch &scratch)
+        : node_(node), scratch_(&scratch) { }
+
+    iterator begin(void) const;
+    iterator end(void) const { return iterator(); }
+};
+
+// a node and its first progenitor, the first progenitor of that, and so on
+class MainBranchWalk {
+private:
+    std::shared_ptr<Node> node_;
+public:
+    class iterator {
+    private:
+        const std::shared_ptr<Node> *node_;
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::shared_ptr<Node>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::shared_ptr<Node> *;
+        using reference = const std::shared_ptr<Node> &;
+
+        iterator(const std::shared_ptr<Node> *node = nullptr) : node_(node) { }
+
+        reference operator*(void) const { return *node_; }
+        pointer operator->(void) const { return node_; }
+        iterator &operator++(void) {
+            const auto &children = get_walk_children(**node_);
+            node_ = children.empty() ? nullptr : &children[0];
+            return *this;
+        }
+        iterator operator++(int) { iterator previous = *this; ++(*this); return previous; }
+        bool operator==(const iterator &other) const { return node_ == other.node_; }
+        bool operator!=(const iterator &other) const { return node_ != other.node_; }
+    };
+
+    MainBranchWalk(const std::shared_ptr<Node> &node) : node_(node) { }
+
+    iterator begin(void) const { return iterator(node_ != nullptr ? &node_ : nullptr); }
+    iterator end(void) const { return iterator(); }
+};
+
+// a node and its descendant, the descendant of that, and so on up to the root
+class RootPathWalk {
+private:
+    std::shared_ptr<Node> node_;
+public:
+    class iterator {
+    private:
+        std::shared_ptr<Node> node_;
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::shared_ptr<Node>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::shared_ptr<Node> *;
+        using reference = const std::shared_ptr<Node> &;
+
+        iterator(const std::shared_ptr<Node> &node = nullptr) : node_(node) { }
+
+        reference operator*(void) const { return node_; }
+        pointer operator->(void) const { return &node_; }
+        iterator &operator++(void) { node_ = node_->get_parent(); return *this; }
+        iterator operator++(int) { iterator previous = *this; ++(*this); return previous; }
+        bool operator==(const iterator &other) const { return node_ == other.node_; }
+        bool operator!=(const iterator &other) const { return node_ != other.node_; }
+    };
+
+    RootPathWalk(const std::shared_ptr<Node> &node) : node_(node) { }
+
+    iterator begin(void) const { return iterator(node_); }
+    iterator end(void) const { return iterator(); }
+};
+
+inline PreOrderWalk::iterator &PreOrderWalk::iterator::operator++(void) {
+    while (!stack_->empty()) {
+        auto &top = stack_->back();
+        if (top.second != skipped) {
+            const auto &children = get_walk_children(**top.first);
+            if (top.second < children.size()) {
+                node_ = &children[top.second++];
+                stack_->push_back(std::make_pair(node_, (size_t)0));
+                return *this;
+            }
+        }
+
+        stack_->pop_back();
+    }
+
+    node_ = nullptr;
+    return *this;
+}
+
+inline PreOrderWalk::iterator PreOrderWalk::begin(void) const {
+    auto &stack = scratch_->walk_stack;
+    stack.clear();
+    if (node_ == nullptr) {
+        return end();
+    }
+
+    stack.push_back(std::make_pair(&node_, (size_t)0));
+    return iterator(&stack, &node_);
+}
+
+/**
+ * Goes down the first unvisited progenitors from the top of the stack until
+ * reaching a node whose progenitors were all visited.
+ */
+inline void PostOrderWalk::iterator::descend(void) {
+    while (true) {
+        auto &top = stack_->back();
+        const auto &children = get_walk_children(**top.first);
+        if (top.second == children.size()) {
+            break;
+        }
+
+        const std::shared_ptr<Node> *child = &children[top.second++];
+        stack_->push_back(std::make_pair(child, (size_t)0));
+    }
+
+    node_ = stack_->back().first;
+}
+
+inline PostOrderWalk::iterator &PostOrderWalk::iterator::operator++(void) {
+    stack_->pop_back();
+    if (stack_->empty()) {
+        node_ = nullptr;
+    }
+    else {
+        descend();
+    }
+
+    return *this;
+}
+
+inline PostOrderWalk::iterator PostOrderWalk::begin(void) const {
+    auto &stack = scratch_->walk_stack;
+    stack.clear();
+    if (node_ == nullptr) {
+        return end();
+    }
+
+    stack.push_back(std::make_pair(&node_, (size_t)0));
+    return iterator(&stack);
+}
+
+/**
+ * The progenitors of a node are only queued when the iterator moves past it,
+ * so a walk that stops early never queues the levels below.
+ */
+inline BreadthFirstWalk::iterator &BreadthFirstWalk::iterator::operator++(void) {
+    for (const auto &child : get_walk_children(**(*queue_)[head_])) {
+        queue_->push_back(&child);
+    }
+
+    head_++;
+    if (head_ == queue_->size()) {
+        queue_ = nullptr;
+        head_ = 0;
+    }
+
+    return *this;
+}
+
+inline BreadthFirstWalk::iterator BreadthFirstWalk::begin(void) const {
+    auto &queue = scratch_->walk_queue;
+    queue.clear();
+    if (node_ == nullptr) {
+        return end();
+    }
+
+    queue.push_back(&node_);
+    return iterator(&queue);
+}
+
+inline PreOrderWalk walk_pre_order(const std::shared_ptr<Node> &node, TreeScratch &scratch) {
+    return PreOrderWalk(node, scratch);
+}
+
+inline PreOrderWalk walk_pre_order(const Tree &tree, TreeScratch &scratch) {
+    return PreOrderWalk(tree.root_node_, scratch);
+}
+
+inline PostOrderWalk walk_post_order(const std::shared_ptr<Node> &node, TreeScratch &scratch) {
+    return PostOrderWalk(node, scratch);
+}
+
+inline PostOrderWalk walk_post_order(const Tree &tree, TreeScratch &scratch) {
+    return PostOrderWalk(tree.root_node_, scratch);
+}
+
+inline BreadthFirstWalk walk_breadth_first(const std::shared_ptr<Node> &node, TreeScratch &scratch) {
+    return BreadthFirstWalk(node, scratch);
+}
+
+inline BreadthFirstWalk walk_breadth_first(const Tree &tree, TreeScratch &scratch) {
+    return BreadthFirstWalk(tree.root_node_, scratch);
+}
+
+inline MainBranchWalk walk_main_branch(const std::shared_ptr<Node> &node) {
+    return MainBranchWalk(node);
+}
+
+inline RootPathWalk walk_to_root(const std::shared_ptr<Node> &node) {
+    return RootPathWalk(node);
+}
+
+#endif